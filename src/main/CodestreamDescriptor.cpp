@@ -0,0 +1,175 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "CodestreamDescriptor.h"
+#include "J2KProfileULMap.h"
+#include <stdexcept>
+#include <algorithm>
+#include <array>
+#include <string.h>
+
+static ASDCP::MXF::GenericPictureEssenceDescriptor& picture_descriptor(ASDCP::MXF::OP1aHeader& header) {
+
+    ASDCP::MXF::InterchangeObject* obj = NULL;
+
+    if (header.GetMDObjectByType(header.m_Dict->ul(ASDCP::MDD_RGBAEssenceDescriptor), &obj).Failure() &&
+        header.GetMDObjectByType(header.m_Dict->ul(ASDCP::MDD_CDCIEssenceDescriptor), &obj).Failure()) {
+        throw std::runtime_error("Cannot find the essence descriptor");
+    }
+
+    return *static_cast<ASDCP::MXF::GenericPictureEssenceDescriptor*>(obj);
+}
+
+/* copies the body of a main header marker segment, i.e. without its marker and length */
+
+static void set_segment_body(ASDCP::MXF::optional_property<ASDCP::MXF::Raw>& property, const J2KCodestream& codestream, uint16_t marker) {
+
+    const J2KCodestream::MarkerSegment* seg = codestream.findMainHeaderSegment(marker);
+
+    if (!seg) {
+        throw std::runtime_error("Codestream is missing a main header marker segment");
+    }
+
+    if (ASDCP_FAILURE(property.get().Set(codestream.data() + seg->offset + 4, (ui32_t) (seg->length - 4)))) {
+        throw std::runtime_error("Cannot allocate memory");
+    }
+
+    property.set_has_value();
+}
+
+/* updates the JPEG 2000 Part 1 profile label, as written by jid-writer, to the profile signalled by rsiz */
+
+static void set_picture_coding(ASDCP::MXF::GenericPictureEssenceDescriptor& desc, uint16_t rsiz) {
+
+    static const uint8_t PROFILE_UL_PREFIX[] = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x0d, 0x04, 0x01, 0x02, 0x02, 0x03, 0x01, 0x02 };
+
+    std::array<uint8_t, 16> ul;
+
+    memcpy(ul.data(), desc.PictureEssenceCoding.Value(), ul.size());
+
+    /* the version byte is ignored */
+
+    if (memcmp(ul.data(), PROFILE_UL_PREFIX, 7) != 0 || memcmp(ul.data() + 8, PROFILE_UL_PREFIX + 8, sizeof PROFILE_UL_PREFIX - 8) != 0) return;
+
+    std::map<int, std::pair<int, int>>::const_iterator ul_bytes = J2KPROFILE_UL_MAP.find(rsiz);
+
+    if (ul_bytes == J2KPROFILE_UL_MAP.end()) {
+        throw std::runtime_error("Codestream profile has no picture essence coding label");
+    }
+
+    ul[14] = static_cast<uint8_t>(ul_bytes->second.first);
+    ul[15] = static_cast<uint8_t>(ul_bytes->second.second);
+
+    desc.PictureEssenceCoding = ul.data();
+}
+
+void set_codestream_descriptor(ASDCP::MXF::OP1aHeader& header, const J2KCodestream& codestream) {
+
+    ASDCP::MXF::InterchangeObject* obj = NULL;
+
+    if (header.GetMDObjectByType(header.m_Dict->ul(ASDCP::MDD_JPEG2000PictureSubDescriptor), &obj).Failure()) {
+        throw std::runtime_error("Cannot find the JPEG 2000 picture sub-descriptor");
+    }
+
+    ASDCP::MXF::JPEG2000PictureSubDescriptor* subdesc = static_cast<ASDCP::MXF::JPEG2000PictureSubDescriptor*>(obj);
+
+    subdesc->Rsize = codestream.rsiz();
+    subdesc->Xsize = codestream.xsiz();
+    subdesc->Ysize = codestream.ysiz();
+    subdesc->XOsize = codestream.xosiz();
+    subdesc->YOsize = codestream.yosiz();
+    subdesc->XTsize = codestream.xtsiz();
+    subdesc->YTsize = codestream.ytsiz();
+    subdesc->XTOsize = codestream.xtosiz();
+    subdesc->YTOsize = codestream.ytosiz();
+
+    if (!subdesc->CodingStyleDefault.empty()) {
+        set_segment_body(subdesc->CodingStyleDefault, codestream, J2KMarker::COD);
+    }
+
+    if (!subdesc->QuantizationDefault.empty()) {
+        set_segment_body(subdesc->QuantizationDefault, codestream, J2KMarker::QCD);
+    }
+
+    ASDCP::MXF::GenericPictureEssenceDescriptor& desc = picture_descriptor(header);
+
+    desc.StoredWidth = codestream.xsiz() - codestream.xosiz();
+    desc.StoredHeight = codestream.ysiz() - codestream.yosiz();
+
+    set_picture_coding(desc, codestream.rsiz());
+}
+
+/* scales the interval [offset, offset + length) along one axis, within [0, limit) */
+
+static void scale_interval(ASDCP::MXF::optional_property<i32_t>& offset, ASDCP::MXF::optional_property<ui32_t>& length,
+    uint8_t levels, uint32_t limit) {
+
+    if (length.empty()) return;
+
+    const int64_t d = (int64_t) 1 << levels;
+
+    int64_t start = offset.empty() ? 0 : offset.get();
+    int64_t end = start + length.get();
+
+    /* floor and ceiling */
+
+    start = start >= 0 ? start / d : -((-start + d - 1) / d);
+    end = end >= 0 ? (end + d - 1) / d : -((-end) / d);
+
+    end = std::min<int64_t>(end, limit);
+
+    if (end <= start) {
+        throw std::runtime_error("Picture rectangle is empty at the reduced resolution");
+    }
+
+    if (!offset.empty()) offset = (i32_t) start;
+
+    length = (ui32_t) (end - start);
+}
+
+void scale_picture_rectangles(ASDCP::MXF::OP1aHeader& header, uint8_t levels) {
+
+    ASDCP::MXF::GenericPictureEssenceDescriptor& desc = picture_descriptor(header);
+
+    ASDCP::MXF::optional_property<i32_t> active_x_offset;
+    ASDCP::MXF::optional_property<i32_t> active_y_offset;
+
+    if (!desc.ActiveXOffset.empty()) active_x_offset = (i32_t) desc.ActiveXOffset.get();
+    if (!desc.ActiveYOffset.empty()) active_y_offset = (i32_t) desc.ActiveYOffset.get();
+
+    scale_interval(desc.SampledXOffset, desc.SampledWidth, levels, desc.StoredWidth);
+    scale_interval(desc.SampledYOffset, desc.SampledHeight, levels, desc.StoredHeight);
+    scale_interval(desc.DisplayXOffset, desc.DisplayWidth, levels, desc.StoredWidth);
+    scale_interval(desc.DisplayYOffset, desc.DisplayHeight, levels, desc.StoredHeight);
+
+    /* the active rectangle lies within the display rectangle */
+
+    scale_interval(active_x_offset, desc.ActiveWidth, levels, desc.DisplayWidth.empty() ? desc.StoredWidth : desc.DisplayWidth.get());
+    scale_interval(active_y_offset, desc.ActiveHeight, levels, desc.DisplayHeight.empty() ? desc.StoredHeight : desc.DisplayHeight.get());
+
+    if (!active_x_offset.empty()) desc.ActiveXOffset = (ui32_t) active_x_offset.get();
+    if (!active_y_offset.empty()) desc.ActiveYOffset = (ui32_t) active_y_offset.get();
+}
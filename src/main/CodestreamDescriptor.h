@@ -0,0 +1,48 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_CODESTREAMDESCRIPTOR_H
+#define COM_SANDFLOW_CODESTREAMDESCRIPTOR_H
+
+#include <AS_02.h>
+#include <Metadata.h>
+#include "J2KCodestream.h"
+
+/* updates the header metadata of a track file whose codestreams are replaced by codestreams derived from them, e.g.
+   by discarding resolution levels */
+
+/* sets the image and tile geometry, coding style and quantization of the JPEG 2000 picture sub-descriptor, and the
+   stored rectangle and, for Part 1 profiles, picture essence coding label of the essence descriptor, from the main
+   header of codestream */
+
+void set_codestream_descriptor(ASDCP::MXF::OP1aHeader& header, const J2KCodestream& codestream);
+
+/* scales the sampled, display and active rectangles of the essence descriptor by 1/2^levels, within the stored
+   rectangle */
+
+void scale_picture_rectangles(ASDCP::MXF::OP1aHeader& header, uint8_t levels);
+
+#endif
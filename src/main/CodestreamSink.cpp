@@ -0,0 +1,521 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "CodestreamSink.h"
+#include "FileIO.h"
+#include <stdexcept>
+#include <array>
+
+#ifdef WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#endif
+
+/* J2CDirectorySink */
+
+J2CDirectorySink::J2CDirectorySink(const std::string& dir_path,
+    unsigned int thread_count,
+    FsyncPolicy fsync_policy) :
+    dir_path_(dir_path),
+    fsync_policy_(fsync_policy),
+    max_pending_(2 * (thread_count > 0 ? thread_count : 1)),
+    workers_(),
+    mutex_(),
+    job_ready_(),
+    job_done_(),
+    pending_(),
+    free_(),
+    is_closing_(false),
+    error_(),
+    written_paths_()
+{
+    /* codestream buffers are recycled, and their number bounds the memory used by frames waiting to be written */
+
+    this->free_.resize(this->max_pending_);
+
+    for (unsigned int i = 0; i < (thread_count > 0 ? thread_count : 1); i++) {
+        this->workers_.push_back(std::thread(&J2CDirectorySink::_run, this));
+    }
+}
+
+J2CDirectorySink::~J2CDirectorySink() {
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        this->is_closing_ = true;
+    }
+
+    this->job_ready_.notify_all();
+
+    for (std::thread& worker : this->workers_) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+void J2CDirectorySink::_check_error() {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+
+    if (!this->error_.empty()) {
+        throw std::runtime_error(this->error_);
+    }
+}
+
+std::list<J2CDirectorySink::Job> J2CDirectorySink::_acquire_job() {
+
+    std::list<Job> job;
+
+    std::unique_lock<std::mutex> lock(this->mutex_);
+
+    this->job_done_.wait(lock, [this] { return !this->free_.empty() || !this->error_.empty(); });
+
+    if (!this->error_.empty()) {
+        throw std::runtime_error(this->error_);
+    }
+
+    job.splice(job.begin(), this->free_, this->free_.begin());
+
+    return job;
+}
+
+void J2CDirectorySink::_submit_job(std::list<Job>& job) {
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        this->pending_.splice(this->pending_.end(), job);
+    }
+
+    this->job_ready_.notify_one();
+}
+
+void J2CDirectorySink::write(uint32_t frame_number, const uint8_t* data, uint32_t size) {
+
+    std::list<Job> job = this->_acquire_job();
+
+    job.front().frame_number = frame_number;
+    job.front().codestream.assign(data, data + size);
+    job.front().source_fd = -1;
+
+    this->_submit_job(job);
+}
+
+void J2CDirectorySink::copy(uint32_t frame_number, int fd, uint64_t offset, uint32_t size) {
+
+    std::list<Job> job = this->_acquire_job();
+
+    job.front().frame_number = frame_number;
+    job.front().source_fd = fd;
+    job.front().source_offset = offset;
+    job.front().source_size = size;
+
+    this->_submit_job(job);
+}
+
+void J2CDirectorySink::close() {
+
+    {
+        std::unique_lock<std::mutex> lock(this->mutex_);
+
+        this->job_done_.wait(lock, [this] { return this->free_.size() == this->max_pending_; });
+
+        this->is_closing_ = true;
+    }
+
+    this->job_ready_.notify_all();
+
+    for (std::thread& worker : this->workers_) {
+        worker.join();
+    }
+
+    this->_check_error();
+
+#ifndef WIN32
+
+    if (this->fsync_policy_ == FsyncPolicy::DEFERRED) {
+
+        /* flush the files written, whose writeback is already under way, then the directory entries */
+
+        for (const std::string& path : this->written_paths_) {
+
+            int fd = open(path.c_str(), O_RDONLY);
+
+            if (fd < 0 || fsync(fd) != 0) {
+                if (fd >= 0) ::close(fd);
+                throw std::runtime_error("Cannot flush output file: " + path);
+            }
+
+            ::close(fd);
+        }
+
+        int dir_fd = open(this->dir_path_.c_str(), O_RDONLY);
+
+        if (dir_fd < 0) {
+            throw std::runtime_error("Cannot open output directory");
+        }
+
+        int err = fsync(dir_fd);
+
+        ::close(dir_fd);
+
+        if (err != 0) {
+            throw std::runtime_error("Cannot flush output directory");
+        }
+    }
+
+#endif
+}
+
+void J2CDirectorySink::_run() {
+
+    while (true) {
+
+        std::list<Job> job;
+
+        {
+            std::unique_lock<std::mutex> lock(this->mutex_);
+
+            this->job_ready_.wait(lock, [this] { return !this->pending_.empty() || this->is_closing_; });
+
+            if (this->pending_.empty()) {
+                return;
+            }
+
+            job.splice(job.begin(), this->pending_, this->pending_.begin());
+        }
+
+        try {
+
+            this->_write_file(job.front());
+
+        } catch (std::exception& e) {
+
+            std::lock_guard<std::mutex> lock(this->mutex_);
+
+            if (this->error_.empty()) {
+                this->error_ = e.what();
+            }
+
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            this->free_.splice(this->free_.end(), job);
+        }
+
+        this->job_done_.notify_all();
+    }
+}
+
+void J2CDirectorySink::_write_file(const Job& job) {
+
+    char file_name[32];
+
+    snprintf(file_name, sizeof file_name, "/%06u.j2c", job.frame_number);
+
+    std::string path = this->dir_path_ + file_name;
+
+#ifdef WIN32
+
+    FILE* fp = fopen(path.c_str(), "wb");
+
+    if (!fp) {
+        throw std::runtime_error("Cannot open output file: " + path);
+    }
+
+    bool is_good = true;
+
+    try {
+
+        if (job.source_fd < 0) {
+            is_good = fwrite(job.codestream.data(), 1, job.codestream.size(), fp) == job.codestream.size();
+        } else {
+            copy_fd_range(_fileno(fp), job.source_fd, job.source_offset, job.source_size);
+        }
+
+    } catch (...) {
+
+        fclose(fp);
+        throw;
+
+    }
+
+    is_good = is_good && fflush(fp) == 0;
+
+    if (is_good && this->fsync_policy_ != FsyncPolicy::NONE) {
+        is_good = _commit(_fileno(fp)) == 0;
+    }
+
+    if (fclose(fp) != 0 || !is_good) {
+        throw std::runtime_error("Cannot write output file: " + path);
+    }
+
+#else
+
+    uint32_t size = job.source_fd < 0 ? (uint32_t) job.codestream.size() : job.source_size;
+
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open output file: " + path);
+    }
+
+    try {
+
+#ifdef __linux__
+
+        /* reserve the extent up front; unlike posix_fallocate(), fallocate() fails instead of writing zeros
+           on file systems that do not support it, in which case the file is simply written. Copies are not
+           preallocated so that their extents can be shared with the source file. */
+
+        if (size > 0 && job.source_fd < 0) {
+            (void) fallocate(fd, 0, 0, (off_t) size);
+        }
+
+#endif
+
+        if (job.source_fd < 0) {
+            write_fd(fd, job.codestream.data(), job.codestream.size());
+        } else {
+            copy_fd_range(fd, job.source_fd, job.source_offset, size);
+        }
+
+        if (this->fsync_policy_ == FsyncPolicy::FILE && fsync(fd) != 0) {
+            throw std::runtime_error("Cannot flush output file: " + path);
+        }
+
+#ifdef __linux__
+
+        /* start writeback now so that little remains to be flushed when the sink is closed */
+
+        if (this->fsync_policy_ == FsyncPolicy::DEFERRED) {
+            (void) sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+        }
+
+#endif
+
+    } catch (...) {
+
+        ::close(fd);
+        throw;
+
+    }
+
+    if (::close(fd) != 0) {
+        throw std::runtime_error("Cannot close output file: " + path);
+    }
+
+    if (this->fsync_policy_ == FsyncPolicy::DEFERRED) {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        this->written_paths_.push_back(path);
+    }
+
+#endif
+}
+
+/* MJCSink */
+
+MJCSink::MJCSink(const std::string& path, const ASDCP::Rational& edit_rate, uint32_t flags) :
+    fd_(-1),
+    is_stdout_(path.empty()),
+    is_pipe_(false)
+{
+    if (this->is_stdout_) {
+
+#ifdef WIN32
+
+        /* open stdout in binary mode */
+
+        if (_setmode(_fileno(stdout), _O_BINARY) == -1) {
+            throw std::runtime_error("Cannot reopen stdout");
+        }
+
+        this->fd_ = _fileno(stdout);
+
+#else
+
+        this->fd_ = STDOUT_FILENO;
+
+#endif
+
+    } else {
+
+#ifdef WIN32
+        this->fd_ = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+        this->fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+#endif
+
+        if (this->fd_ < 0) {
+            throw std::runtime_error("Cannot create output file");
+        }
+
+    }
+
+#ifdef __linux__
+
+    struct stat st;
+
+    this->is_pipe_ = fstat(this->fd_, &st) == 0 && S_ISFIFO(st.st_mode);
+
+#endif
+
+    std::array<uint8_t, 16> header = {
+        'M',
+        'J',
+        'C',
+        '2',
+        (uint8_t) ((edit_rate.Numerator >> 24) & 0xFF),
+        (uint8_t) ((edit_rate.Numerator >> 16) & 0xFF),
+        (uint8_t) ((edit_rate.Numerator >> 8) & 0xFF),
+        (uint8_t) (edit_rate.Numerator & 0xFF),
+        (uint8_t) ((edit_rate.Denominator >> 24) & 0xFF),
+        (uint8_t) ((edit_rate.Denominator >> 16) & 0xFF),
+        (uint8_t) ((edit_rate.Denominator >> 8) & 0xFF),
+        (uint8_t) (edit_rate.Denominator & 0xFF),
+        (uint8_t) ((flags >> 24) & 0xFF),
+        (uint8_t) ((flags >> 16) & 0xFF),
+        (uint8_t) ((flags >> 8) & 0xFF),
+        (uint8_t) (flags & 0xFF),
+    };
+
+    write_fd(this->fd_, header.data(), header.size());
+}
+
+void MJCSink::write(uint32_t frame_number, const uint8_t* data, uint32_t size) {
+
+    uint8_t be_len[4] = {
+        (uint8_t) ((size >> 24) & 0xFF),
+        (uint8_t) ((size >> 16) & 0xFF),
+        (uint8_t) ((size >> 8) & 0xFF),
+        (uint8_t) (size & 0xFF)
+    };
+
+#ifdef WIN32
+
+    write_fd(this->fd_, be_len, sizeof be_len);
+
+    write_fd(this->fd_, data, size);
+
+#else
+
+    /* the length and the codestream are written with a single system call, without intermediate buffering */
+
+    struct iovec iov[2];
+
+    iov[0].iov_base = be_len;
+    iov[0].iov_len = sizeof be_len;
+    iov[1].iov_base = (void*) data;
+    iov[1].iov_len = size;
+
+    int iov_index = 0;
+
+    while (iov_index < 2) {
+
+        ssize_t sz = writev(this->fd_, iov + iov_index, 2 - iov_index);
+
+        if (sz < 0 && errno == EINTR) continue;
+
+        if (sz <= 0) {
+            throw std::runtime_error("Cannot write MJC frame");
+        }
+
+        /* resume after a partial write, which is common on pipes */
+
+        while (iov_index < 2 && (size_t) sz >= iov[iov_index].iov_len) {
+            sz -= iov[iov_index].iov_len;
+            iov_index++;
+        }
+
+        if (iov_index < 2) {
+            iov[iov_index].iov_base = (uint8_t*) iov[iov_index].iov_base + sz;
+            iov[iov_index].iov_len -= (size_t) sz;
+        }
+    }
+
+#endif
+}
+
+void MJCSink::copy(uint32_t frame_number, int fd, uint64_t offset, uint32_t size) {
+
+    uint8_t be_len[4] = {
+        (uint8_t) ((size >> 24) & 0xFF),
+        (uint8_t) ((size >> 16) & 0xFF),
+        (uint8_t) ((size >> 8) & 0xFF),
+        (uint8_t) (size & 0xFF)
+    };
+
+    write_fd(this->fd_, be_len, sizeof be_len);
+
+#ifdef __linux__
+
+    if (this->is_pipe_) {
+
+        /* splice() moves page cache pages of the input file into the pipe */
+
+        loff_t in_offset = (loff_t) offset;
+
+        while (size > 0) {
+
+            ssize_t sz = splice(fd, &in_offset, this->fd_, NULL, size, SPLICE_F_MOVE | SPLICE_F_MORE);
+
+            if (sz < 0 && errno == EINTR) continue;
+
+            if (sz <= 0) break;
+
+            size -= (uint32_t) sz;
+        }
+
+        offset = (uint64_t) in_offset;
+    }
+
+#endif
+
+    copy_fd_range(this->fd_, fd, offset, size);
+}
+
+void MJCSink::close() {
+
+    if (this->is_stdout_) {
+        return;
+    }
+
+#ifdef WIN32
+    int err = _close(this->fd_);
+#else
+    int err = ::close(this->fd_);
+#endif
+
+    if (err != 0) {
+        throw std::runtime_error("Cannot close MJC output");
+    }
+}
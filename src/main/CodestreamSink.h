@@ -0,0 +1,128 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_CODESTREAMSINK_H
+#define COM_SANDFLOW_CODESTREAMSINK_H
+
+#include <vector>
+#include <list>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <AS_DCP.h>
+
+class CodestreamSink {
+
+public:
+
+    virtual void write(uint32_t frame_number, const uint8_t* data, uint32_t size) = 0;
+
+    /* writes a codestream located at offset in the file fd without reading it into memory */
+
+    virtual void copy(uint32_t frame_number, int fd, uint64_t offset, uint32_t size) = 0;
+
+    virtual void close() = 0;
+    virtual ~CodestreamSink() {};
+};
+
+/* when files written to a J2C directory are flushed to storage */
+
+enum class FsyncPolicy {
+    NONE,       /* left to the operating system */
+    DEFERRED,   /* each file and the directory once all files have been written */
+    FILE        /* after each file is written */
+};
+
+class J2CDirectorySink : public CodestreamSink {
+
+public:
+
+    J2CDirectorySink(const std::string& dir_path,
+        unsigned int thread_count = 4,
+        FsyncPolicy fsync_policy = FsyncPolicy::NONE);
+
+    virtual void write(uint32_t frame_number, const uint8_t* data, uint32_t size);
+
+    virtual void copy(uint32_t frame_number, int fd, uint64_t offset, uint32_t size);
+
+    virtual void close();
+
+    virtual ~J2CDirectorySink();
+
+protected:
+
+    struct Job {
+        uint32_t frame_number;
+        std::vector<uint8_t> codestream;
+        int source_fd;              /* -1 if the codestream is held in memory */
+        uint64_t source_offset;
+        uint32_t source_size;
+    };
+
+    std::string dir_path_;
+    FsyncPolicy fsync_policy_;
+    size_t max_pending_;
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable job_ready_;
+    std::condition_variable job_done_;
+    std::list<Job> pending_;
+    std::list<Job> free_;
+    bool is_closing_;
+    std::string error_;
+    std::vector<std::string> written_paths_;   /* files to flush when FsyncPolicy::DEFERRED */
+
+    std::list<Job> _acquire_job();
+    void _submit_job(std::list<Job>& job);
+    void _run();
+    void _write_file(const Job& job);
+    void _check_error();
+};
+
+class MJCSink : public CodestreamSink {
+
+public:
+
+    /* creates the file at path, or writes to stdout if path is empty, and writes the MJC header */
+
+    MJCSink(const std::string& path, const ASDCP::Rational& edit_rate, uint32_t flags);
+
+    virtual void write(uint32_t frame_number, const uint8_t* data, uint32_t size);
+
+    virtual void copy(uint32_t frame_number, int fd, uint64_t offset, uint32_t size);
+
+    virtual void close();
+
+protected:
+
+    int fd_;
+    bool is_stdout_;
+    bool is_pipe_;
+};
+
+#endif
@@ -0,0 +1,299 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "DescriptorInfo.h"
+#include <stdexcept>
+#include <cstdio>
+#include <set>
+
+/* formatting of property values */
+
+static std::string format(ui8_t value) {
+    return std::to_string((unsigned int) value);
+}
+
+static std::string format(ui16_t value) {
+    return std::to_string(value);
+}
+
+static std::string format(ui32_t value) {
+    return std::to_string(value);
+}
+
+static std::string format(ui64_t value) {
+    return std::to_string(value);
+}
+
+static std::string format(i32_t value) {
+    return std::to_string(value);
+}
+
+static std::string format(const ASDCP::Rational& value) {
+    return std::to_string(value.Numerator) + "/" + std::to_string(value.Denominator);
+}
+
+static std::string hex(const byte_t* data, size_t size) {
+
+    std::string out;
+
+    char buf[3];
+
+    for (size_t i = 0; i < size; i++) {
+        snprintf(buf, sizeof buf, "%02x", data[i]);
+        out += buf;
+    }
+
+    return out;
+}
+
+static std::string format(const ASDCP::UL& value) {
+
+    const byte_t* ul = value.Value();
+
+    return "urn:smpte:ul:" + hex(ul, 4) + "." + hex(ul + 4, 4) + "." + hex(ul + 8, 4) + "." + hex(ul + 12, 4);
+}
+
+static std::string format(const ASDCP::MXF::Raw& value) {
+    return hex(value.RoData(), value.Length());
+}
+
+static std::string format(const ASDCP::MXF::RGBALayout& value) {
+
+    byte_t buf[ASDCP::MXF::RGBAValueLength];
+
+    Kumu::MemIOWriter writer(buf, sizeof buf);
+
+    if (!value.Archive(&writer)) {
+        throw std::runtime_error("Cannot read pixel layout");
+    }
+
+    return hex(buf, writer.Length());
+}
+
+static std::string format(const ASDCP::MXF::LineMapPair& value) {
+    return format(value.First) + " " + format(value.Second);
+}
+
+static std::string format(const ASDCP::MXF::ColorPrimary& value) {
+    return format(value.X) + " " + format(value.Y);
+}
+
+static std::string format(const ASDCP::MXF::ThreeColorPrimaries& value) {
+    return format(value.First) + " " + format(value.Second) + " " + format(value.Third);
+}
+
+template <class T> static std::string format(const ASDCP::MXF::optional_property<T>& value) {
+    return format(value.const_get());
+}
+
+template <class T> static bool is_present(const T&) {
+    return true;
+}
+
+template <class T> static bool is_present(const ASDCP::MXF::optional_property<T>& value) {
+    return !value.empty();
+}
+
+#define ADD_PROPERTY(SET, DESC, NAME) if (is_present((DESC).NAME)) this->_add(SET, #NAME, format((DESC).NAME))
+
+DescriptorInfo::DescriptorInfo(ASDCP::MXF::OP1aHeader& header) : fields_() {
+
+    ASDCP::MXF::InterchangeObject* obj = NULL;
+
+    if (header.GetMDObjectByType(header.m_Dict->ul(ASDCP::MDD_RGBAEssenceDescriptor), &obj).Success()) {
+
+        ASDCP::MXF::RGBAEssenceDescriptor& desc = *static_cast<ASDCP::MXF::RGBAEssenceDescriptor*>(obj);
+
+        const std::string set = "RGBAEssenceDescriptor";
+
+        this->_addPictureDescriptor(set, desc);
+
+        ADD_PROPERTY(set, desc, ComponentMaxRef);
+        ADD_PROPERTY(set, desc, ComponentMinRef);
+        ADD_PROPERTY(set, desc, AlphaMaxRef);
+        ADD_PROPERTY(set, desc, AlphaMinRef);
+        ADD_PROPERTY(set, desc, ScanningDirection);
+        ADD_PROPERTY(set, desc, PixelLayout);
+
+    } else if (header.GetMDObjectByType(header.m_Dict->ul(ASDCP::MDD_CDCIEssenceDescriptor), &obj).Success()) {
+
+        ASDCP::MXF::CDCIEssenceDescriptor& desc = *static_cast<ASDCP::MXF::CDCIEssenceDescriptor*>(obj);
+
+        const std::string set = "CDCIEssenceDescriptor";
+
+        this->_addPictureDescriptor(set, desc);
+
+        ADD_PROPERTY(set, desc, ComponentDepth);
+        ADD_PROPERTY(set, desc, HorizontalSubsampling);
+        ADD_PROPERTY(set, desc, VerticalSubsampling);
+        ADD_PROPERTY(set, desc, ColorSiting);
+        ADD_PROPERTY(set, desc, ReversedByteOrder);
+        ADD_PROPERTY(set, desc, PaddingBits);
+        ADD_PROPERTY(set, desc, AlphaSampleDepth);
+        ADD_PROPERTY(set, desc, BlackRefLevel);
+        ADD_PROPERTY(set, desc, WhiteReflevel);
+        ADD_PROPERTY(set, desc, ColorRange);
+
+    } else {
+
+        throw std::runtime_error("Cannot find the picture essence descriptor");
+    }
+
+    /* JPEG 2000 sub-descriptor */
+
+    ASDCP::MXF::GenericDescriptor* desc = static_cast<ASDCP::MXF::GenericDescriptor*>(obj);
+
+    for (const ASDCP::UUID& id : desc->SubDescriptors) {
+
+        ASDCP::MXF::InterchangeObject* sub_desc = NULL;
+
+        if (header.GetMDObjectByID(id, &sub_desc).Success() &&
+            sub_desc->IsA(header.m_Dict->ul(ASDCP::MDD_JPEG2000PictureSubDescriptor))) {
+            this->_addJ2KSubDescriptor(*static_cast<ASDCP::MXF::JPEG2000PictureSubDescriptor*>(sub_desc));
+        }
+    }
+}
+
+void DescriptorInfo::_add(const std::string& set, const std::string& name, const std::string& value) {
+
+    Field field;
+
+    field.set = set;
+    field.name = name;
+    field.value = value;
+
+    this->fields_.push_back(field);
+}
+
+void DescriptorInfo::_addPictureDescriptor(const std::string& set, ASDCP::MXF::GenericPictureEssenceDescriptor& desc) {
+
+    ADD_PROPERTY(set, desc, SampleRate);
+    ADD_PROPERTY(set, desc, ContainerDuration);
+    ADD_PROPERTY(set, desc, EssenceContainer);
+    ADD_PROPERTY(set, desc, Codec);
+    ADD_PROPERTY(set, desc, SignalStandard);
+    ADD_PROPERTY(set, desc, FrameLayout);
+    ADD_PROPERTY(set, desc, StoredWidth);
+    ADD_PROPERTY(set, desc, StoredHeight);
+    ADD_PROPERTY(set, desc, StoredF2Offset);
+    ADD_PROPERTY(set, desc, SampledWidth);
+    ADD_PROPERTY(set, desc, SampledHeight);
+    ADD_PROPERTY(set, desc, SampledXOffset);
+    ADD_PROPERTY(set, desc, SampledYOffset);
+    ADD_PROPERTY(set, desc, DisplayWidth);
+    ADD_PROPERTY(set, desc, DisplayHeight);
+    ADD_PROPERTY(set, desc, DisplayXOffset);
+    ADD_PROPERTY(set, desc, DisplayYOffset);
+    ADD_PROPERTY(set, desc, DisplayF2Offset);
+    ADD_PROPERTY(set, desc, AspectRatio);
+    ADD_PROPERTY(set, desc, ActiveFormatDescriptor);
+    ADD_PROPERTY(set, desc, VideoLineMap);
+    ADD_PROPERTY(set, desc, AlphaTransparency);
+    ADD_PROPERTY(set, desc, TransferCharacteristic);
+    ADD_PROPERTY(set, desc, ImageAlignmentOffset);
+    ADD_PROPERTY(set, desc, ImageStartOffset);
+    ADD_PROPERTY(set, desc, ImageEndOffset);
+    ADD_PROPERTY(set, desc, FieldDominance);
+    ADD_PROPERTY(set, desc, PictureEssenceCoding);
+    ADD_PROPERTY(set, desc, CodingEquations);
+    ADD_PROPERTY(set, desc, ColorPrimaries);
+    ADD_PROPERTY(set, desc, ActiveWidth);
+    ADD_PROPERTY(set, desc, ActiveHeight);
+    ADD_PROPERTY(set, desc, ActiveXOffset);
+    ADD_PROPERTY(set, desc, ActiveYOffset);
+    ADD_PROPERTY(set, desc, MasteringDisplayPrimaries);
+    ADD_PROPERTY(set, desc, MasteringDisplayWhitePointChromaticity);
+    ADD_PROPERTY(set, desc, MasteringDisplayMaximumLuminance);
+    ADD_PROPERTY(set, desc, MasteringDisplayMinimumLuminance);
+}
+
+void DescriptorInfo::_addJ2KSubDescriptor(ASDCP::MXF::JPEG2000PictureSubDescriptor& desc) {
+
+    const std::string set = "JPEG2000PictureSubDescriptor";
+
+    ADD_PROPERTY(set, desc, Rsize);
+    ADD_PROPERTY(set, desc, Xsize);
+    ADD_PROPERTY(set, desc, Ysize);
+    ADD_PROPERTY(set, desc, XOsize);
+    ADD_PROPERTY(set, desc, YOsize);
+    ADD_PROPERTY(set, desc, XTsize);
+    ADD_PROPERTY(set, desc, YTsize);
+    ADD_PROPERTY(set, desc, XTOsize);
+    ADD_PROPERTY(set, desc, YTOsize);
+    ADD_PROPERTY(set, desc, Csize);
+    ADD_PROPERTY(set, desc, PictureComponentSizing);
+    ADD_PROPERTY(set, desc, CodingStyleDefault);
+    ADD_PROPERTY(set, desc, QuantizationDefault);
+    ADD_PROPERTY(set, desc, J2CLayout);
+}
+
+const std::vector<DescriptorInfo::Field>& DescriptorInfo::fields() const {
+    return this->fields_;
+}
+
+const DescriptorInfo::Field* DescriptorInfo::_find(const std::string& set, const std::string& name) const {
+
+    for (const Field& field : this->fields_) {
+        if (field.set == set && field.name == name) return &field;
+    }
+
+    return NULL;
+}
+
+std::string DescriptorInfo::value(const std::string& set, const std::string& name) const {
+
+    const Field* field = this->_find(set, name);
+
+    return field ? field->value : std::string();
+}
+
+std::vector<std::string> DescriptorInfo::compare(const DescriptorInfo& ref, const DescriptorInfo& other,
+    const std::set<std::string>& ignored_fields) {
+
+    std::vector<std::string> differences;
+
+    for (const Field& field : ref.fields_) {
+
+        if (ignored_fields.count(field.name)) continue;
+
+        const Field* other_field = other._find(field.set, field.name);
+
+        if (!other_field) {
+            differences.push_back(field.set + "." + field.name + ": " + field.value + " != (absent)");
+        } else if (other_field->value != field.value) {
+            differences.push_back(field.set + "." + field.name + ": " + field.value + " != " + other_field->value);
+        }
+    }
+
+    for (const Field& other_field : other.fields_) {
+        if (ignored_fields.count(other_field.name)) continue;
+        if (!ref._find(other_field.set, other_field.name)) {
+            differences.push_back(other_field.set + "." + other_field.name + ": (absent) != " + other_field.value);
+        }
+    }
+
+    return differences;
+}
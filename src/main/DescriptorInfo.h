@@ -0,0 +1,76 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_DESCRIPTORINFO_H
+#define COM_SANDFLOW_DESCRIPTORINFO_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <Metadata.h>
+
+/* fields of the picture essence descriptor and JPEG 2000 sub-descriptor of a track file, formatted as text: integers
+   in decimal, rationals as <numerator>/<denominator>, labels as URNs and other values in hexadecimal. Optional
+   fields are listed only if present. */
+
+class DescriptorInfo {
+
+public:
+
+    struct Field {
+        std::string set;        /* name of the metadata set, e.g. RGBAEssenceDescriptor */
+        std::string name;
+        std::string value;
+    };
+
+    explicit DescriptorInfo(ASDCP::MXF::OP1aHeader& header);
+
+    const std::vector<Field>& fields() const;
+
+    /* returns the value of a field, or an empty string if absent */
+
+    std::string value(const std::string& set, const std::string& name) const;
+
+    /* lists the fields that are absent from or differ between two files, except those whose names are in
+       ignored_fields */
+
+    static std::vector<std::string> compare(const DescriptorInfo& ref, const DescriptorInfo& other,
+        const std::set<std::string>& ignored_fields = std::set<std::string>());
+
+protected:
+
+    std::vector<Field> fields_;
+
+    void _add(const std::string& set, const std::string& name, const std::string& value);
+
+    void _addPictureDescriptor(const std::string& set, ASDCP::MXF::GenericPictureEssenceDescriptor& desc);
+
+    void _addJ2KSubDescriptor(ASDCP::MXF::JPEG2000PictureSubDescriptor& desc);
+
+    const Field* _find(const std::string& set, const std::string& name) const;
+};
+
+#endif
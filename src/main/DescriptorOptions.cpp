@@ -0,0 +1,210 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "DescriptorOptions.h"
+
+/* hard-coded UL definitions */
+
+static std::array<uint8_t, 16> CodingEquations_ITU601 = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x01, 0x04, 0x01, 0x01, 0x01, 0x02, 0x01, 0x00, 0x00 };
+static std::array<uint8_t, 16> CodingEquations_ITU709 = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x01, 0x04, 0x01, 0x01, 0x01, 0x02, 0x02, 0x00, 0x00 };
+static std::array<uint8_t, 16> CodingEquations_ITU2020_NCL = { 0x06, 0x0e, 0x2b, 0x34, 04, 0x01, 0x01, 0x0d, 0x04, 0x01, 0x01, 0x01, 0x02, 0x06, 0x00, 0x00 };
+
+static std::array<uint8_t, 16> TransferCharacteristic_ITU709 = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x01, 0x04, 0x01, 0x01, 0x01, 0x01, 0x02, 0x00, 0x00 };
+static std::array<uint8_t, 16> TransferCharacteristic_IEC6196624_xvYCC = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x0d, 0x04, 0x01, 0x01, 0x01, 0x01, 0x08, 0x00, 0x00 };
+static std::array<uint8_t, 16> TransferCharacteristic_ITU2020 = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x0e, 0x04, 0x01, 0x01, 0x01, 0x01, 0x09, 0x00, 0x00 };
+static std::array<uint8_t, 16> TransferCharacteristic_SMPTEST2084 = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x0d, 0x04, 0x01, 0x01, 0x01, 0x01, 0x0a, 0x00, 0x00 };
+static std::array<uint8_t, 16> TransferCharacteristic_CinemaMezzanine_DCDM = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x0d, 0x04, 0x01, 0x01, 0x01, 0x01, 0x13, 0x00, 0x00 };
+
+static std::array<uint8_t, 16> ColorPrimaries_SMPTE170M = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x06, 0x04, 0x01, 0x01, 0x01, 0x03, 0x01, 0x00, 0x00 };
+static std::array<uint8_t, 16> ColorPrimaries_ITU470_PAL = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x06, 0x04, 0x01, 0x01, 0x01, 0x03, 0x02, 0x00, 0x00 };
+static std::array<uint8_t, 16> ColorPrimaries_ITU709 = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x06, 0x04, 0x01, 0x01, 0x01, 0x03, 0x03, 0x00, 0x00 };
+static std::array<uint8_t, 16> ColorPrimaries_ITU2020 = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x0d, 0x04, 0x01, 0x01, 0x01, 0x03, 0x04, 0x00, 0x00 };
+static std::array<uint8_t, 16> ColorPrimaries_P3D65 = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x0d, 0x04, 0x01, 0x01, 0x01, 0x03, 0x06, 0x00, 0x00 };
+static std::array<uint8_t, 16> ColorPrimaries_CinemaMezzanine = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x0d, 0x04, 0x01, 0x01, 0x01, 0x03, 0x08, 0x00, 0x00 };
+
+std::map<std::string, EnumeratedColorimetry*> EnumeratedColorimetry::colors_;
+const EnumeratedColorimetry EnumeratedColorimetry::COLOR_1("COLOR.1", TransferCharacteristic_ITU709, ColorPrimaries_ITU470_PAL, CodingEquations_ITU601);
+const EnumeratedColorimetry EnumeratedColorimetry::COLOR_2("COLOR.2", TransferCharacteristic_ITU709, ColorPrimaries_SMPTE170M, CodingEquations_ITU601);
+const EnumeratedColorimetry EnumeratedColorimetry::COLOR_3("COLOR.3", TransferCharacteristic_ITU709, ColorPrimaries_ITU709, CodingEquations_ITU709);
+const EnumeratedColorimetry EnumeratedColorimetry::COLOR_4("COLOR.4", TransferCharacteristic_IEC6196624_xvYCC, ColorPrimaries_SMPTE170M, CodingEquations_ITU601);
+const EnumeratedColorimetry EnumeratedColorimetry::COLOR_5("COLOR.5", TransferCharacteristic_ITU2020, ColorPrimaries_ITU2020, CodingEquations_ITU2020_NCL);
+const EnumeratedColorimetry EnumeratedColorimetry::COLOR_6("COLOR.6", TransferCharacteristic_SMPTEST2084, ColorPrimaries_P3D65, CodingEquations_ITU2020_NCL /* not used */);
+const EnumeratedColorimetry EnumeratedColorimetry::COLOR_7("COLOR.7", TransferCharacteristic_SMPTEST2084, ColorPrimaries_ITU2020, CodingEquations_ITU2020_NCL);
+const EnumeratedColorimetry EnumeratedColorimetry::COLOR_APP4_2("COLOR.APP4.2", TransferCharacteristic_CinemaMezzanine_DCDM, ColorPrimaries_CinemaMezzanine, CodingEquations_ITU2020_NCL /* not used */);
+
+bool operator==(const EnumeratedColorimetry& lhs, const EnumeratedColorimetry& rhs) { return &lhs == &rhs; }
+
+bool operator!=(const EnumeratedColorimetry& lhs, const EnumeratedColorimetry& rhs) { return !(lhs == rhs); }
+
+const EnumeratedColorimetry* EnumeratedColorimetry::fromDescriptor(ASDCP::MXF::GenericPictureEssenceDescriptor& desc) {
+
+    if (desc.TransferCharacteristic.empty() || desc.ColorPrimaries.empty()) {
+        return NULL;
+    }
+
+    /* the transfer characteristic and color primaries pair is unique to each colorimetry */
+
+    for (const std::pair<const std::string, EnumeratedColorimetry*>& pair : EnumeratedColorimetry::colors_) {
+
+        if (desc.TransferCharacteristic.get() == ASDCP::UL(pair.second->transfer_characteristic().data()) &&
+            desc.ColorPrimaries.get() == ASDCP::UL(pair.second->color_primaries().data())) {
+            return pair.second;
+        }
+    }
+
+    return NULL;
+}
+
+void set_colorimetry(ASDCP::MXF::GenericPictureEssenceDescriptor& desc, const EnumeratedColorimetry& color) {
+
+    /* the descriptor may have been built in memory rather than parsed, so its key cannot be relied on */
+
+    if (dynamic_cast<ASDCP::MXF::CDCIEssenceDescriptor*>(&desc)) {
+        desc.CodingEquations = color.coding_equations().data();
+    }
+
+    desc.TransferCharacteristic = color.transfer_characteristic().data();
+
+    desc.ColorPrimaries = color.color_primaries().data();
+}
+
+boost::program_options::options_description descriptor_options() {
+
+    boost::program_options::options_description opts{ "Essence descriptor options" };
+
+    opts.add_options()
+        ("active_area", boost::program_options::value<std::vector<ui32_t>>()->multitoken(), "Active area rectangle (in pixels): x_offset y_offset width height")
+        ("display_area", boost::program_options::value<std::vector<ui32_t>>()->multitoken(), "Display rectangle (in pixels): x_offset y_offset width height")
+        ("mastering_display_primaries", boost::program_options::value<std::vector<ui16_t>>()->multitoken(), "Mastering Display Primaries: x_0 y_0 x_1 y_1 x_2 y_2")
+        ("mastering_display_white_point_chroma", boost::program_options::value<std::vector<ui16_t>>()->multitoken(), "Mastering Display White Point Chromaticity: x y")
+        ("mastering_display_max_luminance", boost::program_options::value<ui32_t>(), "Mastering Display Maximum Luminance")
+        ("mastering_display_min_luminance", boost::program_options::value<ui32_t>(), "Mastering Display Minimum Luminance");
+
+    return opts;
+}
+
+void apply_descriptor_options(ASDCP::MXF::GenericPictureEssenceDescriptor& desc,
+    const boost::program_options::variables_map& cli_args,
+    const EnumeratedColorimetry& color) {
+
+    if (cli_args.count("display_area")) {
+
+        std::vector<ui32_t> display_rectangle = cli_args["display_area"].as<std::vector<ui32_t>>();
+
+        if (display_rectangle.size() != 4) {
+            throw std::runtime_error("Display area must consist of exactly four positive integer values");
+        }
+
+        desc.DisplayXOffset = display_rectangle[0];
+        desc.DisplayYOffset = display_rectangle[1];
+        desc.DisplayWidth = display_rectangle[2];
+        desc.DisplayHeight = display_rectangle[3];
+
+        if (desc.DisplayXOffset.get() + desc.DisplayWidth.get() > desc.StoredWidth ||
+            desc.DisplayYOffset.get() + desc.DisplayHeight.get() > desc.StoredHeight) {
+            throw std::runtime_error("Display area does not fit within the stored rectangle");
+        }
+    }
+
+    if (cli_args.count("active_area")) {
+
+        std::vector<ui32_t> active_rectangle = cli_args["active_area"].as<std::vector<ui32_t>>();
+
+        if (active_rectangle.size() != 4) {
+            throw std::runtime_error("Active area must consist of exactly four positive integer values");
+        }
+
+        desc.ActiveXOffset = active_rectangle[0];
+        desc.ActiveYOffset = active_rectangle[1];
+        desc.ActiveWidth = active_rectangle[2];
+        desc.ActiveHeight = active_rectangle[3];
+
+        int display_width = desc.DisplayWidth.empty() ? desc.StoredWidth : desc.DisplayWidth.get();
+        int display_height = desc.DisplayHeight.empty() ? desc.StoredHeight : desc.DisplayHeight.get();
+
+        if (desc.ActiveXOffset.get() + desc.ActiveWidth.get() > display_width ||
+            desc.ActiveYOffset.get() + desc.ActiveHeight.get() > display_height) {
+            throw std::runtime_error("Active area does not fit within the display rectangle");
+        }
+    }
+
+    /* Mastering Display Color Volume Metadata */
+
+    if (cli_args.count("mastering_display_primaries") ||
+        cli_args.count("mastering_display_white_point_chroma") ||
+        cli_args.count("mastering_display_max_luminance") ||
+        cli_args.count("mastering_display_min_luminance")) {
+
+        if (cli_args.count("mastering_display_primaries") != 1 ||
+            cli_args.count("mastering_display_white_point_chroma") != 1 ||
+            cli_args.count("mastering_display_max_luminance") != 1 ||
+            cli_args.count("mastering_display_min_luminance") != 1
+            ) {
+        
+            throw std::runtime_error("All Mastering Display Color Volume Metadata items must be defined");
+
+        }
+
+        std::vector<ui16_t> mastering_display_primaries = cli_args["mastering_display_primaries"].as<std::vector<ui16_t>>();
+
+        if (mastering_display_primaries.size() != 6) {
+            throw std::runtime_error("Mastering display primaries must consist of exactly 6 positive integer values");
+        }
+
+        ASDCP::MXF::ColorPrimary p1(mastering_display_primaries[0], mastering_display_primaries[1]);
+        ASDCP::MXF::ColorPrimary p2(mastering_display_primaries[2], mastering_display_primaries[3]);
+        ASDCP::MXF::ColorPrimary p3(mastering_display_primaries[4], mastering_display_primaries[5]);
+
+        desc.MasteringDisplayPrimaries = ASDCP::MXF::ThreeColorPrimaries(p1, p2, p3);
+
+        std::vector<ui16_t> mastering_display_white_point_chroma = cli_args["mastering_display_white_point_chroma"].as<std::vector<ui16_t>>();
+
+        if (mastering_display_white_point_chroma.size() != 2) {
+            throw std::runtime_error("Mastering Display White Point Chromaticity must consist of exactly 2 positive integer values");
+        }
+
+        desc.MasteringDisplayWhitePointChromaticity = ASDCP::MXF::ColorPrimary(mastering_display_white_point_chroma[0], mastering_display_white_point_chroma[1]);
+
+        desc.MasteringDisplayMinimumLuminance = cli_args["mastering_display_min_luminance"].as<ui32_t>();
+        desc.MasteringDisplayMaximumLuminance = cli_args["mastering_display_max_luminance"].as<ui32_t>();
+
+    }
+
+    /* existing metadata is also checked, since the colorimetry of an existing descriptor can be changed */
+
+    if (!desc.MasteringDisplayPrimaries.empty()) {
+
+        if (! (color == EnumeratedColorimetry::COLOR_3 ||
+            color == EnumeratedColorimetry::COLOR_5 ||
+            color == EnumeratedColorimetry::COLOR_6 ||
+            color == EnumeratedColorimetry::COLOR_7)
+            ) {
+
+            throw std::runtime_error("Mastering Display Color Volume Metadata can only be used with COLOR.3, COLOR.5, COLOR.6 or COLOR.7");
+
+        }
+    }
+}
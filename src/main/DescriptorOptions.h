@@ -0,0 +1,141 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_DESCRIPTOROPTIONS_H
+#define COM_SANDFLOW_DESCRIPTOROPTIONS_H
+
+#include <Metadata.h>
+#include <boost/program_options.hpp>
+#include <array>
+#include <map>
+#include <string>
+#include <sstream>
+#include <stdexcept>
+
+/* enumeration of supported colorimetry */
+
+class EnumeratedColorimetry {
+public:
+
+    /* defined colorimetry values */
+
+    static const EnumeratedColorimetry COLOR_1;
+    static const EnumeratedColorimetry COLOR_2;
+    static const EnumeratedColorimetry COLOR_3;
+    static const EnumeratedColorimetry COLOR_4;
+    static const EnumeratedColorimetry COLOR_5;
+    static const EnumeratedColorimetry COLOR_6;
+    static const EnumeratedColorimetry COLOR_7;
+    static const EnumeratedColorimetry COLOR_APP4_2;
+
+    static const EnumeratedColorimetry& fromString(const std::string s) {
+
+        auto i = EnumeratedColorimetry::colors_.find(s);
+
+        if (i == EnumeratedColorimetry::colors_.cend()) {
+            throw std::runtime_error("Unknown colorimetry");
+        }
+
+        return *(i->second);
+    }
+
+    /* colorimetry signaled by an existing essence descriptor, or NULL if it is not one of the defined values */
+
+    static const EnumeratedColorimetry* fromDescriptor(ASDCP::MXF::GenericPictureEssenceDescriptor& desc);
+
+    static std::string usage() {
+        std::stringstream ss;
+
+        ss << "Colorspace:" << std::endl;
+
+        for (auto pair : EnumeratedColorimetry::colors_) {
+            ss << pair.first << std::endl;
+        }
+
+        return ss.str();
+    }
+
+    const std::string& symbol() const {
+        return this->symbol_;
+    }
+
+    const std::array<uint8_t, 16>& transfer_characteristic() const {
+        return this->transfer_characteristic_;
+    }
+
+    const std::array<uint8_t, 16>& color_primaries() const {
+        return this->color_primaries_;
+    }
+
+    const std::array<uint8_t, 16>& coding_equations() const {
+        return this->coding_equations_;
+    }
+
+private:
+
+    EnumeratedColorimetry(const std::string& symbol,
+        const std::array<uint8_t, 16>& transfer_characteristic,
+        const std::array<uint8_t, 16>& color_primaries,
+        const std::array<uint8_t, 16>& coding_equations) :
+        symbol_(symbol),
+        transfer_characteristic_(transfer_characteristic),
+        color_primaries_(color_primaries),
+        coding_equations_(coding_equations) {
+        if (!this->colors_.insert(std::make_pair(this->symbol_, this)).second) {
+            throw std::runtime_error("Existing colorimetry");
+        }
+    }
+
+    static std::map<std::string, EnumeratedColorimetry*> colors_;
+
+    std::string symbol_;
+
+    std::array<uint8_t, 16> transfer_characteristic_;
+    std::array<uint8_t, 16> color_primaries_;
+    std::array<uint8_t, 16> coding_equations_;
+};
+
+bool operator==(const EnumeratedColorimetry& lhs, const EnumeratedColorimetry& rhs);
+
+bool operator!=(const EnumeratedColorimetry& lhs, const EnumeratedColorimetry& rhs);
+
+/* sets the transfer characteristic, color primaries and, for CDCI descriptors, coding equations */
+
+void set_colorimetry(ASDCP::MXF::GenericPictureEssenceDescriptor& desc, const EnumeratedColorimetry& color);
+
+/* command line options for the display and active areas and the mastering display color volume metadata, shared by
+   the tools that author essence descriptors */
+
+boost::program_options::options_description descriptor_options();
+
+/* applies the options above to an essence descriptor whose stored rectangle is set, checking them against its
+   geometry and colorimetry */
+
+void apply_descriptor_options(ASDCP::MXF::GenericPictureEssenceDescriptor& desc,
+    const boost::program_options::variables_map& cli_args,
+    const EnumeratedColorimetry& color);
+
+#endif
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "DirectReader.h"
+#include <stdexcept>
+#include <cstdlib>
+
+#ifdef WIN32
+#include <io.h>
+#include <malloc.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+DirectReader::DirectReader(const std::string& path, uint32_t alignment) :
+    fd_(-1),
+    alignment_(alignment),
+    buffer_(NULL),
+    capacity_(0)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        throw std::runtime_error("Alignment must be a power of 2");
+    }
+
+#if defined(WIN32)
+    this->fd_ = _open(path.c_str(), _O_RDONLY | _O_BINARY);
+#elif defined(O_DIRECT)
+    this->fd_ = open(path.c_str(), O_RDONLY | O_DIRECT);
+
+    /* some file systems, e.g. tmpfs, do not support direct I/O */
+
+    if (this->fd_ < 0 && errno == EINVAL) {
+        this->fd_ = open(path.c_str(), O_RDONLY);
+    }
+#else
+    this->fd_ = open(path.c_str(), O_RDONLY);
+#endif
+
+    if (this->fd_ < 0) {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+
+#if defined(F_NOCACHE)
+    fcntl(this->fd_, F_NOCACHE, 1);
+#endif
+}
+
+DirectReader::~DirectReader() {
+
+#ifdef WIN32
+    _aligned_free(this->buffer_);
+    _close(this->fd_);
+#else
+    free(this->buffer_);
+    close(this->fd_);
+#endif
+}
+
+const uint8_t* DirectReader::read(uint64_t offset, uint64_t size) {
+
+    /* direct reads start and end on block boundaries */
+
+    const uint64_t start = offset & ~((uint64_t) this->alignment_ - 1);
+
+    const uint64_t end = (offset + size + this->alignment_ - 1) & ~((uint64_t) this->alignment_ - 1);
+
+    if (end - start > SIZE_MAX) {
+        throw std::runtime_error("Read is too large");
+    }
+
+    const size_t length = (size_t) (end - start);
+
+    if (length > this->capacity_) {
+
+        void* buffer = NULL;
+
+#ifdef WIN32
+        _aligned_free(this->buffer_);
+
+        buffer = _aligned_malloc(length, this->alignment_);
+#else
+        free(this->buffer_);
+
+        if (posix_memalign(&buffer, this->alignment_, length) != 0) {
+            buffer = NULL;
+        }
+#endif
+
+        this->buffer_ = (uint8_t*) buffer;
+
+        this->capacity_ = this->buffer_ ? length : 0;
+
+        if (!this->buffer_) {
+            throw std::runtime_error("Cannot allocate read buffer");
+        }
+    }
+
+    /* the last block of the file may be partial */
+
+    const size_t needed = (size_t) (offset + size - start);
+
+    size_t count = 0;
+
+    while (count < needed) {
+
+#ifdef WIN32
+        if (_lseeki64(this->fd_, (__int64) (start + count), SEEK_SET) < 0) {
+            throw std::runtime_error("Cannot seek in file");
+        }
+
+        int sz = _read(this->fd_, this->buffer_ + count, (unsigned int) (length - count));
+#else
+        ssize_t sz = pread(this->fd_, this->buffer_ + count, length - count, (off_t) (start + count));
+
+        if (sz < 0 && errno == EINTR) continue;
+#endif
+
+        if (sz <= 0) {
+            throw std::runtime_error("Cannot read from file");
+        }
+
+        count += (size_t) sz;
+    }
+
+    return this->buffer_ + (offset - start);
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_DIRECTREADER_H
+#define COM_SANDFLOW_DIRECTREADER_H
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+/* reads byte ranges of a file into a block-aligned buffer, bypassing the page cache (O_DIRECT on Linux, F_NOCACHE
+   on macOS). Ranges that start and end on block boundaries are read with no additional bytes. */
+
+class DirectReader {
+
+public:
+
+    DirectReader(const std::string& path, uint32_t alignment = 4096);
+
+    ~DirectReader();
+
+    DirectReader(const DirectReader&) = delete;
+
+    DirectReader& operator=(const DirectReader&) = delete;
+
+    /* returns size bytes at offset, which remain valid until the next call */
+
+    const uint8_t* read(uint64_t offset, uint64_t size);
+
+protected:
+
+    int fd_;
+    uint32_t alignment_;
+    uint8_t* buffer_;
+    size_t capacity_;
+};
+
+#endif
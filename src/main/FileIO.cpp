@@ -0,0 +1,251 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "FileIO.h"
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+
+#ifdef WIN32
+#include <io.h>
+#include <mutex>
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+void write_fd(int fd, const void* data, size_t size) {
+
+#ifdef WIN32
+
+    const char* p = (const char*) data;
+
+    while (size > 0) {
+
+        int sz = _write(fd, p, (unsigned int) std::min(size, (size_t) 0x40000000));
+
+        if (sz <= 0) {
+            throw std::runtime_error("Cannot write to file");
+        }
+
+        p += sz;
+        size -= (size_t) sz;
+    }
+
+#else
+
+    const uint8_t* p = (const uint8_t*) data;
+
+    while (size > 0) {
+
+        ssize_t sz = write(fd, p, size);
+
+        if (sz < 0 && errno == EINTR) continue;
+
+        if (sz <= 0) {
+            throw std::runtime_error("Cannot write to file");
+        }
+
+        p += sz;
+        size -= (size_t) sz;
+    }
+
+#endif
+}
+
+void read_fd_at(int fd, void* data, size_t size, uint64_t offset) {
+
+#ifdef WIN32
+
+    /* there is no positional read, so concurrent readers are serialized around the seek */
+
+    static std::mutex seek_mutex;
+
+    std::lock_guard<std::mutex> lock(seek_mutex);
+
+    if (_lseeki64(fd, (__int64) offset, SEEK_SET) < 0) {
+        throw std::runtime_error("Cannot seek in file");
+    }
+
+    char* p = (char*) data;
+
+    while (size > 0) {
+
+        int sz = _read(fd, p, (unsigned int) std::min(size, (size_t) 0x40000000));
+
+        if (sz <= 0) {
+            throw std::runtime_error("Cannot read from file");
+        }
+
+        p += sz;
+        size -= (size_t) sz;
+    }
+
+#else
+
+    uint8_t* p = (uint8_t*) data;
+
+    while (size > 0) {
+
+        ssize_t sz = pread(fd, p, size, (off_t) offset);
+
+        if (sz < 0 && errno == EINTR) continue;
+
+        if (sz <= 0) {
+            throw std::runtime_error("Cannot read from file");
+        }
+
+        p += sz;
+        offset += (uint64_t) sz;
+        size -= (size_t) sz;
+    }
+
+#endif
+}
+
+void copy_fd_range(int out_fd, int in_fd, uint64_t offset, uint64_t size) {
+
+#ifdef __linux__
+
+    loff_t in_offset = (loff_t) offset;
+
+    /* copy_file_range() shares extents on file systems that support reflinks (XFS, Btrfs) and otherwise copies
+       within the kernel; it fails with EXDEV or EINVAL across file systems on older kernels or when out_fd is a pipe */
+
+    while (size > 0) {
+
+        ssize_t sz = copy_file_range(in_fd, &in_offset, out_fd, NULL, (size_t) size, 0);
+
+        if (sz < 0 && errno == EINTR) continue;
+
+        if (sz <= 0) break;
+
+        size -= (uint64_t) sz;
+    }
+
+    /* sendfile() writes to any file descriptor, including pipes and sockets */
+
+    off_t sendfile_offset = (off_t) in_offset;
+
+    while (size > 0) {
+
+        ssize_t sz = sendfile(out_fd, in_fd, &sendfile_offset, (size_t) size);
+
+        if (sz < 0 && errno == EINTR) continue;
+
+        if (sz <= 0) break;
+
+        size -= (uint64_t) sz;
+    }
+
+    offset = (uint64_t) sendfile_offset;
+
+#endif
+
+    /* copy through user space */
+
+    std::vector<uint8_t> buf((size_t) std::min(size, (uint64_t) 1024 * 1024));
+
+    while (size > 0) {
+
+        size_t sz = (size_t) std::min(size, (uint64_t) buf.size());
+
+        read_fd_at(in_fd, buf.data(), sz, offset);
+
+        write_fd(out_fd, buf.data(), sz);
+
+        offset += sz;
+        size -= sz;
+    }
+}
+
+bool replace_file(const std::string& from_path, const std::string& to_path) {
+
+#ifdef WIN32
+
+    /* rename() does not replace existing files on Windows */
+
+    return MoveFileExA(from_path.c_str(), to_path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+
+#else
+
+    return rename(from_path.c_str(), to_path.c_str()) == 0;
+
+#endif
+}
+
+std::string make_temp_file() {
+
+#ifdef WIN32
+
+    char* path = _tempnam(NULL, "jid");
+
+    if (!path) {
+        throw std::runtime_error("Cannot create temporary file");
+    }
+
+    std::string temp_path(path);
+
+    free(path);
+
+    FILE* f = fopen(temp_path.c_str(), "wb");
+
+    if (!f) {
+        throw std::runtime_error("Cannot create temporary file");
+    }
+
+    fclose(f);
+
+    return temp_path;
+
+#else
+
+    const char* dir = getenv("TMPDIR");
+
+    std::string temp_path = std::string(dir && *dir ? dir : "/tmp") + "/jid-XXXXXX";
+
+    int fd = mkstemp(&temp_path[0]);
+
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create temporary file");
+    }
+
+    close(fd);
+
+    return temp_path;
+
+#endif
+}
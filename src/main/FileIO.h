@@ -0,0 +1,55 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_FILEIO_H
+#define COM_SANDFLOW_FILEIO_H
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+/* writes all bytes to a file descriptor, retrying partial writes */
+
+void write_fd(int fd, const void* data, size_t size);
+
+/* reads exactly size bytes at offset from a file descriptor; safe to call concurrently on the same descriptor */
+
+void read_fd_at(int fd, void* data, size_t size, uint64_t offset);
+
+/* copies size bytes at offset of in_fd to the current position of out_fd, within the kernel if possible */
+
+void copy_fd_range(int out_fd, int in_fd, uint64_t offset, uint64_t size);
+
+/* atomically replaces the file at to_path with the file at from_path, which must be on the same file system; returns
+   false on failure, in which case both files are left unchanged */
+
+bool replace_file(const std::string& from_path, const std::string& to_path);
+
+/* creates an empty file in the temporary directory and returns its path */
+
+std::string make_temp_file();
+
+#endif
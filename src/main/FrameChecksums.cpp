@@ -0,0 +1,261 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "FrameChecksums.h"
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CRC32C_SSE42
+#include <nmmintrin.h>
+#include <cpuid.h>
+#elif defined(_M_X64)
+#define CRC32C_SSE42
+#include <nmmintrin.h>
+#include <intrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#define CRC32C_ARMV8
+#include <arm_acle.h>
+#endif
+
+/* table-driven implementation, processing one byte at a time */
+
+static uint32_t crc32c_table[256];
+
+static bool crc32c_init_table() {
+
+    for (uint32_t i = 0; i < 256; i++) {
+
+        uint32_t c = i;
+
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? (c >> 1) ^ 0x82F63B78 : c >> 1;
+        }
+
+        crc32c_table[i] = c;
+    }
+
+    return true;
+}
+
+static uint32_t crc32c_sw(uint32_t crc, const uint8_t* p, size_t size) {
+
+    static const bool is_table_init = crc32c_init_table();
+
+    (void) is_table_init;
+
+    while (size--) {
+        crc = crc32c_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+
+    return crc;
+}
+
+#if defined(CRC32C_SSE42)
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("sse4.2")))
+#endif
+static uint32_t crc32c_hw(uint32_t crc, const uint8_t* p, size_t size) {
+
+    uint64_t c = crc;
+
+    for (; size >= 8; p += 8, size -= 8) {
+
+        uint64_t v;
+
+        memcpy(&v, p, 8);
+
+        c = _mm_crc32_u64(c, v);
+    }
+
+    crc = (uint32_t) c;
+
+    for (; size > 0; p++, size--) {
+        crc = _mm_crc32_u8(crc, *p);
+    }
+
+    return crc;
+}
+
+static bool crc32c_has_hw() {
+
+#if defined(_M_X64)
+    int info[4];
+
+    __cpuid(info, 1);
+
+    return (info[2] & (1 << 20)) != 0;
+#else
+    unsigned int eax, ebx, ecx, edx;
+
+    return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_2) != 0;
+#endif
+}
+
+#elif defined(CRC32C_ARMV8)
+
+static uint32_t crc32c_hw(uint32_t crc, const uint8_t* p, size_t size) {
+
+    for (; size >= 8; p += 8, size -= 8) {
+
+        uint64_t v;
+
+        memcpy(&v, p, 8);
+
+        crc = __crc32cd(crc, v);
+    }
+
+    for (; size > 0; p++, size--) {
+        crc = __crc32cb(crc, *p);
+    }
+
+    return crc;
+}
+
+static bool crc32c_has_hw() {
+    return true;
+}
+
+#endif
+
+uint32_t crc32c(const uint8_t* data, size_t size, uint32_t crc) {
+
+    crc = ~crc;
+
+#if defined(CRC32C_SSE42) || defined(CRC32C_ARMV8)
+
+    static const bool has_hw = crc32c_has_hw();
+
+    if (has_hw) return ~crc32c_hw(crc, data, size);
+
+#endif
+
+    return ~crc32c_sw(crc, data, size);
+}
+
+/* sidecar file */
+
+static const char SIDECAR_SIGNATURE[8] = { 'J', 'I', 'D', 'S', 'U', 'M', 'S', '\n' };
+
+static const uint32_t SIDECAR_VERSION = 1;
+
+static const uint32_t SIDECAR_ALGORITHM_CRC32C = 1;
+
+static void write_le(uint8_t* p, uint64_t v, int size) {
+    for (int i = 0; i < size; i++) {
+        p[i] = (uint8_t) (v >> (8 * i));
+    }
+}
+
+static uint64_t read_le(const uint8_t* p, int size) {
+
+    uint64_t v = 0;
+
+    for (int i = size - 1; i >= 0; i--) {
+        v = (v << 8) | p[i];
+    }
+
+    return v;
+}
+
+FrameChecksums::FrameChecksums() : checksums_() {}
+
+void FrameChecksums::append(uint32_t checksum) {
+    this->checksums_.push_back(checksum);
+}
+
+uint32_t FrameChecksums::size() const {
+    return (uint32_t) this->checksums_.size();
+}
+
+uint32_t FrameChecksums::at(uint32_t frame) const {
+    return this->checksums_.at(frame);
+}
+
+void FrameChecksums::save(const std::string& path) const {
+
+    std::vector<uint8_t> buf(24 + 4 * this->checksums_.size());
+
+    memcpy(buf.data(), SIDECAR_SIGNATURE, sizeof SIDECAR_SIGNATURE);
+    write_le(buf.data() + 8, SIDECAR_VERSION, 4);
+    write_le(buf.data() + 12, SIDECAR_ALGORITHM_CRC32C, 4);
+    write_le(buf.data() + 16, this->checksums_.size(), 8);
+
+    for (size_t i = 0; i < this->checksums_.size(); i++) {
+        write_le(buf.data() + 24 + 4 * i, this->checksums_[i], 4);
+    }
+
+    std::unique_ptr<FILE, int (*)(FILE*)> f(fopen(path.c_str(), "wb"), fclose);
+
+    if (!f || fwrite(buf.data(), 1, buf.size(), f.get()) != buf.size() || fflush(f.get()) != 0) {
+        throw std::runtime_error("Cannot write checksum file: " + path);
+    }
+}
+
+FrameChecksums FrameChecksums::load(const std::string& path) {
+
+    std::unique_ptr<FILE, int (*)(FILE*)> f(fopen(path.c_str(), "rb"), fclose);
+
+    if (!f) {
+        throw std::runtime_error("Cannot open checksum file: " + path);
+    }
+
+    uint8_t header[24];
+
+    if (fread(header, 1, sizeof header, f.get()) != sizeof header ||
+        memcmp(header, SIDECAR_SIGNATURE, sizeof SIDECAR_SIGNATURE) != 0) {
+        throw std::runtime_error("Not a checksum file: " + path);
+    }
+
+    if (read_le(header + 8, 4) != SIDECAR_VERSION || read_le(header + 12, 4) != SIDECAR_ALGORITHM_CRC32C) {
+        throw std::runtime_error("Unsupported checksum file version or algorithm: " + path);
+    }
+
+    uint64_t count = read_le(header + 16, 8);
+
+    if (count > UINT32_MAX) {
+        throw std::runtime_error("Bad checksum file: " + path);
+    }
+
+    std::vector<uint8_t> buf((size_t) count * 4);
+
+    if (fread(buf.data(), 1, buf.size(), f.get()) != buf.size()) {
+        throw std::runtime_error("Checksum file is truncated: " + path);
+    }
+
+    FrameChecksums checksums;
+
+    checksums.checksums_.reserve((size_t) count);
+
+    for (size_t i = 0; i < count; i++) {
+        checksums.append((uint32_t) read_le(buf.data() + 4 * i, 4));
+    }
+
+    return checksums;
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_FRAMECHECKSUMS_H
+#define COM_SANDFLOW_FRAMECHECKSUMS_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+/* CRC-32C (Castagnoli) of a buffer, using the CRC32 instructions of SSE 4.2 or ARMv8 when available; crc is the
+   value returned for the preceding bytes, if any */
+
+uint32_t crc32c(const uint8_t* data, size_t size, uint32_t crc = 0);
+
+/* per-frame checksums of the codestreams of a track file, stored in a sidecar file consisting of:
+   - the 8-byte signature "JIDSUMS\n"
+   - the format version (currently 1) as a 4-byte little-endian integer
+   - the checksum algorithm (1 for CRC-32C) as a 4-byte little-endian integer
+   - the number of frames as an 8-byte little-endian integer
+   - the checksum of each frame as a 4-byte little-endian integer */
+
+class FrameChecksums {
+
+public:
+
+    FrameChecksums();
+
+    void append(uint32_t checksum);
+
+    uint32_t size() const;
+
+    uint32_t at(uint32_t frame) const;
+
+    void save(const std::string& path) const;
+
+    static FrameChecksums load(const std::string& path);
+
+protected:
+
+    std::vector<uint32_t> checksums_;
+};
+
+#endif
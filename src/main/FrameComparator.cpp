@@ -0,0 +1,130 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "FrameComparator.h"
+#include "FileIO.h"
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <exception>
+
+/* essence elements are compared in chunks of this size */
+
+static const size_t CHUNK_SIZE = 1024 * 1024;
+
+FrameComparator::FrameComparator(const FrameIndex& ref, const FrameIndex& other, unsigned int thread_count) :
+    ref_(ref),
+    other_(other),
+    thread_count_(thread_count == 0 ? 1 : thread_count) {}
+
+bool FrameComparator::isFrameChanged(uint32_t frame, std::vector<uint8_t>& ref_buffer, std::vector<uint8_t>& other_buffer) const {
+
+    FrameIndex::Entry ref_entry = this->ref_.lookup(frame);
+
+    FrameIndex::Entry other_entry = this->other_.lookup(frame);
+
+    /* the lengths are known from the index and KLV lengths, without reading the essence */
+
+    if (ref_entry.essence_length != other_entry.essence_length || ref_entry.is_encrypted != other_entry.is_encrypted) {
+        return true;
+    }
+
+    ref_buffer.resize(CHUNK_SIZE);
+    other_buffer.resize(CHUNK_SIZE);
+
+    for (uint64_t pos = 0; pos < ref_entry.essence_length; pos += CHUNK_SIZE) {
+
+        size_t sz = (size_t) std::min((uint64_t) CHUNK_SIZE, ref_entry.essence_length - pos);
+
+        read_fd_at(this->ref_.fd(), ref_buffer.data(), sz, ref_entry.essence_offset + pos);
+
+        read_fd_at(this->other_.fd(), other_buffer.data(), sz, other_entry.essence_offset + pos);
+
+        if (memcmp(ref_buffer.data(), other_buffer.data(), sz) != 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::vector<bool> FrameComparator::compare(uint32_t frame_count) {
+
+    std::vector<char> is_changed(frame_count, 0);
+
+    std::atomic<uint32_t> next_frame(0);
+
+    std::exception_ptr error;
+
+    std::mutex error_mutex;
+
+    auto worker = [&]() {
+
+        std::vector<uint8_t> ref_buffer;
+
+        std::vector<uint8_t> other_buffer;
+
+        uint32_t frame;
+
+        try {
+
+            while ((frame = next_frame++) < frame_count) {
+                is_changed[frame] = this->isFrameChanged(frame, ref_buffer, other_buffer);
+            }
+
+        } catch (...) {
+
+            std::lock_guard<std::mutex> lock(error_mutex);
+
+            if (!error) error = std::current_exception();
+
+            /* stop the other threads */
+
+            next_frame = frame_count;
+        }
+    };
+
+    std::vector<std::thread> threads;
+
+    for (unsigned int i = 1; i < this->thread_count_; i++) {
+        threads.push_back(std::thread(worker));
+    }
+
+    worker();
+
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    return std::vector<bool>(is_changed.begin(), is_changed.end());
+}
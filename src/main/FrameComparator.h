@@ -0,0 +1,57 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_FRAMECOMPARATOR_H
+#define COM_SANDFLOW_FRAMECOMPARATOR_H
+
+#include <vector>
+#include <stdint.h>
+#include "FrameIndex.h"
+
+/* compares the essence elements of two track files frame by frame, in parallel */
+
+class FrameComparator {
+
+public:
+
+    FrameComparator(const FrameIndex& ref, const FrameIndex& other, unsigned int thread_count);
+
+    /* returns, for each of the first frame_count frames, whether the essence elements differ */
+
+    std::vector<bool> compare(uint32_t frame_count);
+
+    /* compares a single frame; the buffers are used to read the essence elements */
+
+    bool isFrameChanged(uint32_t frame, std::vector<uint8_t>& ref_buffer, std::vector<uint8_t>& other_buffer) const;
+
+protected:
+
+    const FrameIndex& ref_;
+    const FrameIndex& other_;
+    unsigned int thread_count_;
+};
+
+#endif
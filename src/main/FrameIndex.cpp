@@ -0,0 +1,152 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "FrameIndex.h"
+#include "KLVStream.h"
+#include "FileIO.h"
+#include <stdexcept>
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+FrameIndex::FrameIndex(AS_02::JP2K::MXFReader& reader, const std::string& path) :
+    index_(reader.AS02IndexReader()),
+    fd_(-1),
+    file_size_(0),
+    essence_ul_(reader.OP1aHeader().m_Dict->ul(ASDCP::MDD_JPEG2000Essence)),
+    encrypted_ul_(reader.OP1aHeader().m_Dict->ul(ASDCP::MDD_EncryptedTriplet))
+{
+#ifdef WIN32
+    this->fd_ = _open(path.c_str(), _O_RDONLY | _O_BINARY);
+
+    struct _stat64 st;
+
+    if (this->fd_ < 0 || _fstat64(this->fd_, &st) != 0) {
+        if (this->fd_ >= 0) _close(this->fd_);
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+#else
+    this->fd_ = open(path.c_str(), O_RDONLY);
+
+    struct stat st;
+
+    if (this->fd_ < 0 || fstat(this->fd_, &st) != 0) {
+        if (this->fd_ >= 0) close(this->fd_);
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+#endif
+
+    this->file_size_ = (uint64_t) st.st_size;
+}
+
+FrameIndex::~FrameIndex() {
+#ifdef WIN32
+    _close(this->fd_);
+#else
+    close(this->fd_);
+#endif
+}
+
+int FrameIndex::fd() const {
+    return this->fd_;
+}
+
+uint64_t FrameIndex::fileSize() const {
+    return this->file_size_;
+}
+
+uint32_t FrameIndex::size() const {
+    return this->index_.GetDuration();
+}
+
+ASDCP::MXF::IndexTableSegment::IndexEntry FrameIndex::indexEntry(uint32_t frame) const {
+
+    ASDCP::MXF::IndexTableSegment::IndexEntry index_entry;
+
+    if (this->index_.Lookup(frame, index_entry).Failure()) {
+        throw std::runtime_error("Frame is not in the index table");
+    }
+
+    return index_entry;
+}
+
+uint64_t FrameIndex::klvOffset(uint32_t frame) const {
+    return this->indexEntry(frame).StreamOffset;
+}
+
+bool FrameIndex::isEssenceKey(const uint8_t* key) const {
+    return ASDCP::UL(key).MatchIgnoreStream(this->essence_ul_);
+}
+
+bool FrameIndex::isEncryptedKey(const uint8_t* key) const {
+    return ASDCP::UL(key).MatchIgnoreStream(this->encrypted_ul_);
+}
+
+FrameIndex::Entry FrameIndex::lookup(uint32_t frame) const {
+
+    Entry entry;
+
+    entry.klv_offset = this->klvOffset(frame);
+
+    /* read the key and the longest possible BER length */
+
+    byte_t kl[ASDCP::SMPTE_UL_LENGTH + 9];
+
+    if (entry.klv_offset + ASDCP::SMPTE_UL_LENGTH + 1 > this->file_size_) {
+        throw std::runtime_error("Cannot read essence element key and length");
+    }
+
+    size_t read_count = (size_t) std::min((uint64_t) sizeof kl, this->file_size_ - entry.klv_offset);
+
+    read_fd_at(this->fd_, kl, read_count, entry.klv_offset);
+
+    if (this->isEssenceKey(kl)) {
+        entry.is_encrypted = false;
+    } else if (this->isEncryptedKey(kl)) {
+        entry.is_encrypted = true;
+    } else {
+        throw std::runtime_error("Index table does not point to an essence element");
+    }
+
+    /* decode the BER length */
+
+    uint32_t ber_size;
+
+    if (!KLVStream::decodeBER(kl + ASDCP::SMPTE_UL_LENGTH, read_count - ASDCP::SMPTE_UL_LENGTH, entry.essence_length, ber_size)) {
+        throw std::runtime_error("Bad essence element length");
+    }
+
+    entry.essence_offset = entry.klv_offset + ASDCP::SMPTE_UL_LENGTH + ber_size;
+
+    return entry;
+}
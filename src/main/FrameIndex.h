@@ -0,0 +1,89 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_FRAMEINDEX_H
+#define COM_SANDFLOW_FRAMEINDEX_H
+
+#include <string>
+#include <stdint.h>
+#include <AS_02.h>
+
+/* locates the essence element of each frame of an AS-02 JPEG 2000 track file */
+
+class FrameIndex {
+
+public:
+
+    struct Entry {
+        uint64_t klv_offset;        /* file offset of the essence KLV packet */
+        uint64_t essence_offset;    /* file offset of the KLV value */
+        uint64_t essence_length;    /* length of the KLV value */
+        bool is_encrypted;          /* the KLV packet is an encrypted triplet */
+    };
+
+    FrameIndex(AS_02::JP2K::MXFReader& reader, const std::string& path);
+
+    ~FrameIndex();
+
+    FrameIndex(const FrameIndex&) = delete;
+
+    FrameIndex& operator=(const FrameIndex&) = delete;
+
+    uint32_t size() const;
+
+    /* looks up the frame in the index table and reads the key and length of its essence element; safe to call
+       from multiple threads */
+
+    Entry lookup(uint32_t frame) const;
+
+    /* file offset of the essence KLV packet of the frame, from the index table alone */
+
+    uint64_t klvOffset(uint32_t frame) const;
+
+    /* index table entry of the frame */
+
+    ASDCP::MXF::IndexTableSegment::IndexEntry indexEntry(uint32_t frame) const;
+
+    bool isEssenceKey(const uint8_t* key) const;
+
+    bool isEncryptedKey(const uint8_t* key) const;
+
+    /* read-only descriptor of the track file, for positional reads and copies */
+
+    int fd() const;
+
+    uint64_t fileSize() const;
+
+protected:
+
+    AS_02::MXF::AS02IndexReader& index_;
+    int fd_;
+    uint64_t file_size_;
+    ASDCP::UL essence_ul_;
+    ASDCP::UL encrypted_ul_;
+};
+
+#endif
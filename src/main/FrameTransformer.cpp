@@ -0,0 +1,183 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "FrameTransformer.h"
+#include "FileIO.h"
+#include <stdexcept>
+#include <string>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+FrameTransformer::FrameTransformer(const FrameIndex& index, unsigned int thread_count, const Transform& transform) :
+    index_(index),
+    thread_count_(thread_count == 0 ? 1 : thread_count),
+    transform_(transform)
+{
+}
+
+FrameTransformer::FrameTransformer(const FrameIndex& index, unsigned int thread_count, const ReadTransform& read_transform) :
+    index_(index),
+    thread_count_(thread_count == 0 ? 1 : thread_count),
+    read_transform_(read_transform)
+{
+}
+
+void FrameTransformer::run(uint64_t start_frame, uint64_t end_frame, uint32_t step, const Consumer& consumer) {
+
+    const uint64_t count = start_frame < end_frame ? (end_frame - start_frame + step - 1) / step : 0;
+
+    /* frames are transformed at most window positions ahead of the frame being consumed, which bounds memory use
+       when a frame is slow to transform */
+
+    const uint64_t window = 2 * (uint64_t) this->thread_count_;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    std::map<uint64_t, std::vector<uint8_t>> results;
+
+    uint64_t next_position = 0;
+    uint64_t consumed_position = 0;
+
+    std::exception_ptr error;
+
+    auto worker = [&]() {
+
+        std::vector<uint8_t> buffer;
+
+        while (true) {
+
+            uint64_t position;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+
+                if (error || next_position >= count) return;
+
+                position = next_position++;
+
+                cv.wait(lock, [&]() { return error || position < consumed_position + window; });
+
+                if (error) return;
+            }
+
+            uint32_t frame = (uint32_t) (start_frame + position * step);
+
+            try {
+
+                FrameIndex::Entry entry = this->index_.lookup(frame);
+
+                if (entry.is_encrypted) {
+                    throw std::runtime_error("Encrypted essence cannot be transformed");
+                }
+
+                std::vector<uint8_t> codestream;
+
+                if (this->read_transform_) {
+
+                    codestream = this->read_transform_(this->index_.fd(), entry.essence_offset, entry.essence_length);
+
+                } else {
+
+                    buffer.resize((size_t) entry.essence_length);
+
+                    read_fd_at(this->index_.fd(), buffer.data(), buffer.size(), entry.essence_offset);
+
+                    codestream = this->transform_(buffer.data(), buffer.size());
+                }
+
+                std::lock_guard<std::mutex> lock(mutex);
+
+                results[position].swap(codestream);
+
+            } catch (const std::exception& e) {
+
+                std::lock_guard<std::mutex> lock(mutex);
+
+                if (!error) {
+                    error = std::make_exception_ptr(std::runtime_error("Frame " + std::to_string(frame) + ": " + e.what()));
+                }
+            }
+
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+
+    for (unsigned int i = 0; i < this->thread_count_; i++) {
+        threads.push_back(std::thread(worker));
+    }
+
+    /* results are consumed on the calling thread, in frame order */
+
+    try {
+
+        std::vector<uint8_t> codestream;
+
+        for (uint64_t position = 0; position < count; position++) {
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+
+                cv.wait(lock, [&]() { return error || results.count(position); });
+
+                if (error) break;
+
+                codestream.swap(results[position]);
+
+                results.erase(position);
+            }
+
+            consumer((uint32_t) (start_frame + position * step), codestream);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                consumed_position = position + 1;
+            }
+
+            cv.notify_all();
+        }
+
+    } catch (...) {
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (!error) error = std::current_exception();
+    }
+
+    cv.notify_all();
+
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    if (error) std::rethrow_exception(error);
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_FRAMETRANSFORMER_H
+#define COM_SANDFLOW_FRAMETRANSFORMER_H
+
+#include <functional>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+#include "FrameIndex.h"
+
+/* applies a transformation to the codestreams of a range of frames of a track file in parallel, and passes the
+   resulting codestreams in frame order to a consumer, holding at most a few results per thread */
+
+class FrameTransformer {
+
+public:
+
+    typedef std::function<std::vector<uint8_t>(const uint8_t* codestream, size_t size)> Transform;
+
+    /* transforms the codestream at offset within fd, reading only the parts of it that it needs */
+
+    typedef std::function<std::vector<uint8_t>(int fd, uint64_t offset, uint64_t size)> ReadTransform;
+
+    typedef std::function<void(uint32_t frame, const std::vector<uint8_t>& codestream)> Consumer;
+
+    FrameTransformer(const FrameIndex& index, unsigned int thread_count, const Transform& transform);
+
+    FrameTransformer(const FrameIndex& index, unsigned int thread_count, const ReadTransform& read_transform);
+
+    /* transforms frames start_frame, start_frame + step, ... up to end_frame (exclusive), throwing
+       std::runtime_error if a frame is encrypted or cannot be transformed */
+
+    void run(uint64_t start_frame, uint64_t end_frame, uint32_t step, const Consumer& consumer);
+
+protected:
+
+    const FrameIndex& index_;
+    unsigned int thread_count_;
+    Transform transform_;
+    ReadTransform read_transform_;
+};
+
+#endif
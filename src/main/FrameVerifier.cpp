@@ -0,0 +1,125 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "FrameVerifier.h"
+#include "FileIO.h"
+#include "J2KCodestream.h"
+#include <stdexcept>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+FrameVerifier::FrameVerifier(const FrameIndex& index, unsigned int thread_count, const FrameChecksums* checksums) :
+    index_(index),
+    thread_count_(thread_count == 0 ? 1 : thread_count),
+    checksums_(checksums)
+{
+    if (checksums && checksums->size() != index.size()) {
+        throw std::runtime_error("Checksum file and track file have different frame counts");
+    }
+}
+
+void FrameVerifier::verifyFrame(uint32_t frame, std::vector<uint8_t>& buffer) const {
+
+    FrameIndex::Entry entry = this->index_.lookup(frame);
+
+    /* the essence element lies within the file and ends before the essence element of the next frame */
+
+    uint64_t limit = frame + 1 < this->index_.size() ? this->index_.klvOffset(frame + 1) : this->index_.fileSize();
+
+    if (entry.essence_offset > limit || entry.essence_length > limit - entry.essence_offset) {
+        throw std::runtime_error(frame + 1 < this->index_.size() ?
+            "Essence element overlaps the next frame" : "Essence element extends past the end of the file");
+    }
+
+    /* the codestream of an encrypted triplet cannot be inspected */
+
+    if (entry.is_encrypted) {
+
+        if (this->checksums_) {
+            throw std::runtime_error("Encrypted essence cannot be checked against checksums");
+        }
+
+        return;
+    }
+
+    buffer.resize((size_t) entry.essence_length);
+
+    read_fd_at(this->index_.fd(), buffer.data(), buffer.size(), entry.essence_offset);
+
+    if (this->checksums_ && crc32c(buffer.data(), buffer.size()) != this->checksums_->at(frame)) {
+        throw std::runtime_error("Checksum mismatch");
+    }
+
+    J2KCodestream codestream(buffer.data(), buffer.size());
+}
+
+std::map<uint32_t, std::string> FrameVerifier::verify(uint64_t start_frame, uint64_t end_frame, uint32_t step) {
+
+    std::map<uint32_t, std::string> bad_frames;
+
+    std::mutex bad_frames_mutex;
+
+    /* frames are handed out one at a time so that large and small frames balance across threads */
+
+    std::atomic<uint64_t> next_frame(start_frame);
+
+    auto worker = [&]() {
+
+        std::vector<uint8_t> buffer;
+
+        uint64_t frame;
+
+        while ((frame = next_frame.fetch_add(step)) < end_frame) {
+
+            try {
+
+                this->verifyFrame((uint32_t) frame, buffer);
+
+            } catch (const std::exception& e) {
+
+                std::lock_guard<std::mutex> lock(bad_frames_mutex);
+
+                bad_frames[(uint32_t) frame] = e.what();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+
+    for (unsigned int i = 1; i < this->thread_count_; i++) {
+        threads.push_back(std::thread(worker));
+    }
+
+    worker();
+
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    return bad_frames;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_FRAMEVERIFIER_H
+#define COM_SANDFLOW_FRAMEVERIFIER_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "FrameIndex.h"
+#include "FrameChecksums.h"
+
+/* checks the integrity of the frames of a track file in parallel, without decoding them, optionally against
+   previously recorded per-frame checksums */
+
+class FrameVerifier {
+
+public:
+
+    FrameVerifier(const FrameIndex& index, unsigned int thread_count, const FrameChecksums* checksums = NULL);
+
+    /* checks frames start_frame, start_frame + step, ... up to end_frame (exclusive) and returns a description of
+       the defect of each bad frame */
+
+    std::map<uint32_t, std::string> verify(uint64_t start_frame, uint64_t end_frame, uint32_t step);
+
+    /* checks a single frame, throwing std::runtime_error if it is bad; buffer holds the essence element */
+
+    void verifyFrame(uint32_t frame, std::vector<uint8_t>& buffer) const;
+
+protected:
+
+    const FrameIndex& index_;
+    unsigned int thread_count_;
+    const FrameChecksums* checksums_;
+};
+
+#endif
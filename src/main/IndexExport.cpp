@@ -0,0 +1,113 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "IndexExport.h"
+#include <stdexcept>
+#include <memory>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+
+static void write_le(uint8_t* p, uint64_t v, int size) {
+    for (int i = 0; i < size; i++) {
+        p[i] = (uint8_t) (v >> (8 * i));
+    }
+}
+
+static const char INDEX_SIGNATURE[8] = { 'J', 'I', 'D', 'I', 'N', 'D', 'E', 'X' };
+
+static const uint32_t INDEX_VERSION = 1;
+
+static const uint32_t INDEX_RECORD_SIZE = 24;
+
+static const uint32_t INDEX_FLAG_ENCRYPTED = 1;
+
+void export_index(const FrameIndex& index, const std::string& path) {
+
+    std::vector<FrameIndex::Entry> entries;
+
+    entries.reserve(index.size());
+
+    bool is_encrypted = false;
+
+    for (uint32_t i = 0; i < index.size(); i++) {
+
+        entries.push_back(index.lookup(i));
+
+        is_encrypted = is_encrypted || entries.back().is_encrypted;
+    }
+
+    const bool is_json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+
+    std::unique_ptr<FILE, int (*)(FILE*)> f(fopen(path.c_str(), is_json ? "w" : "wb"), fclose);
+
+    if (!f) {
+        throw std::runtime_error("Cannot open index file: " + path);
+    }
+
+    bool is_ok = true;
+
+    if (is_json) {
+
+        is_ok = fprintf(f.get(), "{\"frameCount\": %u, \"encrypted\": %s, \"frames\": [", index.size(), is_encrypted ? "true" : "false") > 0;
+
+        for (size_t i = 0; is_ok && i < entries.size(); i++) {
+            is_ok = fprintf(f.get(), "%s\n  {\"keyOffset\": %llu, \"offset\": %llu, \"length\": %llu}",
+                i == 0 ? "" : ",",
+                (unsigned long long) entries[i].klv_offset,
+                (unsigned long long) entries[i].essence_offset,
+                (unsigned long long) entries[i].essence_length) > 0;
+        }
+
+        is_ok = is_ok && fprintf(f.get(), "\n]}\n") > 0;
+
+    } else {
+
+        std::vector<uint8_t> buf(32 + (size_t) INDEX_RECORD_SIZE * entries.size());
+
+        memcpy(buf.data(), INDEX_SIGNATURE, sizeof INDEX_SIGNATURE);
+        write_le(buf.data() + 8, INDEX_VERSION, 4);
+        write_le(buf.data() + 12, INDEX_RECORD_SIZE, 4);
+        write_le(buf.data() + 16, entries.size(), 8);
+        write_le(buf.data() + 24, is_encrypted ? INDEX_FLAG_ENCRYPTED : 0, 4);
+        write_le(buf.data() + 28, 0, 4);
+
+        for (size_t i = 0; i < entries.size(); i++) {
+
+            uint8_t* record = buf.data() + 32 + INDEX_RECORD_SIZE * i;
+
+            write_le(record, entries[i].klv_offset, 8);
+            write_le(record + 8, entries[i].essence_offset, 8);
+            write_le(record + 16, entries[i].essence_length, 8);
+        }
+
+        is_ok = fwrite(buf.data(), 1, buf.size(), f.get()) == buf.size();
+    }
+
+    if (!is_ok || fflush(f.get()) != 0) {
+        throw std::runtime_error("Cannot write index file: " + path);
+    }
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_INDEXEXPORT_H
+#define COM_SANDFLOW_INDEXEXPORT_H
+
+#include <string>
+#include "FrameIndex.h"
+
+/* writes the location of the essence element of every frame to a sidecar file, so that other tools can read any
+   frame with a single positional read.
+
+   If the path ends with ".json", the sidecar is a JSON object:
+
+     {"frameCount": <n>, "encrypted": <bool>, "frames": [{"keyOffset": <k>, "offset": <o>, "length": <l>}, ...]}
+
+   Otherwise the sidecar is binary, with all integers little-endian:
+   - the 8-byte signature "JIDINDEX"
+   - the format version (currently 1) as a 4-byte integer
+   - the size of each record (currently 24) as a 4-byte integer
+   - the number of frames as an 8-byte integer
+   - flags as a 4-byte integer, where bit 0 is set if essence elements are encrypted triplets
+   - 4 reserved bytes
+   - for each frame, the file offset of the essence element key, the file offset of the essence element value and
+     the length of the essence element value, each as an 8-byte integer */
+
+void export_index(const FrameIndex& index, const std::string& path);
+
+#endif
@@ -0,0 +1,304 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "J2KCodestream.h"
+#include <stdexcept>
+#include <map>
+
+uint16_t J2KCodestream::readU16(const uint8_t* p) {
+    return (uint16_t) ((p[0] << 8) | p[1]);
+}
+
+uint32_t J2KCodestream::readU32(const uint8_t* p) {
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+void J2KCodestream::writeU16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t) (v >> 8);
+    p[1] = (uint8_t) v;
+}
+
+void J2KCodestream::writeU32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t) (v >> 24);
+    p[1] = (uint8_t) (v >> 16);
+    p[2] = (uint8_t) (v >> 8);
+    p[3] = (uint8_t) v;
+}
+
+J2KCodestream::J2KCodestream(const uint8_t* data, size_t size) : J2KCodestream(data, size, false) {}
+
+J2KCodestream J2KCodestream::fromMainHeader(const uint8_t* data, size_t size) {
+    return J2KCodestream(data, size, true);
+}
+
+J2KCodestream::J2KCodestream(const uint8_t* data, size_t size, bool is_main_header_only) :
+    data_(data),
+    size_(size),
+    main_header_(),
+    main_header_length_(0),
+    tile_parts_()
+{
+    if (size < 4 || readU16(data) != J2KMarker::SOC) {
+        throw std::runtime_error("Codestream does not start with SOC");
+    }
+
+    if (readU16(data + 2) != J2KMarker::SIZ) {
+        throw std::runtime_error("SOC is not followed by SIZ");
+    }
+
+    /* main header */
+
+    this->main_header_length_ = this->_parseMarkerSegments(2, size, J2KMarker::SOT, this->main_header_);
+
+    this->_parseSIZ(this->main_header_.front());
+
+    if (is_main_header_only) return;
+
+    /* tile-parts */
+
+    size_t pos = this->main_header_length_;
+
+    std::map<uint16_t, uint8_t> last_tile_part_indices;
+
+    bool has_eoc = false;
+
+    while (pos + 2 <= size) {
+
+        uint16_t marker = readU16(data + pos);
+
+        if (marker == J2KMarker::EOC) {
+
+            if (pos + 2 != size) {
+                throw std::runtime_error("Data follows EOC");
+            }
+
+            has_eoc = true;
+
+            break;
+        }
+
+        if (marker != J2KMarker::SOT) {
+            throw std::runtime_error("Tile-part does not start with SOT");
+        }
+
+        if (pos + 12 > size || readU16(data + pos + 2) != 10) {
+            throw std::runtime_error("Bad SOT marker segment");
+        }
+
+        TilePart tp;
+
+        tp.offset = pos;
+        tp.tile_index = readU16(data + pos + 4);
+        tp.length = readU32(data + pos + 6);
+        tp.tile_part_index = data[pos + 10];
+        tp.tile_part_count = data[pos + 11];
+
+        if (tp.tile_index >= (uint64_t) this->tileCountX() * this->tileCountY()) {
+            throw std::runtime_error("Tile index out of range");
+        }
+
+        if (tp.length == 0) {
+
+            /* the last tile-part extends to EOC */
+
+            if (size < pos + 2) {
+                throw std::runtime_error("Codestream is truncated");
+            }
+
+            tp.length = size - 2 - pos;
+        }
+
+        if (tp.length < 14 || pos + tp.length > size) {
+            throw std::runtime_error("Tile-part length is inconsistent with the codestream length");
+        }
+
+        tp.header_length = this->_parseMarkerSegments(pos + 12, pos + tp.length, J2KMarker::SOD, tp.header) + 2 - pos;
+
+        /* tile-parts of a tile are numbered sequentially */
+
+        std::map<uint16_t, uint8_t>::iterator last = last_tile_part_indices.find(tp.tile_index);
+
+        if (last == last_tile_part_indices.end() ? tp.tile_part_index != 0 : tp.tile_part_index != last->second + 1) {
+            throw std::runtime_error("Tile-parts are out of sequence");
+        }
+
+        if (tp.tile_part_count != 0 && tp.tile_part_index >= tp.tile_part_count) {
+            throw std::runtime_error("Tile-part index exceeds the number of tile-parts");
+        }
+
+        last_tile_part_indices[tp.tile_index] = tp.tile_part_index;
+
+        this->tile_parts_.push_back(tp);
+
+        pos += tp.length;
+    }
+
+    if (!has_eoc) {
+        throw std::runtime_error("Codestream does not end with EOC");
+    }
+
+    /* all tiles are present and complete */
+
+    std::map<uint16_t, const TilePart*> tiles;
+
+    for (const TilePart& tp : this->tile_parts_) {
+        tiles[tp.tile_index] = &tp;
+    }
+
+    if (tiles.size() != (uint64_t) this->tileCountX() * this->tileCountY()) {
+        throw std::runtime_error("Tiles are missing");
+    }
+
+    for (const std::pair<const uint16_t, const TilePart*>& t : tiles) {
+        if (t.second->tile_part_count != 0 && t.second->tile_part_index + 1 != t.second->tile_part_count) {
+            throw std::runtime_error("Tile-parts are missing");
+        }
+    }
+}
+
+size_t J2KCodestream::_parseMarkerSegments(size_t pos, size_t end, uint16_t last_marker, std::vector<MarkerSegment>& segments) {
+
+    while (true) {
+
+        if (pos + 2 > end) {
+            throw std::runtime_error("Header is truncated");
+        }
+
+        uint16_t marker = readU16(this->data_ + pos);
+
+        if (marker == last_marker) {
+            return pos;
+        }
+
+        if ((marker & 0xFF00) != 0xFF00 || marker == J2KMarker::SOC || marker == J2KMarker::SOT ||
+            marker == J2KMarker::SOD || marker == J2KMarker::EOC) {
+            throw std::runtime_error("Unexpected marker in header");
+        }
+
+        if (pos + 4 > end) {
+            throw std::runtime_error("Header is truncated");
+        }
+
+        MarkerSegment seg;
+
+        seg.marker = marker;
+        seg.offset = pos;
+        seg.length = 2 + (size_t) readU16(this->data_ + pos + 2);
+
+        if (seg.length < 4 || pos + seg.length > end) {
+            throw std::runtime_error("Bad marker segment length");
+        }
+
+        segments.push_back(seg);
+
+        pos += seg.length;
+    }
+}
+
+void J2KCodestream::_parseSIZ(const MarkerSegment& seg) {
+
+    if (seg.length < 41) {
+        throw std::runtime_error("Bad SIZ marker segment");
+    }
+
+    const uint8_t* p = this->data_ + seg.offset + 4;
+
+    this->rsiz_ = readU16(p);
+    this->xsiz_ = readU32(p + 2);
+    this->ysiz_ = readU32(p + 6);
+    this->xosiz_ = readU32(p + 10);
+    this->yosiz_ = readU32(p + 14);
+    this->xtsiz_ = readU32(p + 18);
+    this->ytsiz_ = readU32(p + 22);
+    this->xtosiz_ = readU32(p + 26);
+    this->ytosiz_ = readU32(p + 30);
+
+    uint16_t csiz = readU16(p + 34);
+
+    if (seg.length != 40 + 3 * (size_t) csiz || csiz == 0) {
+        throw std::runtime_error("Bad SIZ marker segment");
+    }
+
+    if (this->xsiz_ <= this->xosiz_ || this->ysiz_ <= this->yosiz_ || this->xtsiz_ == 0 || this->ytsiz_ == 0 ||
+        this->xtosiz_ > this->xosiz_ || this->ytosiz_ > this->yosiz_ ||
+        (uint64_t) this->xtosiz_ + this->xtsiz_ <= this->xosiz_ || (uint64_t) this->ytosiz_ + this->ytsiz_ <= this->yosiz_) {
+        throw std::runtime_error("Bad image or tile geometry");
+    }
+
+    for (uint16_t i = 0; i < csiz; i++) {
+
+        Component c;
+
+        c.ssiz = p[36 + 3 * i];
+        c.xrsiz = p[37 + 3 * i];
+        c.yrsiz = p[38 + 3 * i];
+
+        if (c.xrsiz == 0 || c.yrsiz == 0) {
+            throw std::runtime_error("Bad component sub-sampling");
+        }
+
+        this->components_.push_back(c);
+    }
+}
+
+const uint8_t* J2KCodestream::data() const { return this->data_; }
+
+size_t J2KCodestream::size() const { return this->size_; }
+
+const std::vector<J2KCodestream::MarkerSegment>& J2KCodestream::mainHeader() const { return this->main_header_; }
+
+const J2KCodestream::MarkerSegment* J2KCodestream::findMainHeaderSegment(uint16_t marker) const {
+
+    for (const MarkerSegment& seg : this->main_header_) {
+        if (seg.marker == marker) return &seg;
+    }
+
+    return NULL;
+}
+
+size_t J2KCodestream::mainHeaderLength() const { return this->main_header_length_; }
+
+const std::vector<J2KCodestream::TilePart>& J2KCodestream::tileParts() const { return this->tile_parts_; }
+
+uint16_t J2KCodestream::rsiz() const { return this->rsiz_; }
+uint32_t J2KCodestream::xsiz() const { return this->xsiz_; }
+uint32_t J2KCodestream::ysiz() const { return this->ysiz_; }
+uint32_t J2KCodestream::xosiz() const { return this->xosiz_; }
+uint32_t J2KCodestream::yosiz() const { return this->yosiz_; }
+uint32_t J2KCodestream::xtsiz() const { return this->xtsiz_; }
+uint32_t J2KCodestream::ytsiz() const { return this->ytsiz_; }
+uint32_t J2KCodestream::xtosiz() const { return this->xtosiz_; }
+uint32_t J2KCodestream::ytosiz() const { return this->ytosiz_; }
+
+const std::vector<J2KCodestream::Component>& J2KCodestream::components() const { return this->components_; }
+
+uint32_t J2KCodestream::tileCountX() const {
+    return (uint32_t) (((uint64_t) this->xsiz_ - this->xtosiz_ + this->xtsiz_ - 1) / this->xtsiz_);
+}
+
+uint32_t J2KCodestream::tileCountY() const {
+    return (uint32_t) (((uint64_t) this->ysiz_ - this->ytosiz_ + this->ytsiz_ - 1) / this->ytsiz_);
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_J2KCODESTREAM_H
+#define COM_SANDFLOW_J2KCODESTREAM_H
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+/* JPEG 2000 codestream markers (Rec. ITU-T T.800 | ISO/IEC 15444-1, Annex A) */
+
+namespace J2KMarker {
+    const uint16_t SOC = 0xFF4F;
+    const uint16_t CAP = 0xFF50;
+    const uint16_t SIZ = 0xFF51;
+    const uint16_t COD = 0xFF52;
+    const uint16_t COC = 0xFF53;
+    const uint16_t TLM = 0xFF55;
+    const uint16_t PLM = 0xFF57;
+    const uint16_t PLT = 0xFF58;
+    const uint16_t QCD = 0xFF5C;
+    const uint16_t QCC = 0xFF5D;
+    const uint16_t RGN = 0xFF5E;
+    const uint16_t POC = 0xFF5F;
+    const uint16_t PPM = 0xFF60;
+    const uint16_t PPT = 0xFF61;
+    const uint16_t SOT = 0xFF90;
+    const uint16_t SOP = 0xFF91;
+    const uint16_t EPH = 0xFF92;
+    const uint16_t SOD = 0xFF93;
+    const uint16_t EOC = 0xFFD9;
+}
+
+/* structure of a JPEG 2000 codestream: main header marker segments, image and tile geometry and tile-parts */
+
+class J2KCodestream {
+
+public:
+
+    struct MarkerSegment {
+        uint16_t marker;
+        size_t offset;      /* offset of the marker */
+        size_t length;      /* length of the marker segment, including the marker */
+    };
+
+    struct Component {
+        uint8_t ssiz;
+        uint8_t xrsiz;
+        uint8_t yrsiz;
+    };
+
+    struct TilePart {
+        uint16_t tile_index;
+        uint8_t tile_part_index;
+        uint8_t tile_part_count;                /* 0 if unknown */
+        size_t offset;                          /* offset of the SOT marker */
+        size_t length;                          /* Psot, or the length up to EOC if Psot is 0 */
+        size_t header_length;                   /* length from the SOT marker to the end of the SOD marker */
+        std::vector<MarkerSegment> header;      /* tile-part header marker segments, excluding SOT and SOD */
+    };
+
+    /* parses the codestream and checks its structure, throwing std::runtime_error if it is malformed */
+
+    J2KCodestream(const uint8_t* data, size_t size);
+
+    /* parses only the main header, e.g. to locate tile-parts using TLM marker segments without reading them: data
+       need only extend to the first SOT marker, and tileParts() is empty */
+
+    static J2KCodestream fromMainHeader(const uint8_t* data, size_t size);
+
+    const uint8_t* data() const;
+
+    size_t size() const;
+
+    const std::vector<MarkerSegment>& mainHeader() const;
+
+    /* returns the first main header marker segment of a type, or NULL if absent */
+
+    const MarkerSegment* findMainHeaderSegment(uint16_t marker) const;
+
+    /* length of the main header, i.e. offset of the first SOT marker */
+
+    size_t mainHeaderLength() const;
+
+    const std::vector<TilePart>& tileParts() const;
+
+    /* image and tile geometry from SIZ */
+
+    uint16_t rsiz() const;
+    uint32_t xsiz() const;
+    uint32_t ysiz() const;
+    uint32_t xosiz() const;
+    uint32_t yosiz() const;
+    uint32_t xtsiz() const;
+    uint32_t ytsiz() const;
+    uint32_t xtosiz() const;
+    uint32_t ytosiz() const;
+    const std::vector<Component>& components() const;
+
+    uint32_t tileCountX() const;
+    uint32_t tileCountY() const;
+
+    static uint16_t readU16(const uint8_t* p);
+    static uint32_t readU32(const uint8_t* p);
+    static void writeU16(uint8_t* p, uint16_t v);
+    static void writeU32(uint8_t* p, uint32_t v);
+
+protected:
+
+    const uint8_t* data_;
+    size_t size_;
+    std::vector<MarkerSegment> main_header_;
+    size_t main_header_length_;
+    std::vector<TilePart> tile_parts_;
+
+    uint16_t rsiz_;
+    uint32_t xsiz_, ysiz_, xosiz_, yosiz_;
+    uint32_t xtsiz_, ytsiz_, xtosiz_, ytosiz_;
+    std::vector<Component> components_;
+
+    J2KCodestream(const uint8_t* data, size_t size, bool is_main_header_only);
+
+    void _parseSIZ(const MarkerSegment& seg);
+    size_t _parseMarkerSegments(size_t pos, size_t end, uint16_t last_marker, std::vector<MarkerSegment>& segments);
+};
+
+#endif
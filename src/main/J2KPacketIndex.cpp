@@ -0,0 +1,805 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "J2KPacketIndex.h"
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include <map>
+
+/* code-block styles (Table A.19) */
+
+static const uint8_t CBLK_STYLE_BYPASS = 0x01;
+static const uint8_t CBLK_STYLE_TERMALL = 0x04;
+static const uint8_t CBLK_STYLE_HT = 0x40;
+
+/* progression orders (Table A.16) */
+
+static const uint8_t PROGRESSION_LRCP = 0;
+static const uint8_t PROGRESSION_RLCP = 1;
+static const uint8_t PROGRESSION_RPCL = 2;
+static const uint8_t PROGRESSION_PCRL = 3;
+static const uint8_t PROGRESSION_CPRL = 4;
+
+static uint64_t ceil_div(uint64_t a, uint64_t b) {
+    return (a + b - 1) / b;
+}
+
+/* ceiling of a / 2^e, where a can be negative */
+
+static int64_t ceil_div_pow2(int64_t a, uint32_t e) {
+    return a >= 0 ? (a + ((int64_t) 1 << e) - 1) >> e : -((-a) >> e);
+}
+
+static uint32_t floor_log2(uint32_t v) {
+
+    uint32_t l = 0;
+
+    while (v >>= 1) l++;
+
+    return l;
+}
+
+/* reads the bits of a packet header, skipping the bit stuffed after each 0xFF byte (B.10.1) */
+
+class PacketHeaderReader {
+
+public:
+
+    PacketHeaderReader(const uint8_t* data, size_t size) : start_(data), p_(data), end_(data + size), buf_(0), ct_(0) {}
+
+    uint32_t bit() {
+
+        if (this->ct_ == 0) this->_byteIn();
+
+        this->ct_--;
+
+        return (this->buf_ >> this->ct_) & 1;
+    }
+
+    uint32_t bits(uint32_t n) {
+
+        if (n > 32) {
+            throw std::runtime_error("Bad packet header");
+        }
+
+        uint32_t v = 0;
+
+        while (n--) v = (v << 1) | this->bit();
+
+        return v;
+    }
+
+    /* skips to the end of the packet header and returns its length */
+
+    size_t align() {
+
+        if ((this->buf_ & 0xFF) == 0xFF) this->_byteIn();
+
+        this->ct_ = 0;
+
+        return this->p_ - this->start_;
+    }
+
+private:
+
+    const uint8_t* start_;
+    const uint8_t* p_;
+    const uint8_t* end_;
+    uint32_t buf_;
+    uint32_t ct_;
+
+    void _byteIn() {
+
+        if (this->p_ == this->end_) {
+            throw std::runtime_error("Packet header is truncated");
+        }
+
+        this->buf_ = (this->buf_ << 8) & 0xFFFF;
+        this->ct_ = this->buf_ == 0xFF00 ? 7 : 8;
+        this->buf_ |= *this->p_++;
+    }
+};
+
+/* tag tree (B.10.2) */
+
+class TagTree {
+
+public:
+
+    TagTree(uint32_t width, uint32_t height) {
+
+        while (true) {
+
+            this->widths_.push_back(width);
+            this->nodes_.push_back(std::vector<Node>((size_t) width * height));
+
+            if ((uint64_t) width * height <= 1) break;
+
+            width = (width + 1) / 2;
+            height = (height + 1) / 2;
+        }
+    }
+
+    /* decodes the value of a leaf until it is known to be at least threshold, and returns whether it is less */
+
+    bool decode(PacketHeaderReader& reader, uint32_t leaf, uint32_t threshold) {
+
+        uint32_t x = leaf % this->widths_[0];
+        uint32_t y = leaf / this->widths_[0];
+
+        uint32_t low = 0;
+
+        Node* node = NULL;
+
+        for (size_t level = this->nodes_.size(); level-- > 0;) {
+
+            node = &this->nodes_[level][(size_t) (y >> level) * this->widths_[level] + (x >> level)];
+
+            if (low > node->low) {
+                node->low = low;
+            } else {
+                low = node->low;
+            }
+
+            while (low < threshold && low < node->value) {
+                if (reader.bit()) {
+                    node->value = low;
+                } else {
+                    low++;
+                }
+            }
+
+            node->low = low;
+        }
+
+        return node->value < threshold;
+    }
+
+private:
+
+    struct Node {
+        uint32_t value = UINT32_MAX;
+        uint32_t low = 0;
+    };
+
+    std::vector<uint32_t> widths_;
+    std::vector<std::vector<Node>> nodes_;
+};
+
+/* state of a code-block carried from one packet to the next */
+
+struct CodeBlockState {
+    bool is_included = false;
+    uint32_t lblock = 3;
+    uint32_t segment_count = 0;
+    uint32_t segment_passes = 0;            /* coding passes of the last codeword segment */
+    uint32_t segment_max_passes = 0;
+};
+
+struct BandState {
+
+    BandState(uint32_t w, uint32_t h) : width(w), height(h), inclusion(w, h), zero_bitplanes(w, h), code_blocks((size_t) w * h) {}
+
+    uint32_t width;
+    uint32_t height;
+    TagTree inclusion;
+    TagTree zero_bitplanes;
+    std::vector<CodeBlockState> code_blocks;
+};
+
+/* tile-component resolution, in its own coordinates (B.5) */
+
+struct Resolution {
+    uint64_t x0, y0, x1, y1;
+    uint32_t pw, ph;                        /* number of precincts */
+};
+
+/* parses SPcod or SPcoc */
+
+static void parse_spco(const uint8_t* p, size_t len, bool has_precincts, J2KPacketIndex::ComponentStyle& style) {
+
+    if (len < 5 || p[0] > 32 || p[1] > 8 || p[2] > 8 || p[1] + p[2] > 8 || (has_precincts && len < 5 + (size_t) p[0] + 1)) {
+        throw std::runtime_error("Bad coding style");
+    }
+
+    style.levels = p[0];
+    style.xcb = p[1] + 2;
+    style.ycb = p[2] + 2;
+    style.cblk_style = p[3];
+
+    style.ppx.assign(style.levels + 1, 15);
+    style.ppy.assign(style.levels + 1, 15);
+
+    if (has_precincts) {
+
+        for (uint8_t r = 0; r <= style.levels; r++) {
+
+            style.ppx[r] = p[5 + r] & 0x0F;
+            style.ppy[r] = p[5 + r] >> 4;
+
+            if (r > 0 && (style.ppx[r] == 0 || style.ppy[r] == 0)) {
+                throw std::runtime_error("Bad precinct size");
+            }
+        }
+    }
+}
+
+static void parse_cod(const uint8_t* p, size_t len, J2KPacketIndex::TileStyle& style) {
+
+    if (len < 10) {
+        throw std::runtime_error("Bad COD marker segment");
+    }
+
+    style.progression = p[1];
+    style.layers = J2KCodestream::readU16(p + 2);
+    style.has_sop = (p[0] & 0x02) != 0;
+    style.has_eph = (p[0] & 0x04) != 0;
+
+    if (style.progression > PROGRESSION_CPRL || style.layers == 0) {
+        throw std::runtime_error("Bad COD marker segment");
+    }
+
+    J2KPacketIndex::ComponentStyle component_style;
+
+    parse_spco(p + 5, len - 5, (p[0] & 0x01) != 0, component_style);
+
+    std::fill(style.components.begin(), style.components.end(), component_style);
+}
+
+static void parse_coc(const uint8_t* p, size_t len, J2KPacketIndex::TileStyle& style) {
+
+    size_t ccoc_size = style.components.size() < 257 ? 1 : 2;
+
+    if (len < ccoc_size + 1) {
+        throw std::runtime_error("Bad COC marker segment");
+    }
+
+    uint16_t c = ccoc_size == 1 ? p[0] : J2KCodestream::readU16(p);
+
+    if (c >= style.components.size()) {
+        throw std::runtime_error("Bad COC marker segment");
+    }
+
+    parse_spco(p + ccoc_size + 1, len - ccoc_size - 1, (p[ccoc_size] & 0x01) != 0, style.components[c]);
+}
+
+J2KPacketIndex::J2KPacketIndex(const J2KCodestream& codestream) : codestream_(codestream) {
+
+    if (codestream.rsiz() & 0x8000) {
+        throw std::runtime_error("Codestreams that use Part 2 extensions are not supported");
+    }
+
+    this->_parseTileStyles();
+
+    /* the packets of a tile continue from one of its tile-parts to the next */
+
+    std::map<uint16_t, std::vector<size_t>> tiles;
+
+    for (size_t i = 0; i < codestream.tileParts().size(); i++) {
+        tiles[codestream.tileParts()[i].tile_index].push_back(i);
+    }
+
+    for (const std::pair<const uint16_t, std::vector<size_t>>& tile : tiles) {
+        this->_indexTile(tile.first, tile.second);
+    }
+}
+
+const std::vector<J2KPacketIndex::Packet>& J2KPacketIndex::packets() const {
+    return this->packets_;
+}
+
+const J2KPacketIndex::TileStyle& J2KPacketIndex::tileStyle(uint16_t tile) const {
+    return this->tile_styles_.at(tile);
+}
+
+J2KPacketIndex::TileStyle J2KPacketIndex::mainHeaderStyle(const J2KCodestream& cs) {
+
+    TileStyle style;
+
+    style.components.resize(cs.components().size());
+
+    const J2KCodestream::MarkerSegment* cod = cs.findMainHeaderSegment(J2KMarker::COD);
+
+    if (!cod) {
+        throw std::runtime_error("Codestream has no COD marker segment");
+    }
+
+    parse_cod(cs.data() + cod->offset + 4, cod->length - 4, style);
+
+    for (const J2KCodestream::MarkerSegment& seg : cs.mainHeader()) {
+        if (seg.marker == J2KMarker::COC) {
+            parse_coc(cs.data() + seg.offset + 4, seg.length - 4, style);
+        }
+    }
+
+    return style;
+}
+
+void J2KPacketIndex::_parseTileStyles() {
+
+    const J2KCodestream& cs = this->codestream_;
+
+    for (const J2KCodestream::MarkerSegment& seg : cs.mainHeader()) {
+        if (seg.marker == J2KMarker::POC || seg.marker == J2KMarker::PPM) {
+            throw std::runtime_error("POC and PPM marker segments are not supported");
+        }
+    }
+
+    this->tile_styles_.assign((size_t) cs.tileCountX() * cs.tileCountY(), mainHeaderStyle(cs));
+
+    /* tile-part COD and COC marker segments, which only appear in the first tile-part of a tile, take precedence
+       over those of the main header, and COC over COD */
+
+    for (const J2KCodestream::TilePart& tp : cs.tileParts()) {
+
+        for (const J2KCodestream::MarkerSegment& seg : tp.header) {
+
+            if (seg.marker == J2KMarker::POC || seg.marker == J2KMarker::PPT) {
+                throw std::runtime_error("POC and PPT marker segments are not supported");
+            }
+
+            if (seg.marker == J2KMarker::COD && tp.tile_part_index == 0) {
+                parse_cod(cs.data() + seg.offset + 4, seg.length - 4, this->tile_styles_[tp.tile_index]);
+            }
+        }
+
+        for (const J2KCodestream::MarkerSegment& seg : tp.header) {
+
+            if (seg.marker == J2KMarker::COC && tp.tile_part_index == 0) {
+                parse_coc(cs.data() + seg.offset + 4, seg.length - 4, this->tile_styles_[tp.tile_index]);
+            }
+        }
+    }
+}
+
+void J2KPacketIndex::_indexTile(uint16_t tile, const std::vector<size_t>& tile_parts) {
+
+    const J2KCodestream& cs = this->codestream_;
+    const TileStyle& style = this->tile_styles_[tile];
+    const std::vector<J2KCodestream::Component>& components = cs.components();
+
+    /* tile bounds on the reference grid (B.3) */
+
+    uint64_t p = tile % cs.tileCountX();
+    uint64_t q = tile / cs.tileCountX();
+
+    uint64_t tx0 = std::max<uint64_t>(cs.xtosiz() + p * cs.xtsiz(), cs.xosiz());
+    uint64_t ty0 = std::max<uint64_t>(cs.ytosiz() + q * cs.ytsiz(), cs.yosiz());
+    uint64_t tx1 = std::min<uint64_t>(cs.xtosiz() + (p + 1) * cs.xtsiz(), cs.xsiz());
+    uint64_t ty1 = std::min<uint64_t>(cs.ytosiz() + (q + 1) * cs.ytsiz(), cs.ysiz());
+
+    /* resolutions and precincts of each tile-component */
+
+    std::vector<std::vector<Resolution>> resolutions(components.size());
+
+    uint8_t max_resolutions = 0;
+
+    for (size_t c = 0; c < components.size(); c++) {
+
+        const ComponentStyle& cstyle = style.components[c];
+
+        for (uint8_t r = 0; r <= cstyle.levels; r++) {
+
+            uint64_t dx = (uint64_t) components[c].xrsiz << (cstyle.levels - r);
+            uint64_t dy = (uint64_t) components[c].yrsiz << (cstyle.levels - r);
+
+            Resolution res;
+
+            res.x0 = ceil_div(tx0, dx);
+            res.y0 = ceil_div(ty0, dy);
+            res.x1 = ceil_div(tx1, dx);
+            res.y1 = ceil_div(ty1, dy);
+
+            res.pw = res.x0 == res.x1 ? 0 : (uint32_t) (ceil_div(res.x1, (uint64_t) 1 << cstyle.ppx[r]) - (res.x0 >> cstyle.ppx[r]));
+            res.ph = res.y0 == res.y1 ? 0 : (uint32_t) (ceil_div(res.y1, (uint64_t) 1 << cstyle.ppy[r]) - (res.y0 >> cstyle.ppy[r]));
+
+            resolutions[c].push_back(res);
+        }
+
+        max_resolutions = std::max<uint8_t>(max_resolutions, cstyle.levels + 1);
+    }
+
+    /* code-block state of each precinct, created when its first packet is read */
+
+    std::map<uint64_t, std::vector<BandState>> precincts;
+
+    auto precinct_bands = [&](uint16_t c, uint8_t r, uint32_t precinct) -> std::vector<BandState>& {
+
+        uint64_t key = ((uint64_t) c << 40) | ((uint64_t) r << 32) | precinct;
+
+        std::map<uint64_t, std::vector<BandState>>::iterator it = precincts.find(key);
+
+        if (it != precincts.end()) return it->second;
+
+        const ComponentStyle& cstyle = style.components[c];
+        const Resolution& res = resolutions[c][r];
+
+        int64_t tcx0 = (int64_t) ceil_div(tx0, components[c].xrsiz);
+        int64_t tcy0 = (int64_t) ceil_div(ty0, components[c].yrsiz);
+        int64_t tcx1 = (int64_t) ceil_div(tx1, components[c].xrsiz);
+        int64_t tcy1 = (int64_t) ceil_div(ty1, components[c].yrsiz);
+
+        std::vector<BandState>& bands = precincts[key];
+
+        /* LL for the lowest resolution, and HL, LH and HH otherwise (B.5) */
+
+        static const uint8_t band_origins[4][2] = { { 0, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 } };
+
+        for (int b = r == 0 ? 0 : 1; b < (r == 0 ? 1 : 4); b++) {
+
+            uint32_t nb = r == 0 ? cstyle.levels : cstyle.levels - r + 1;
+
+            int64_t xo = band_origins[b][0] ? (int64_t) 1 << (nb - 1) : 0;
+            int64_t yo = band_origins[b][1] ? (int64_t) 1 << (nb - 1) : 0;
+
+            int64_t bx0 = ceil_div_pow2(tcx0 - xo, nb);
+            int64_t by0 = ceil_div_pow2(tcy0 - yo, nb);
+            int64_t bx1 = ceil_div_pow2(tcx1 - xo, nb);
+            int64_t by1 = ceil_div_pow2(tcy1 - yo, nb);
+
+            /* precincts and code-blocks of the band (B.6 and B.7) */
+
+            uint32_t pex = r == 0 ? cstyle.ppx[r] : cstyle.ppx[r] - 1;
+            uint32_t pey = r == 0 ? cstyle.ppy[r] : cstyle.ppy[r] - 1;
+
+            uint32_t cbx = std::min<uint32_t>(cstyle.xcb, pex);
+            uint32_t cby = std::min<uint32_t>(cstyle.ycb, pey);
+
+            int64_t px0 = (int64_t) ((res.x0 >> cstyle.ppx[r]) + precinct % res.pw) << pex;
+            int64_t py0 = (int64_t) ((res.y0 >> cstyle.ppy[r]) + precinct / res.pw) << pey;
+
+            int64_t x0 = std::max(bx0, px0);
+            int64_t y0 = std::max(by0, py0);
+            int64_t x1 = std::min(bx1, px0 + ((int64_t) 1 << pex));
+            int64_t y1 = std::min(by1, py0 + ((int64_t) 1 << pey));
+
+            if (x0 >= x1 || y0 >= y1) {
+                bands.emplace_back(0, 0);
+            } else {
+                bands.emplace_back(
+                    (uint32_t) (ceil_div_pow2(x1, cbx) - (x0 >> cbx)),
+                    (uint32_t) (ceil_div_pow2(y1, cby) - (y0 >> cby))
+                );
+            }
+        }
+
+        return bands;
+    };
+
+    /* packets are read sequentially from the bodies of the tile-parts of the tile */
+
+    const uint8_t* data = cs.data();
+
+    size_t tp_i = 0;
+    size_t pos = cs.tileParts()[tile_parts[0]].offset + cs.tileParts()[tile_parts[0]].header_length;
+    size_t end = cs.tileParts()[tile_parts[0]].offset + cs.tileParts()[tile_parts[0]].length;
+
+    bool is_exhausted = false;
+
+    auto read_packet = [&](uint16_t l, uint8_t r, uint16_t c, uint32_t precinct) {
+
+        if (is_exhausted) return;
+
+        while (pos == end && tp_i + 1 < tile_parts.size()) {
+
+            const J2KCodestream::TilePart& tp = cs.tileParts()[tile_parts[++tp_i]];
+
+            pos = tp.offset + tp.header_length;
+            end = tp.offset + tp.length;
+        }
+
+        /* the remaining packets of a truncated tile are absent */
+
+        if (pos == end) {
+            is_exhausted = true;
+            return;
+        }
+
+        Packet packet;
+
+        packet.tile = tile;
+        packet.layer = l;
+        packet.resolution = r;
+        packet.component = c;
+        packet.precinct = precinct;
+        packet.tile_part = tile_parts[tp_i];
+        packet.offset = pos;
+        packet.has_sop = style.has_sop && pos + 6 <= end && J2KCodestream::readU16(data + pos) == J2KMarker::SOP;
+
+        if (packet.has_sop) pos += 6;
+
+        PacketHeaderReader reader(data + pos, end - pos);
+
+        uint64_t body_length = 0;
+
+        /* zero length packet */
+
+        if (reader.bit()) {
+
+            const uint8_t cblk_style = style.components[c].cblk_style;
+
+            for (BandState& band : precinct_bands(c, r, precinct)) {
+
+                for (uint32_t i = 0; i < band.code_blocks.size(); i++) {
+
+                    CodeBlockState& cblk = band.code_blocks[i];
+
+                    /* inclusion */
+
+                    bool is_included = cblk.is_included ? reader.bit() != 0 : band.inclusion.decode(reader, i, l + 1);
+
+                    if (!is_included) continue;
+
+                    /* zero bit-planes */
+
+                    if (!cblk.is_included) {
+
+                        uint32_t zero_bitplanes = 0;
+
+                        while (!band.zero_bitplanes.decode(reader, i, zero_bitplanes)) {
+                            if (++zero_bitplanes > 74) {
+                                throw std::runtime_error("Bad packet header");
+                            }
+                        }
+
+                        cblk.is_included = true;
+                    }
+
+                    /* number of coding passes (Table B.4) */
+
+                    uint32_t passes;
+
+                    if (!reader.bit()) {
+                        passes = 1;
+                    } else if (!reader.bit()) {
+                        passes = 2;
+                    } else if ((passes = reader.bits(2)) != 3) {
+                        passes += 3;
+                    } else if ((passes = reader.bits(5)) != 31) {
+                        passes += 6;
+                    } else {
+                        passes = 37 + reader.bits(7);
+                    }
+
+                    /* Lblock */
+
+                    while (reader.bit()) {
+                        if (++cblk.lblock > 32) {
+                            throw std::runtime_error("Bad packet header");
+                        }
+                    }
+
+                    /* lengths of the codeword segments, which end after each coding pass in the termall mode, and
+                       alternate between raw and arithmetic-coded passes in the bypass mode (Table D.9); HT
+                       code-blocks have a cleanup segment followed by a refinement segment */
+
+                    auto start_segment = [&](bool is_first) {
+
+                        if (cblk_style & CBLK_STYLE_TERMALL) {
+                            cblk.segment_max_passes = 1;
+                        } else if (cblk_style & CBLK_STYLE_BYPASS) {
+                            cblk.segment_max_passes = is_first ? 10 : (cblk.segment_max_passes == 1 || cblk.segment_max_passes == 10 ? 2 : 1);
+                        } else {
+                            cblk.segment_max_passes = 109;
+                        }
+
+                        cblk.segment_passes = 0;
+                        cblk.segment_count++;
+                    };
+
+                    if (cblk.segment_count == 0) {
+                        start_segment(true);
+                    } else if (cblk.segment_passes == cblk.segment_max_passes) {
+                        start_segment(false);
+                    }
+
+                    while (passes > 0) {
+
+                        uint32_t segment_passes;
+
+                        if (cblk_style & CBLK_STYLE_HT) {
+                            segment_passes = cblk.segment_count == 1 ? 1 : passes;
+                        } else {
+                            segment_passes = std::min(cblk.segment_max_passes - cblk.segment_passes, passes);
+                        }
+
+                        body_length += reader.bits(cblk.lblock + floor_log2(segment_passes));
+
+                        cblk.segment_passes += segment_passes;
+                        passes -= segment_passes;
+
+                        if (passes > 0) start_segment(false);
+                    }
+                }
+            }
+        }
+
+        pos += reader.align();
+
+        if (style.has_eph) {
+
+            if (pos + 2 > end || J2KCodestream::readU16(data + pos) != J2KMarker::EPH) {
+                throw std::runtime_error("Packet header is not followed by EPH");
+            }
+
+            pos += 2;
+        }
+
+        if (body_length > end - pos) {
+            throw std::runtime_error("Packet extends past the end of its tile-part");
+        }
+
+        pos += (size_t) body_length;
+
+        packet.length = pos - packet.offset;
+
+        this->packets_.push_back(packet);
+    };
+
+    /* progression (B.12) */
+
+    auto read_layers = [&](uint8_t r, uint16_t c, uint32_t precinct) {
+        for (uint16_t l = 0; l < style.layers; l++) read_packet(l, r, c, precinct);
+    };
+
+    /* precinct of resolution r of component c that starts at reference grid position (x, y), if any */
+
+    auto precinct_at = [&](uint16_t c, uint8_t r, uint64_t x, uint64_t y, uint32_t& precinct) -> bool {
+
+        const ComponentStyle& cstyle = style.components[c];
+
+        if (r > cstyle.levels) return false;
+
+        const Resolution& res = resolutions[c][r];
+
+        if (res.pw == 0 || res.ph == 0) return false;
+
+        uint32_t level = cstyle.levels - r;
+
+        uint64_t xr = components[c].xrsiz;
+        uint64_t yr = components[c].yrsiz;
+
+        if (!(x % (xr << (cstyle.ppx[r] + level)) == 0 || (x == tx0 && (res.x0 & (((uint64_t) 1 << cstyle.ppx[r]) - 1)) != 0))) {
+            return false;
+        }
+
+        if (!(y % (yr << (cstyle.ppy[r] + level)) == 0 || (y == ty0 && (res.y0 & (((uint64_t) 1 << cstyle.ppy[r]) - 1)) != 0))) {
+            return false;
+        }
+
+        uint64_t i = (ceil_div(x, xr << level) >> cstyle.ppx[r]) - (res.x0 >> cstyle.ppx[r]);
+        uint64_t j = (ceil_div(y, yr << level) >> cstyle.ppy[r]) - (res.y0 >> cstyle.ppy[r]);
+
+        precinct = (uint32_t) (i + j * res.pw);
+
+        return true;
+    };
+
+    /* smallest precinct spacing on the reference grid across the components c0 to c1 (exclusive) */
+
+    auto spacing = [&](size_t c0, size_t c1, uint64_t& dx, uint64_t& dy) {
+
+        dx = UINT64_MAX;
+        dy = UINT64_MAX;
+
+        for (size_t c = c0; c < c1; c++) {
+
+            const ComponentStyle& cstyle = style.components[c];
+
+            for (uint8_t r = 0; r <= cstyle.levels; r++) {
+                dx = std::min(dx, (uint64_t) components[c].xrsiz << (cstyle.ppx[r] + cstyle.levels - r));
+                dy = std::min(dy, (uint64_t) components[c].yrsiz << (cstyle.ppy[r] + cstyle.levels - r));
+            }
+        }
+    };
+
+    auto for_each_position = [&](uint64_t dx, uint64_t dy, const std::function<void(uint64_t, uint64_t)>& f) {
+        for (uint64_t y = ty0; y < ty1; y += dy - (y % dy)) {
+            for (uint64_t x = tx0; x < tx1; x += dx - (x % dx)) {
+                f(x, y);
+            }
+        }
+    };
+
+    uint64_t dx, dy;
+
+    uint32_t precinct;
+
+    switch (style.progression) {
+
+    case PROGRESSION_LRCP:
+
+        for (uint16_t l = 0; l < style.layers; l++)
+            for (uint8_t r = 0; r < max_resolutions; r++)
+                for (uint16_t c = 0; c < components.size(); c++)
+                    if (r <= style.components[c].levels)
+                        for (uint32_t k = 0; k < resolutions[c][r].pw * resolutions[c][r].ph; k++)
+                            read_packet(l, r, c, k);
+        break;
+
+    case PROGRESSION_RLCP:
+
+        for (uint8_t r = 0; r < max_resolutions; r++)
+            for (uint16_t l = 0; l < style.layers; l++)
+                for (uint16_t c = 0; c < components.size(); c++)
+                    if (r <= style.components[c].levels)
+                        for (uint32_t k = 0; k < resolutions[c][r].pw * resolutions[c][r].ph; k++)
+                            read_packet(l, r, c, k);
+        break;
+
+    case PROGRESSION_RPCL:
+
+        spacing(0, components.size(), dx, dy);
+
+        for (uint8_t r = 0; r < max_resolutions; r++) {
+            for_each_position(dx, dy, [&](uint64_t x, uint64_t y) {
+                for (uint16_t c = 0; c < components.size(); c++)
+                    if (precinct_at(c, r, x, y, precinct)) read_layers(r, c, precinct);
+            });
+        }
+        break;
+
+    case PROGRESSION_PCRL:
+
+        spacing(0, components.size(), dx, dy);
+
+        for_each_position(dx, dy, [&](uint64_t x, uint64_t y) {
+            for (uint16_t c = 0; c < components.size(); c++)
+                for (uint8_t r = 0; r <= style.components[c].levels; r++)
+                    if (precinct_at(c, r, x, y, precinct)) read_layers(r, c, precinct);
+        });
+        break;
+
+    case PROGRESSION_CPRL:
+
+        for (uint16_t c = 0; c < components.size(); c++) {
+
+            spacing(c, c + 1, dx, dy);
+
+            for_each_position(dx, dy, [&](uint64_t x, uint64_t y) {
+                for (uint8_t r = 0; r <= style.components[c].levels; r++)
+                    if (precinct_at(c, r, x, y, precinct)) read_layers(r, c, precinct);
+            });
+        }
+        break;
+    }
+
+    /* all data of the tile belongs to packets */
+
+    if (pos != end) {
+        throw std::runtime_error("Tile-part data follows the last packet of the tile");
+    }
+
+    while (++tp_i < tile_parts.size()) {
+
+        const J2KCodestream::TilePart& tp = cs.tileParts()[tile_parts[tp_i]];
+
+        if (tp.header_length != tp.length) {
+            throw std::runtime_error("Tile-part data follows the last packet of the tile");
+        }
+    }
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_J2KPACKETINDEX_H
+#define COM_SANDFLOW_J2KPACKETINDEX_H
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+#include "J2KCodestream.h"
+
+/* locates the packets of a JPEG 2000 codestream by decoding their headers, without decoding code-blocks (Rec. ITU-T
+   T.800 | ISO/IEC 15444-1, Annex B), so that codestreams can be truncated at resolution, layer or tile boundaries */
+
+class J2KPacketIndex {
+
+public:
+
+    /* coding style of a tile-component, from the COD and COC marker segments that apply to it */
+
+    struct ComponentStyle {
+        uint8_t levels;                     /* number of decomposition levels */
+        uint8_t xcb;                        /* code-block width exponent */
+        uint8_t ycb;                        /* code-block height exponent */
+        uint8_t cblk_style;
+        std::vector<uint8_t> ppx;           /* precinct width exponent, by resolution level */
+        std::vector<uint8_t> ppy;           /* precinct height exponent, by resolution level */
+    };
+
+    struct TileStyle {
+        uint8_t progression;
+        uint16_t layers;
+        bool has_sop;
+        bool has_eph;
+        std::vector<ComponentStyle> components;
+    };
+
+    struct Packet {
+        uint16_t tile;
+        uint16_t layer;
+        uint8_t resolution;
+        uint16_t component;
+        uint32_t precinct;
+        size_t tile_part;                   /* index of the tile-part in J2KCodestream::tileParts() */
+        size_t offset;                      /* offset of the packet, including its SOP marker segment if any */
+        size_t length;
+        bool has_sop;
+    };
+
+    /* throws std::runtime_error if the codestream uses features that prevent packets from being located, i.e. POC,
+       PPM and PPT marker segments, or if a packet header is malformed */
+
+    J2KPacketIndex(const J2KCodestream& codestream);
+
+    /* packets of each tile in progression order, tile after tile */
+
+    const std::vector<Packet>& packets() const;
+
+    const TileStyle& tileStyle(uint16_t tile) const;
+
+    /* coding style signalled by the COD and COC marker segments of the main header */
+
+    static TileStyle mainHeaderStyle(const J2KCodestream& codestream);
+
+protected:
+
+    const J2KCodestream& codestream_;
+    std::vector<TileStyle> tile_styles_;
+    std::vector<Packet> packets_;
+
+    void _parseTileStyles();
+    void _indexTile(uint16_t tile, const std::vector<size_t>& tile_parts);
+};
+
+#endif
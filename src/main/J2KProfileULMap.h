@@ -30,7 +30,7 @@
 #include <map>
 #include <utility>
 
-std::map<int, std::pair<int, int>> J2KPROFILE_UL_MAP = {
+static std::map<int, std::pair<int, int>> J2KPROFILE_UL_MAP = {
         {1024, { 2, 1 } },
         { 1025, {2, 2} },
         { 1041, {2, 3} },
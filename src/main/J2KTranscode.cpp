@@ -0,0 +1,832 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "J2KTranscode.h"
+#include "J2KPacketIndex.h"
+#include "FileIO.h"
+#include <stdexcept>
+#include <functional>
+#include <algorithm>
+#include <memory>
+#include <map>
+
+typedef std::function<bool(const J2KCodestream::MarkerSegment& segment, std::vector<uint8_t>& body)> SegmentRewriter;
+
+static void append_u16(std::vector<uint8_t>& out, uint16_t v) {
+    out.push_back((uint8_t) (v >> 8));
+    out.push_back((uint8_t) v);
+}
+
+static void append_segment(std::vector<uint8_t>& out, uint16_t marker, const std::vector<uint8_t>& body) {
+
+    if (body.size() + 2 > UINT16_MAX) {
+        throw std::runtime_error("Marker segment is too long");
+    }
+
+    append_u16(out, marker);
+    append_u16(out, (uint16_t) (body.size() + 2));
+    out.insert(out.end(), body.begin(), body.end());
+}
+
+/* replaces the TLM marker segments of a main header by a series of marker segments in the format of the first one,
+   whose entries are filled in as tile-parts are written */
+
+class TLMWriter {
+
+public:
+
+    TLMWriter() : index_size_(0) {}
+
+    void write(std::vector<uint8_t>& out, const J2KCodestream& cs, const J2KCodestream::MarkerSegment& tlm, size_t tile_part_count) {
+
+        if (tlm.length < 6) {
+            throw std::runtime_error("Bad TLM marker segment");
+        }
+
+        this->index_size_ = (cs.data()[tlm.offset + 5] >> 4) & 0x03;
+
+        if (this->index_size_ == 3) {
+            throw std::runtime_error("Bad TLM marker segment");
+        }
+
+        /* tile-part lengths are always 32-bit */
+
+        const size_t entry_size = this->index_size_ + 4;
+        const size_t max_entries = (UINT16_MAX - 4) / entry_size;
+
+        for (uint8_t ztlm = 0; tile_part_count > 0; ztlm++) {
+
+            size_t n = std::min(tile_part_count, max_entries);
+
+            append_u16(out, J2KMarker::TLM);
+            append_u16(out, (uint16_t) (4 + n * entry_size));
+            out.push_back(ztlm);
+            out.push_back((uint8_t) ((this->index_size_ << 4) | 0x40));
+
+            for (size_t i = 0; i < n; i++) {
+                this->entries_.push_back(out.size());
+                out.insert(out.end(), entry_size, 0);
+            }
+
+            tile_part_count -= n;
+
+            if (tile_part_count > 0 && ztlm == UINT8_MAX) {
+                throw std::runtime_error("Too many tile-parts");
+            }
+        }
+    }
+
+    void set(std::vector<uint8_t>& out, size_t i, uint16_t tile, uint32_t length) const {
+
+        if (i >= this->entries_.size()) return;
+
+        uint8_t* entry = out.data() + this->entries_[i];
+
+        if (this->index_size_ == 1) {
+            *entry = (uint8_t) tile;
+        } else if (this->index_size_ == 2) {
+            J2KCodestream::writeU16(entry, tile);
+        }
+
+        J2KCodestream::writeU32(entry + this->index_size_, length);
+    }
+
+private:
+
+    uint8_t index_size_;
+    std::vector<size_t> entries_;
+};
+
+/* writes SOC and the main header of a codestream with tile_part_count tile-parts; marker segments are passed to rewrite,
+   which can modify their body or return false to drop them */
+
+static void append_main_header(std::vector<uint8_t>& out, const J2KCodestream& cs, size_t tile_part_count, TLMWriter& tlm_writer,
+    const SegmentRewriter& rewrite) {
+
+    append_u16(out, J2KMarker::SOC);
+
+    const J2KCodestream::MarkerSegment* tlm = cs.findMainHeaderSegment(J2KMarker::TLM);
+
+    std::vector<uint8_t> body;
+
+    for (const J2KCodestream::MarkerSegment& seg : cs.mainHeader()) {
+
+        if (seg.marker == J2KMarker::PLM) continue;
+
+        if (seg.marker == J2KMarker::TLM) {
+
+            if (&seg == tlm) tlm_writer.write(out, cs, seg, tile_part_count);
+
+            continue;
+        }
+
+        body.assign(cs.data() + seg.offset + 4, cs.data() + seg.offset + seg.length);
+
+        if (rewrite(seg, body)) append_segment(out, seg.marker, body);
+    }
+}
+
+/* assembles a codestream from the tile-parts of another, each made of the packets listed for it; marker segments are
+   passed to rewrite, which can modify their body or return false to drop them */
+
+static std::vector<uint8_t> assemble(const J2KCodestream& cs, const std::vector<std::vector<const J2KPacketIndex::Packet*>>& tile_part_packets,
+    const SegmentRewriter& rewrite) {
+
+    std::vector<uint8_t> out;
+
+    out.reserve(cs.size());
+
+    TLMWriter tlm_writer;
+
+    append_main_header(out, cs, cs.tileParts().size(), tlm_writer, rewrite);
+
+    std::vector<uint8_t> body;
+
+    /* tile-parts */
+
+    std::map<uint16_t, uint16_t> packet_counts;
+
+    for (size_t i = 0; i < cs.tileParts().size(); i++) {
+
+        const J2KCodestream::TilePart& tp = cs.tileParts()[i];
+
+        size_t tp_offset = out.size();
+
+        append_u16(out, J2KMarker::SOT);
+        append_u16(out, 10);
+        append_u16(out, tp.tile_index);
+        out.insert(out.end(), 4, 0);
+        out.push_back(tp.tile_part_index);
+        out.push_back(tp.tile_part_count);
+
+        for (const J2KCodestream::MarkerSegment& seg : tp.header) {
+
+            if (seg.marker == J2KMarker::PLT) continue;
+
+            body.assign(cs.data() + seg.offset + 4, cs.data() + seg.offset + seg.length);
+
+            if (rewrite(seg, body)) append_segment(out, seg.marker, body);
+        }
+
+        append_u16(out, J2KMarker::SOD);
+
+        /* packets, whose SOP marker segments are renumbered */
+
+        uint16_t& packet_count = packet_counts[tp.tile_index];
+
+        for (const J2KPacketIndex::Packet* packet : tile_part_packets[i]) {
+
+            size_t packet_offset = out.size();
+
+            out.insert(out.end(), cs.data() + packet->offset, cs.data() + packet->offset + packet->length);
+
+            if (packet->has_sop) {
+                J2KCodestream::writeU16(out.data() + packet_offset + 4, packet_count);
+            }
+
+            packet_count++;
+        }
+
+        size_t tp_length = out.size() - tp_offset;
+
+        if (tp_length > UINT32_MAX) {
+            throw std::runtime_error("Tile-part is too long");
+        }
+
+        J2KCodestream::writeU32(out.data() + tp_offset + 6, (uint32_t) tp_length);
+
+        tlm_writer.set(out, i, tp.tile_index, (uint32_t) tp_length);
+    }
+
+    append_u16(out, J2KMarker::EOC);
+
+    return out;
+}
+
+/* size of the component index of COC, QCC and RGN marker segments */
+
+static size_t component_index_size(const J2KCodestream& cs) {
+    return cs.components().size() < 257 ? 1 : 2;
+}
+
+/* removes the last levels decomposition levels from SPcod or SPcoc */
+
+static void discard_spco_levels(std::vector<uint8_t>& body, size_t spco_offset, bool has_precincts, uint8_t levels) {
+
+    if (body.size() < spco_offset + 5 || body[spco_offset] < levels) {
+        throw std::runtime_error("Codestream has fewer decomposition levels than the number of levels to discard");
+    }
+
+    body[spco_offset] -= levels;
+
+    /* precinct sizes are listed from the lowest resolution level */
+
+    if (has_precincts) {
+
+        size_t precincts_end = spco_offset + 5 + body[spco_offset] + 1;
+
+        if (body.size() < precincts_end + levels) {
+            throw std::runtime_error("Bad coding style");
+        }
+
+        body.erase(body.begin() + precincts_end, body.begin() + precincts_end + levels);
+    }
+}
+
+/* removes the step sizes of the subbands of the last levels decomposition levels from SPqcd or SPqcc */
+
+static void discard_spqc_levels(std::vector<uint8_t>& body, size_t sqc_offset, uint8_t levels) {
+
+    if (body.size() <= sqc_offset) {
+        throw std::runtime_error("Bad quantization marker segment");
+    }
+
+    uint8_t style = body[sqc_offset] & 0x1F;
+
+    /* a single step size is signalled for scalar derived quantization */
+
+    if (style == 1) return;
+
+    size_t entry_size = style == 0 ? 1 : 2;
+
+    size_t entry_count = (body.size() - sqc_offset - 1) / entry_size;
+
+    if (style > 2 || (body.size() - sqc_offset - 1) % entry_size != 0 || entry_count < 1 + 3 * (size_t) levels) {
+        throw std::runtime_error("Bad quantization marker segment");
+    }
+
+    body.resize(body.size() - 3 * levels * entry_size);
+}
+
+/* image or tile extent along one axis after reduction by 2^levels */
+
+static void scale_tiling(uint32_t size, uint32_t offset, uint32_t tile_size, uint32_t tile_offset, uint8_t levels,
+    uint8_t* siz) {
+
+    const uint64_t d = (uint64_t) 1 << levels;
+
+    uint64_t new_size = (size + d - 1) / d;
+    uint64_t new_offset = (offset + d - 1) / d;
+    uint64_t new_tile_offset = (tile_offset + d - 1) / d;
+    uint64_t new_tile_size;
+
+    uint64_t tile_count = ((uint64_t) size - tile_offset + tile_size - 1) / tile_size;
+
+    if (tile_count == 1) {
+
+        new_tile_size = new_size - new_tile_offset;
+
+    } else {
+
+        /* tile boundaries are preserved */
+
+        if (tile_size % d != 0) {
+            throw std::runtime_error("Tile size is not a multiple of the reduction factor");
+        }
+
+        new_tile_size = tile_size / d;
+
+        if ((new_size - new_tile_offset + new_tile_size - 1) / new_tile_size != tile_count) {
+            throw std::runtime_error("Tiles are empty at the reduced resolution");
+        }
+    }
+
+    J2KCodestream::writeU32(siz, (uint32_t) new_size);
+    J2KCodestream::writeU32(siz + 8, (uint32_t) new_offset);
+    J2KCodestream::writeU32(siz + 16, (uint32_t) new_tile_size);
+    J2KCodestream::writeU32(siz + 24, (uint32_t) new_tile_offset);
+}
+
+std::vector<uint8_t> discard_resolution_levels(const J2KCodestream& cs, uint8_t levels) {
+
+    J2KPacketIndex index(cs);
+
+    /* keep the packets of the lowest resolution levels of each tile-component */
+
+    std::vector<std::vector<const J2KPacketIndex::Packet*>> tile_part_packets(cs.tileParts().size());
+
+    for (uint32_t tile = 0; tile < cs.tileCountX() * cs.tileCountY(); tile++) {
+        for (const J2KPacketIndex::ComponentStyle& style : index.tileStyle((uint16_t) tile).components) {
+            if (style.levels < levels) {
+                throw std::runtime_error("Codestream has fewer decomposition levels than the number of levels to discard");
+            }
+        }
+    }
+
+    for (const J2KPacketIndex::Packet& packet : index.packets()) {
+        if (packet.resolution + levels <= index.tileStyle(packet.tile).components[packet.component].levels) {
+            tile_part_packets[packet.tile_part].push_back(&packet);
+        }
+    }
+
+    const size_t cindex_size = component_index_size(cs);
+
+    return assemble(cs, tile_part_packets, [&](const J2KCodestream::MarkerSegment& seg, std::vector<uint8_t>& body) {
+
+        switch (seg.marker) {
+
+        case J2KMarker::SIZ:
+            scale_tiling(cs.xsiz(), cs.xosiz(), cs.xtsiz(), cs.xtosiz(), levels, body.data() + 2);
+            scale_tiling(cs.ysiz(), cs.yosiz(), cs.ytsiz(), cs.ytosiz(), levels, body.data() + 6);
+            break;
+
+        case J2KMarker::COD:
+            discard_spco_levels(body, 5, (body[0] & 0x01) != 0, levels);
+            break;
+
+        case J2KMarker::COC:
+            discard_spco_levels(body, cindex_size + 1, (body[cindex_size] & 0x01) != 0, levels);
+            break;
+
+        case J2KMarker::QCD:
+            discard_spqc_levels(body, 0, levels);
+            break;
+
+        case J2KMarker::QCC:
+            discard_spqc_levels(body, cindex_size, levels);
+            break;
+        }
+
+        return true;
+    });
+}
+
+/* keeps the packets of the first layers quality layers of each tile */
+
+static std::vector<uint8_t> keep_layers(const J2KCodestream& cs, const J2KPacketIndex& index, uint16_t layers) {
+
+    std::vector<std::vector<const J2KPacketIndex::Packet*>> tile_part_packets(cs.tileParts().size());
+
+    for (const J2KPacketIndex::Packet& packet : index.packets()) {
+        if (packet.layer < layers) {
+            tile_part_packets[packet.tile_part].push_back(&packet);
+        }
+    }
+
+    return assemble(cs, tile_part_packets, [&](const J2KCodestream::MarkerSegment& seg, std::vector<uint8_t>& body) {
+
+        if (seg.marker == J2KMarker::COD) {
+
+            if (body.size() < 5) {
+                throw std::runtime_error("Bad coding style");
+            }
+
+            if (J2KCodestream::readU16(body.data() + 2) > layers) {
+                J2KCodestream::writeU16(body.data() + 2, layers);
+            }
+        }
+
+        return true;
+    });
+}
+
+static uint16_t layer_count(const J2KCodestream& cs, const J2KPacketIndex& index) {
+
+    uint16_t layers = 0;
+
+    for (uint32_t tile = 0; tile < cs.tileCountX() * cs.tileCountY(); tile++) {
+        layers = std::max(layers, index.tileStyle((uint16_t) tile).layers);
+    }
+
+    return layers;
+}
+
+std::vector<uint8_t> truncate_layers(const J2KCodestream& cs, uint16_t layers) {
+
+    if (layers == 0) {
+        throw std::runtime_error("At least one quality layer must be kept");
+    }
+
+    J2KPacketIndex index(cs);
+
+    if (layer_count(cs, index) <= layers) {
+        return std::vector<uint8_t>(cs.data(), cs.data() + cs.size());
+    }
+
+    return keep_layers(cs, index, layers);
+}
+
+std::vector<uint8_t> truncate_to_size(const J2KCodestream& cs, uint64_t max_size) {
+
+    if (cs.size() <= max_size) {
+        return std::vector<uint8_t>(cs.data(), cs.data() + cs.size());
+    }
+
+    J2KPacketIndex index(cs);
+
+    std::vector<uint8_t> first_layer = keep_layers(cs, index, 1);
+
+    if (first_layer.size() > max_size) {
+        throw std::runtime_error("First quality layer is longer than the maximum codestream size");
+    }
+
+    /* headers do not depend on the number of layers kept, so each layer adds the length of its packets */
+
+    std::vector<uint64_t> layer_lengths(layer_count(cs, index));
+
+    for (const J2KPacketIndex::Packet& packet : index.packets()) {
+        layer_lengths[packet.layer] += packet.length;
+    }
+
+    uint64_t size = first_layer.size();
+
+    uint16_t layers = 1;
+
+    while (layers < layer_lengths.size() && size + layer_lengths[layers] <= max_size) {
+        size += layer_lengths[layers++];
+    }
+
+    return layers == 1 ? first_layer : keep_layers(cs, index, layers);
+}
+
+/* tiles kept by a crop, and the geometry of the cropped image on the original reference grid */
+
+struct CropGeometry {
+    uint32_t p0, p1;        /* first and last columns of tiles */
+    uint32_t q0, q1;        /* first and last rows of tiles */
+    uint64_t xsiz, ysiz, xosiz, yosiz, xtosiz, ytosiz;
+};
+
+static CropGeometry crop_geometry(const J2KCodestream& cs, const J2KRect& rect) {
+
+    if (rect.width == 0 || rect.height == 0) {
+        throw std::runtime_error("Crop rectangle is empty");
+    }
+
+    if (cs.findMainHeaderSegment(J2KMarker::PPM)) {
+        throw std::runtime_error("PPM marker segments are not supported");
+    }
+
+    uint64_t x0 = (uint64_t) cs.xosiz() + rect.x;
+    uint64_t y0 = (uint64_t) cs.yosiz() + rect.y;
+
+    if (x0 >= cs.xsiz() || y0 >= cs.ysiz()) {
+        throw std::runtime_error("Crop rectangle lies outside of the image");
+    }
+
+    uint64_t x1 = std::min<uint64_t>(x0 + rect.width, cs.xsiz());
+    uint64_t y1 = std::min<uint64_t>(y0 + rect.height, cs.ysiz());
+
+    CropGeometry g;
+
+    g.p0 = (uint32_t) ((x0 - cs.xtosiz()) / cs.xtsiz());
+    g.p1 = (uint32_t) ((x1 - 1 - cs.xtosiz()) / cs.xtsiz());
+    g.q0 = (uint32_t) ((y0 - cs.ytosiz()) / cs.ytsiz());
+    g.q1 = (uint32_t) ((y1 - 1 - cs.ytosiz()) / cs.ytsiz());
+
+    g.xtosiz = cs.xtosiz() + (uint64_t) g.p0 * cs.xtsiz();
+    g.ytosiz = cs.ytosiz() + (uint64_t) g.q0 * cs.ytsiz();
+    g.xosiz = std::max<uint64_t>(cs.xosiz(), g.xtosiz);
+    g.yosiz = std::max<uint64_t>(cs.yosiz(), g.ytosiz);
+    g.xsiz = std::min<uint64_t>(cs.xsiz(), cs.xtosiz() + (uint64_t) (g.p1 + 1) * cs.xtsiz());
+    g.ysiz = std::min<uint64_t>(cs.ysiz(), cs.ytosiz() + (uint64_t) (g.q1 + 1) * cs.ytsiz());
+
+    return g;
+}
+
+static bool is_kept(const J2KCodestream& cs, const CropGeometry& g, uint16_t tile) {
+
+    uint32_t p = tile % cs.tileCountX();
+    uint32_t q = tile / cs.tileCountX();
+
+    return p >= g.p0 && p <= g.p1 && q >= g.q0 && q <= g.q1;
+}
+
+static uint64_t ceil_div(uint64_t a, uint64_t b) {
+    return (a + b - 1) / b;
+}
+
+/* whether the partition of [x0, x1) by multiples of 2^e is that of [x0 - d, x1 - d), translated by d */
+
+static bool is_same_partition(uint64_t x0, uint64_t x1, uint64_t d, uint32_t e) {
+
+    if ((d & (((uint64_t) 1 << e) - 1)) == 0) return true;
+
+    /* otherwise neither interval can be divided */
+
+    return (((x0 >> e) + 1) << e) >= x1 && ((((x0 - d) >> e) + 1) << e) >= x1 - d;
+}
+
+/* whether moving tiles first to last along one axis of the reference grid by -shift preserves their tile-component,
+   subband, precinct and code-block partitions, and thus the validity of their packets */
+
+static bool is_translatable(const J2KCodestream& cs, const J2KPacketIndex::TileStyle& style, bool is_x, uint32_t first,
+    uint32_t last, uint64_t shift) {
+
+    const uint64_t size = is_x ? cs.xsiz() : cs.ysiz();
+    const uint64_t offset = is_x ? cs.xosiz() : cs.yosiz();
+    const uint64_t tile_size = is_x ? cs.xtsiz() : cs.ytsiz();
+    const uint64_t tile_offset = is_x ? cs.xtosiz() : cs.ytosiz();
+
+    for (uint64_t t = first; t <= last; t++) {
+
+        uint64_t t0 = std::max(tile_offset + t * tile_size, offset);
+        uint64_t t1 = std::min(tile_offset + (t + 1) * tile_size, size);
+
+        for (size_t c = 0; c < cs.components().size(); c++) {
+
+            const J2KPacketIndex::ComponentStyle& cstyle = style.components[c];
+
+            const uint64_t sub = is_x ? cs.components()[c].xrsiz : cs.components()[c].yrsiz;
+            const uint32_t cb = is_x ? cstyle.xcb : cstyle.ycb;
+
+            /* sample positions keep their parity at every decomposition level */
+
+            if (shift % (sub << cstyle.levels) != 0) return false;
+
+            for (uint8_t r = 0; r <= cstyle.levels; r++) {
+
+                const uint32_t level = cstyle.levels - r;
+                const uint32_t pp = is_x ? cstyle.ppx[r] : cstyle.ppy[r];
+
+                uint64_t rx0 = ceil_div(t0, sub << level);
+                uint64_t rx1 = ceil_div(t1, sub << level);
+                uint64_t d = shift / (sub << level);
+
+                if (!is_same_partition(rx0, rx1, d, pp)) return false;
+
+                if (r == 0) {
+
+                    if (!is_same_partition(rx0, rx1, d, std::min(cb, pp))) return false;
+
+                } else {
+
+                    /* low-pass and high-pass subbands */
+
+                    uint64_t tc0 = ceil_div(t0, sub);
+                    uint64_t tc1 = ceil_div(t1, sub);
+
+                    for (uint64_t o = 0; o <= 1; o++) {
+
+                        uint64_t h = o << level;
+
+                        uint64_t b0 = tc0 >= h ? ceil_div(tc0 - h, (uint64_t) 2 << level) : 0;
+                        uint64_t b1 = tc1 >= h ? ceil_div(tc1 - h, (uint64_t) 2 << level) : 0;
+
+                        if (!is_same_partition(b0, b1, d / 2, std::min(cb, pp - 1))) return false;
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+/* whether the header of a tile-part, starting with its SOT marker segment, contains COD or COC marker segments */
+
+static bool has_coding_style(const uint8_t* tp, size_t length) {
+
+    for (size_t pos = 12; pos + 4 <= length; pos += 2 + (size_t) J2KCodestream::readU16(tp + pos + 2)) {
+
+        uint16_t marker = J2KCodestream::readU16(tp + pos);
+
+        if (marker == J2KMarker::SOD) break;
+
+        if (marker == J2KMarker::COD || marker == J2KMarker::COC) return true;
+    }
+
+    return false;
+}
+
+/* assembles the cropped codestream from the main header of cs and the tile-parts of the kept tiles, each given by its
+   data and length */
+
+static std::vector<uint8_t> assemble_crop(const J2KCodestream& cs, const CropGeometry& g,
+    const std::vector<std::pair<const uint8_t*, size_t>>& tile_parts) {
+
+    /* the image is moved to the origin of the reference grid if this preserves the structure of the kept tiles, as
+       determined from the main header coding style */
+
+    bool has_tile_styles = false;
+
+    for (const std::pair<const uint8_t*, size_t>& tp : tile_parts) {
+        has_tile_styles = has_tile_styles || has_coding_style(tp.first, tp.second);
+    }
+
+    uint64_t x_shift = 0;
+    uint64_t y_shift = 0;
+
+    if (!has_tile_styles) {
+
+        J2KPacketIndex::TileStyle style = J2KPacketIndex::mainHeaderStyle(cs);
+
+        if (is_translatable(cs, style, true, g.p0, g.p1, g.xtosiz)) x_shift = g.xtosiz;
+        if (is_translatable(cs, style, false, g.q0, g.q1, g.ytosiz)) y_shift = g.ytosiz;
+    }
+
+    /* profiles require the image and tiles to start at the origin, so Rsiz no longer signals one otherwise */
+
+    uint16_t rsiz = cs.rsiz();
+
+    bool was_at_origin = cs.xosiz() == 0 && cs.yosiz() == 0 && cs.xtosiz() == 0 && cs.ytosiz() == 0;
+    bool is_at_origin = g.xosiz == x_shift && g.yosiz == y_shift && g.xtosiz == x_shift && g.ytosiz == y_shift;
+
+    if (was_at_origin && !is_at_origin) rsiz &= 0xC000;
+
+    std::vector<uint8_t> out;
+
+    TLMWriter tlm_writer;
+
+    append_main_header(out, cs, tile_parts.size(), tlm_writer, [&](const J2KCodestream::MarkerSegment& seg, std::vector<uint8_t>& body) {
+
+        if (seg.marker == J2KMarker::SIZ) {
+            J2KCodestream::writeU16(body.data(), rsiz);
+            J2KCodestream::writeU32(body.data() + 2, (uint32_t) (g.xsiz - x_shift));
+            J2KCodestream::writeU32(body.data() + 6, (uint32_t) (g.ysiz - y_shift));
+            J2KCodestream::writeU32(body.data() + 10, (uint32_t) (g.xosiz - x_shift));
+            J2KCodestream::writeU32(body.data() + 14, (uint32_t) (g.yosiz - y_shift));
+            J2KCodestream::writeU32(body.data() + 26, (uint32_t) (g.xtosiz - x_shift));
+            J2KCodestream::writeU32(body.data() + 30, (uint32_t) (g.ytosiz - y_shift));
+        }
+
+        return true;
+    });
+
+    /* tile-parts are copied as is, except for their tile index */
+
+    const uint32_t columns = g.p1 - g.p0 + 1;
+
+    for (size_t i = 0; i < tile_parts.size(); i++) {
+
+        size_t tp_offset = out.size();
+
+        out.insert(out.end(), tile_parts[i].first, tile_parts[i].first + tile_parts[i].second);
+
+        uint16_t tile = J2KCodestream::readU16(tile_parts[i].first + 4);
+
+        uint16_t new_tile = (uint16_t) ((tile / cs.tileCountX() - g.q0) * columns + tile % cs.tileCountX() - g.p0);
+
+        J2KCodestream::writeU16(out.data() + tp_offset + 4, new_tile);
+        J2KCodestream::writeU32(out.data() + tp_offset + 6, (uint32_t) tile_parts[i].second);
+
+        tlm_writer.set(out, i, new_tile, (uint32_t) tile_parts[i].second);
+    }
+
+    append_u16(out, J2KMarker::EOC);
+
+    return out;
+}
+
+std::vector<uint8_t> crop_tiles(const J2KCodestream& cs, const J2KRect& rect) {
+
+    CropGeometry g = crop_geometry(cs, rect);
+
+    std::vector<std::pair<const uint8_t*, size_t>> tile_parts;
+
+    for (const J2KCodestream::TilePart& tp : cs.tileParts()) {
+        if (is_kept(cs, g, tp.tile_index)) {
+            tile_parts.push_back(std::make_pair(cs.data() + tp.offset, tp.length));
+        }
+    }
+
+    return assemble_crop(cs, g, tile_parts);
+}
+
+/* reads the tile index and length of every tile-part from TLM marker segments, returning false if they are absent or
+   malformed */
+
+static bool read_tlm(const J2KCodestream& cs, std::vector<std::pair<uint16_t, uint64_t>>& entries) {
+
+    for (const J2KCodestream::MarkerSegment& seg : cs.mainHeader()) {
+
+        if (seg.marker != J2KMarker::TLM) continue;
+
+        const uint8_t* p = cs.data() + seg.offset + 4;
+        const size_t length = seg.length - 4;
+
+        if (length < 2) return false;
+
+        const size_t index_size = (p[1] >> 4) & 0x03;
+        const size_t length_size = (p[1] & 0x40) ? 4 : 2;
+
+        if (index_size == 3 || (length - 2) % (index_size + length_size) != 0) return false;
+
+        for (size_t pos = 2; pos < length; pos += index_size + length_size) {
+
+            /* tiles have a single tile-part, in order, if their index is not signalled */
+
+            uint16_t tile = index_size == 0 ? (uint16_t) entries.size() : (index_size == 1 ? p[pos] : J2KCodestream::readU16(p + pos));
+
+            uint64_t tp_length = length_size == 4 ? J2KCodestream::readU32(p + pos + index_size) : J2KCodestream::readU16(p + pos + index_size);
+
+            entries.push_back(std::make_pair(tile, tp_length));
+        }
+    }
+
+    return !entries.empty();
+}
+
+std::vector<uint8_t> crop_tiles(int fd, uint64_t offset, uint64_t size, const J2KRect& rect) {
+
+    /* read the main header, which is usually much smaller than the codestream */
+
+    std::vector<uint8_t> header((size_t) std::min<uint64_t>(size, 65536));
+
+    std::unique_ptr<J2KCodestream> cs;
+
+    while (!cs) {
+
+        read_fd_at(fd, header.data(), header.size(), offset);
+
+        try {
+
+            cs.reset(new J2KCodestream(J2KCodestream::fromMainHeader(header.data(), header.size())));
+
+        } catch (const std::runtime_error&) {
+
+            if (header.size() == size) throw;
+
+            header.resize((size_t) std::min<uint64_t>(size, 4 * (uint64_t) header.size()));
+        }
+    }
+
+    CropGeometry g = crop_geometry(*cs, rect);
+
+    /* locate the tile-parts using TLM marker segments if they account for the whole codestream */
+
+    std::vector<std::pair<uint16_t, uint64_t>> entries;
+
+    uint64_t tp_offset = cs->mainHeaderLength();
+
+    bool is_indexed = read_tlm(*cs, entries);
+
+    for (const std::pair<uint16_t, uint64_t>& entry : entries) {
+        tp_offset += entry.second;
+    }
+
+    if (!is_indexed || tp_offset + 2 != size) {
+
+        std::vector<uint8_t> data((size_t) size);
+
+        read_fd_at(fd, data.data(), data.size(), offset);
+
+        return crop_tiles(J2KCodestream(data.data(), data.size()), rect);
+    }
+
+    /* read only the tile-parts of the kept tiles */
+
+    std::vector<uint8_t> data;
+
+    std::vector<std::pair<size_t, size_t>> kept;
+
+    tp_offset = cs->mainHeaderLength();
+
+    for (const std::pair<uint16_t, uint64_t>& entry : entries) {
+
+        if (is_kept(*cs, g, entry.first)) {
+
+            if (entry.second < 14) {
+                throw std::runtime_error("Tile-part length is inconsistent with the TLM marker segment");
+            }
+
+            kept.push_back(std::make_pair(data.size(), (size_t) entry.second));
+
+            data.resize(data.size() + (size_t) entry.second);
+
+            read_fd_at(fd, data.data() + kept.back().first, (size_t) entry.second, offset + tp_offset);
+
+            const uint8_t* sot = data.data() + kept.back().first;
+
+            uint32_t psot = J2KCodestream::readU32(sot + 6);
+
+            if (J2KCodestream::readU16(sot) != J2KMarker::SOT || J2KCodestream::readU16(sot + 4) != entry.first ||
+                (psot != entry.second && !(psot == 0 && tp_offset + entry.second + 2 == size))) {
+                throw std::runtime_error("Tile-part is inconsistent with the TLM marker segment");
+            }
+        }
+
+        tp_offset += entry.second;
+    }
+
+    std::vector<std::pair<const uint8_t*, size_t>> tile_parts;
+
+    for (const std::pair<size_t, size_t>& tp : kept) {
+        tile_parts.push_back(std::make_pair(data.data() + tp.first, tp.second));
+    }
+
+    return assemble_crop(*cs, g, tile_parts);
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_J2KTRANSCODE_H
+#define COM_SANDFLOW_J2KTRANSCODE_H
+
+#include <vector>
+#include <stdint.h>
+#include "J2KCodestream.h"
+
+/* derives codestreams from a JPEG 2000 codestream by discarding some of its packets and rewriting its marker
+   segments accordingly, without decoding it. PLT and PLM marker segments are dropped, and TLM marker segments are
+   regenerated. Functions throw std::runtime_error if the codestream cannot be transcoded. */
+
+/* returns a codestream of the image at 1/2^levels of its resolution, in which the highest levels resolution levels of
+   each tile-component are discarded */
+
+std::vector<uint8_t> discard_resolution_levels(const J2KCodestream& codestream, uint8_t levels);
+
+/* returns a codestream made of the first layers quality layers of codestream, or a copy of codestream if it has no
+   more layers */
+
+std::vector<uint8_t> truncate_layers(const J2KCodestream& codestream, uint16_t layers);
+
+/* returns the codestream made of the most quality layers of codestream that is at most max_size bytes long, throwing
+   std::runtime_error if the first layer alone is longer */
+
+std::vector<uint8_t> truncate_to_size(const J2KCodestream& codestream, uint64_t max_size);
+
+/* rectangle of the image area, in pixels from its top-left corner */
+
+struct J2KRect {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+};
+
+/* returns a codestream of the tiles that intersect rect, which keep their position on the reference grid unless the
+   image can be moved to its origin without changing the partition of the tiles into precincts and code-blocks, in
+   which case the profile signalled by Rsiz is also preserved */
+
+std::vector<uint8_t> crop_tiles(const J2KCodestream& codestream, const J2KRect& rect);
+
+/* crop_tiles() for the codestream of size bytes at offset of fd: if TLM marker segments index all of its tile-parts,
+   only its main header and the tile-parts of the tiles that intersect rect are read */
+
+std::vector<uint8_t> crop_tiles(int fd, uint64_t offset, uint64_t size, const J2KRect& rect);
+
+#endif
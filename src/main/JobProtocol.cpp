@@ -0,0 +1,259 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "JobProtocol.h"
+#include "FileIO.h"
+#include <stdexcept>
+#include <string.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+std::string default_socket_path() {
+
+    const char* dir = getenv("XDG_RUNTIME_DIR");
+
+    if (!dir || !*dir) dir = getenv("TMPDIR");
+
+    if (!dir || !*dir) dir = "/tmp";
+
+    return std::string(dir) + "/jidd.sock";
+}
+
+int connect_socket(const std::string& path) {
+
+    struct sockaddr_un addr;
+
+    memset(&addr, 0, sizeof addr);
+
+    addr.sun_family = AF_UNIX;
+
+    if (path.size() >= sizeof addr.sun_path) {
+        throw std::runtime_error("Socket path is too long");
+    }
+
+    strncpy(addr.sun_path, path.c_str(), sizeof addr.sun_path - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create socket");
+    }
+
+    if (connect(fd, (struct sockaddr*) &addr, sizeof addr) != 0) {
+        close(fd);
+        throw std::runtime_error("Cannot connect to " + path);
+    }
+
+    return fd;
+}
+
+static void append_u32(std::string& s, uint32_t v) {
+    s.push_back((char) (v >> 24));
+    s.push_back((char) (v >> 16));
+    s.push_back((char) (v >> 8));
+    s.push_back((char) v);
+}
+
+static uint32_t read_u32(const uint8_t* p) {
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+void send_request(int fd, const std::vector<std::string>& fields, const std::vector<int>& fds) {
+
+    std::string request;
+
+    append_u32(request, (uint32_t) fields.size());
+
+    for (const std::string& field : fields) {
+
+        if (field.find('\0') != std::string::npos) {
+            throw std::runtime_error("Request fields cannot contain NUL characters");
+        }
+
+        if (field.size() > UINT32_MAX) {
+            throw std::runtime_error("Request field is too long");
+        }
+
+        append_u32(request, (uint32_t) field.size());
+
+        request.append(field);
+    }
+
+    /* file descriptors are sent with the first byte of the request */
+
+    struct iovec iov;
+
+    iov.iov_base = &request[0];
+    iov.iov_len = 1;
+
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof msg);
+
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    std::vector<uint8_t> control(CMSG_SPACE(sizeof(int) * fds.size()));
+
+    if (!fds.empty()) {
+
+        msg.msg_control = control.data();
+        msg.msg_controllen = control.size();
+
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+
+        memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+    }
+
+    ssize_t sz;
+
+    while ((sz = sendmsg(fd, &msg, 0)) < 0 && errno == EINTR);
+
+    if (sz != 1) {
+        throw std::runtime_error("Cannot send request");
+    }
+
+    write_fd(fd, request.data() + 1, request.size() - 1);
+}
+
+size_t receive_with_fds(int fd, uint8_t* data, size_t size, std::vector<int>& fds) {
+
+    struct iovec iov;
+
+    iov.iov_base = data;
+    iov.iov_len = size;
+
+    /* room for the standard input, output and error of a client */
+
+    uint8_t control[CMSG_SPACE(sizeof(int) * 3)];
+
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof msg);
+
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof control;
+
+    ssize_t sz;
+
+    while ((sz = recvmsg(fd, &msg, 0)) < 0 && errno == EINTR);
+
+    if (sz < 0) {
+        throw std::runtime_error("Cannot receive request");
+    }
+
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+
+        size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+
+        for (size_t i = 0; i < count; i++) {
+
+            int received_fd;
+
+            memcpy(&received_fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+
+            fds.push_back(received_fd);
+        }
+    }
+
+    /* descriptors beyond those that fit are closed by the kernel */
+
+    if (msg.msg_flags & MSG_CTRUNC) {
+        throw std::runtime_error("Too many file descriptors received");
+    }
+
+    return (size_t) sz;
+}
+
+bool parse_request(const std::vector<uint8_t>& buffer, std::vector<std::string>& fields) {
+
+    fields.clear();
+
+    if (buffer.size() < 4) return false;
+
+    uint32_t count = read_u32(buffer.data());
+
+    size_t pos = 4;
+
+    for (uint32_t i = 0; i < count; i++) {
+
+        if (buffer.size() - pos < 4) return false;
+
+        uint32_t length = read_u32(buffer.data() + pos);
+
+        pos += 4;
+
+        if (buffer.size() - pos < length) return false;
+
+        const char* field = (const char*) buffer.data() + pos;
+
+        if (memchr(field, 0, length)) {
+            throw std::runtime_error("Request fields cannot contain NUL characters");
+        }
+
+        fields.push_back(std::string(field, length));
+
+        pos += length;
+    }
+
+    return true;
+}
+
+bool read_line(int fd, std::string& line) {
+
+    line.clear();
+
+    while (true) {
+
+        char c;
+
+        ssize_t sz = read(fd, &c, 1);
+
+        if (sz < 0 && errno == EINTR) continue;
+
+        if (sz < 0) {
+            throw std::runtime_error("Cannot read from socket");
+        }
+
+        if (sz == 0) return false;
+
+        if (c == '\n') return true;
+
+        line.push_back(c);
+    }
+}
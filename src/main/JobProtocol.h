@@ -0,0 +1,83 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_JOBPROTOCOL_H
+#define COM_SANDFLOW_JOBPROTOCOL_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+/* protocol between jidd and its clients over a Unix domain stream socket
+
+   A request is the number of its fields followed by the fields, each its length followed by its bytes, where numbers
+   are 4-byte big-endian integers, so that fields, e.g. arguments, can be empty. Fields cannot contain NUL characters:
+
+     run <priority> <memory budget> <working directory> <tool> <argument>...
+     cancel <job id>
+     status
+
+   The standard input, output and error of the client accompany a run request as SCM_RIGHTS ancillary data, so that
+   the tool reads and writes them directly. The daemon replies with newline-terminated lines:
+
+     queued <job id>
+     started <job id>
+     finished <job id> exit=<code>|signal=<number>|cancelled queued=<s> wall=<s> user=<s> system=<s> max_rss=<kB>
+     cancelled <job id>
+     job <job id> queued|running priority=<priority> tool=<tool> elapsed=<s>
+     end
+     error <message>
+
+   where cancelled follows a cancel request, job lines and end follow a status request, and the connection of a run
+   request is closed after its finished line. A job is cancelled if its client disconnects first. */
+
+/* path of the socket if none is specified: jidd.sock in $XDG_RUNTIME_DIR or, failing that, the temporary directory */
+
+std::string default_socket_path();
+
+/* connects to the daemon listening at path, throwing std::runtime_error if it cannot */
+
+int connect_socket(const std::string& path);
+
+/* sends a request, with fds as ancillary data */
+
+void send_request(int fd, const std::vector<std::string>& fields, const std::vector<int>& fds);
+
+/* receives up to size bytes and any file descriptors that accompany them, returning the number of bytes received */
+
+size_t receive_with_fds(int fd, uint8_t* data, size_t size, std::vector<int>& fds);
+
+/* parses the fields of a complete request at the start of buffer, returning false if more bytes are needed and throwing
+   std::runtime_error if a field contains a NUL character */
+
+bool parse_request(const std::vector<uint8_t>& buffer, std::vector<std::string>& fields);
+
+/* reads a newline-terminated line, without its newline, returning false at the end of the stream */
+
+bool read_line(int fd, std::string& line);
+
+#endif
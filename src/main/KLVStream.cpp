@@ -0,0 +1,251 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "KLVStream.h"
+#include <stdexcept>
+#include <string.h>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#endif
+
+static const size_t KEY_LENGTH = 16;
+
+/* reads start and end on multiples of the alignment, which matches the page and block sizes of common file systems */
+
+static const uint64_t READ_ALIGNMENT = 4096;
+
+KLVStream::KLVStream(int fd, uint64_t offset, size_t read_size) :
+    fd_(fd),
+    read_size_(read_size),
+    buf_(),
+    begin_(0),
+    end_(0),
+    buf_offset_(offset),
+    kl_length_(0),
+    length_(0),
+    is_eof_(false)
+{
+#if defined(POSIX_FADV_SEQUENTIAL)
+
+    /* doubles the kernel read-ahead window; this fails harmlessly on pipes */
+
+    (void) posix_fadvise(this->fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+#endif
+
+    /* start reading at an aligned position if the file is seekable, otherwise fd is expected to be at offset */
+
+    uint64_t aligned_offset = offset - offset % READ_ALIGNMENT;
+
+#ifdef WIN32
+    bool is_seekable = _lseeki64(this->fd_, (__int64) aligned_offset, SEEK_SET) >= 0;
+#else
+    bool is_seekable = lseek(this->fd_, (off_t) aligned_offset, SEEK_SET) >= 0;
+#endif
+
+    if (is_seekable) {
+
+        this->buf_offset_ = aligned_offset;
+
+        if (!this->_fill(offset - aligned_offset)) {
+            throw std::runtime_error("KLV stream ends before its start");
+        }
+
+        this->begin_ = (size_t) (offset - aligned_offset);
+    }
+}
+
+bool KLVStream::decodeBER(const uint8_t* p, size_t available, uint64_t& length, uint32_t& ber_size) {
+
+    if (available < 1) {
+        return false;
+    }
+
+    if ((p[0] & 0x80) == 0) {
+
+        length = p[0];
+        ber_size = 1;
+
+        return true;
+    }
+
+    ber_size = 1 + (p[0] & 0x7F);
+
+    if (ber_size > 9) {
+        throw std::runtime_error("Bad BER length");
+    }
+
+    if (available < ber_size) {
+        return false;
+    }
+
+    length = 0;
+
+    for (uint32_t i = 1; i < ber_size; i++) {
+        length = (length << 8) + p[i];
+    }
+
+    return true;
+}
+
+bool KLVStream::_fill(uint64_t size) {
+
+    if (this->end_ - this->begin_ >= size) {
+        return true;
+    }
+
+    /* move the current packet to the start of the buffer */
+
+    if (this->begin_ > 0) {
+
+        memmove(this->buf_.data(), this->buf_.data() + this->begin_, this->end_ - this->begin_);
+
+        this->end_ -= this->begin_;
+        this->buf_offset_ += this->begin_;
+        this->begin_ = 0;
+    }
+
+    /* reads are whole multiples of the read size */
+
+    if (this->buf_.size() < size + this->read_size_ + READ_ALIGNMENT) {
+        this->buf_.resize((size_t) ((size / this->read_size_ + 2) * this->read_size_ + READ_ALIGNMENT));
+    }
+
+    while (this->end_ < size) {
+
+        if (this->is_eof_) {
+            return false;
+        }
+
+        uint64_t read_end = this->buf_offset_ + this->buf_.size();
+
+        size_t rd_sz = (size_t) (read_end - read_end % READ_ALIGNMENT - (this->buf_offset_ + this->end_));
+
+#ifdef WIN32
+        int sz = _read(this->fd_, this->buf_.data() + this->end_, (unsigned int) rd_sz);
+#else
+        ssize_t sz = read(this->fd_, this->buf_.data() + this->end_, rd_sz);
+
+        if (sz < 0 && errno == EINTR) continue;
+#endif
+
+        if (sz < 0) {
+            throw std::runtime_error("Cannot read KLV stream");
+        }
+
+        if (sz == 0) {
+            this->is_eof_ = true;
+        }
+
+        this->end_ += (size_t) sz;
+    }
+
+    return true;
+}
+
+void KLVStream::_skip(uint64_t size) {
+
+    while (size > 0) {
+
+        uint64_t available = this->end_ - this->begin_;
+
+        if (available >= size) {
+            this->begin_ += (size_t) size;
+            return;
+        }
+
+        /* drop the buffered bytes and read past the rest */
+
+        size -= available;
+        this->buf_offset_ += this->end_;
+        this->begin_ = this->end_ = 0;
+
+        if (!this->_fill(size < this->read_size_ ? size : this->read_size_)) {
+            throw std::runtime_error("Truncated KLV packet");
+        }
+    }
+}
+
+bool KLVStream::next() {
+
+    /* skip the current packet */
+
+    this->_skip(this->kl_length_ + this->length_);
+
+    this->kl_length_ = 0;
+    this->length_ = 0;
+
+    /* read the key and the shortest BER length */
+
+    if (!this->_fill(KEY_LENGTH + 1)) {
+
+        if (this->end_ == this->begin_) {
+            return false;
+        }
+
+        throw std::runtime_error("Truncated KLV packet");
+    }
+
+    uint32_t ber_size = 1 + ((this->buf_[this->begin_ + KEY_LENGTH] & 0x80) ? (this->buf_[this->begin_ + KEY_LENGTH] & 0x7F) : 0);
+
+    if (!this->_fill(KEY_LENGTH + ber_size)) {
+        throw std::runtime_error("Truncated KLV packet");
+    }
+
+    if (!KLVStream::decodeBER(this->buf_.data() + this->begin_ + KEY_LENGTH, ber_size, this->length_, ber_size)) {
+        throw std::runtime_error("Bad BER length");
+    }
+
+    this->kl_length_ = KEY_LENGTH + ber_size;
+
+    return true;
+}
+
+const uint8_t* KLVStream::key() const {
+    return this->buf_.data() + this->begin_;
+}
+
+uint64_t KLVStream::length() const {
+    return this->length_;
+}
+
+uint64_t KLVStream::offset() const {
+    return this->buf_offset_ + this->begin_;
+}
+
+const uint8_t* KLVStream::value() {
+
+    if (!this->_fill(this->kl_length_ + this->length_)) {
+        throw std::runtime_error("Truncated KLV packet");
+    }
+
+    return this->buf_.data() + this->begin_ + this->kl_length_;
+}
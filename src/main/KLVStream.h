@@ -0,0 +1,87 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_KLVSTREAM_H
+#define COM_SANDFLOW_KLVSTREAM_H
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+/* reads the KLV packets of a file or pipe in order, using large read-ahead */
+
+class KLVStream {
+
+public:
+
+    /* offset is the stream position of fd, which must be the start of a KLV packet */
+
+    KLVStream(int fd, uint64_t offset = 0, size_t read_size = 8 * 1024 * 1024);
+
+    /* advances to the next KLV packet and reads its key and length; returns false at the end of the stream */
+
+    bool next();
+
+    const uint8_t* key() const;
+
+    /* length of the value of the current packet */
+
+    uint64_t length() const;
+
+    /* stream position of the current packet */
+
+    uint64_t offset() const;
+
+    /* reads the value of the current packet, which remains valid until the next call to next() */
+
+    const uint8_t* value();
+
+    /* decodes a BER length, returning false if more than available bytes are needed */
+
+    static bool decodeBER(const uint8_t* p, size_t available, uint64_t& length, uint32_t& ber_size);
+
+protected:
+
+    int fd_;
+    size_t read_size_;
+    std::vector<uint8_t> buf_;
+    size_t begin_;              /* first byte of the current packet in buf_ */
+    size_t end_;                /* end of the bytes read into buf_ */
+    uint64_t buf_offset_;       /* stream position of buf_[0] */
+    uint32_t kl_length_;
+    uint64_t length_;
+    bool is_eof_;
+
+    /* ensures that size bytes starting at begin_ are buffered, returning false if the stream ends first */
+
+    bool _fill(uint64_t size);
+
+    /* discards size bytes starting at begin_ */
+
+    void _skip(uint64_t size);
+};
+
+#endif
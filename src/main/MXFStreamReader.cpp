@@ -0,0 +1,152 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "MXFStreamReader.h"
+#include <stdexcept>
+#include <cstring>
+
+/* partition pack keys differ only in their last three bytes (SMPTE ST 377-1, Section 7.1) */
+
+static const size_t PARTITION_KEY_PREFIX_LENGTH = 13;
+
+static const uint8_t HEADER_PARTITION_KIND = 0x02;
+
+static uint64_t get_be(const uint8_t* p, int size) {
+
+    uint64_t v = 0;
+
+    for (int i = 0; i < size; i++) {
+        v = (v << 8) | p[i];
+    }
+
+    return v;
+}
+
+MXFStreamReader::MXFStreamReader(int fd) :
+    stream_(fd),
+    header_(&ASDCP::DefaultSMPTEDict()),
+    essence_ul_(ASDCP::DefaultSMPTEDict().ul(ASDCP::MDD_JPEG2000Essence)),
+    encrypted_ul_(ASDCP::DefaultSMPTEDict().ul(ASDCP::MDD_EncryptedTriplet)),
+    is_pending_(false)
+{
+    /* header partition pack */
+
+    if (!this->stream_.next() ||
+        memcmp(this->stream_.key(), this->header_.m_Dict->ul(ASDCP::MDD_ClosedCompleteHeader), PARTITION_KEY_PREFIX_LENGTH) != 0 ||
+        this->stream_.key()[PARTITION_KEY_PREFIX_LENGTH] != HEADER_PARTITION_KIND) {
+        throw std::runtime_error("Input does not start with a header partition");
+    }
+
+    /* HeaderByteCount follows MajorVersion, MinorVersion, KAGSize, ThisPartition, PreviousPartition and FooterPartition */
+
+    if (this->stream_.length() < 40) {
+        throw std::runtime_error("Bad header partition pack");
+    }
+
+    uint64_t header_byte_count = get_be(this->stream_.value() + 32, 8);
+
+    uint64_t header_end = this->stream_.offset() + ASDCP::SMPTE_UL_LENGTH;
+
+    /* the header metadata starts immediately after the partition pack and its length is known only once its first
+       packet is reached, so the end of the header metadata is determined from the offset of that packet */
+
+    std::vector<uint8_t> metadata;
+
+    bool is_first = true;
+
+    while (this->stream_.next()) {
+
+        if (is_first) {
+            header_end = this->stream_.offset() + header_byte_count;
+            is_first = false;
+        }
+
+        if (this->stream_.offset() >= header_end) {
+            this->is_pending_ = true;
+            break;
+        }
+
+        /* the packet is copied with a 9-byte BER length, which asdcplib parses regardless of the original length */
+
+        const uint8_t* value = this->stream_.value();
+
+        metadata.insert(metadata.end(), this->stream_.key(), this->stream_.key() + ASDCP::SMPTE_UL_LENGTH);
+
+        metadata.push_back(0x88);
+
+        for (int i = 7; i >= 0; i--) {
+            metadata.push_back((uint8_t) (this->stream_.length() >> (8 * i)));
+        }
+
+        metadata.insert(metadata.end(), value, value + this->stream_.length());
+    }
+
+    if (metadata.empty() || metadata.size() > UINT32_MAX ||
+        ASDCP_FAILURE(this->header_.InitFromBuffer(metadata.data(), (uint32_t) metadata.size()))) {
+        throw std::runtime_error("Cannot parse header metadata");
+    }
+}
+
+ASDCP::MXF::OP1aHeader& MXFStreamReader::header() {
+    return this->header_;
+}
+
+bool MXFStreamReader::_isEssence() {
+
+    if (ASDCP::UL(this->stream_.key()).MatchIgnoreStream(this->encrypted_ul_)) {
+        throw std::runtime_error("Streaming extraction requires plaintext essence");
+    }
+
+    return ASDCP::UL(this->stream_.key()).MatchIgnoreStream(this->essence_ul_);
+}
+
+bool MXFStreamReader::next() {
+
+    /* the first packet following the header metadata has already been read */
+
+    if (this->is_pending_) {
+
+        this->is_pending_ = false;
+
+        if (this->_isEssence()) return true;
+    }
+
+    /* skip partition packs, index table segments, fill and any repeated header metadata */
+
+    while (this->stream_.next()) {
+        if (this->_isEssence()) return true;
+    }
+
+    return false;
+}
+
+const uint8_t* MXFStreamReader::value() {
+    return this->stream_.value();
+}
+
+uint64_t MXFStreamReader::length() const {
+    return this->stream_.length();
+}
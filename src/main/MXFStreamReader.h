@@ -0,0 +1,70 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_MXFSTREAMREADER_H
+#define COM_SANDFLOW_MXFSTREAMREADER_H
+
+#include <vector>
+#include <stdint.h>
+#include <AS_02.h>
+#include <Metadata.h>
+#include "KLVStream.h"
+
+/* reads an AS-02 JPEG 2000 track file strictly sequentially, e.g. from a pipe: the header metadata is parsed from the
+   header partition and essence elements are then returned in the order they appear, without consulting index tables */
+
+class MXFStreamReader {
+
+public:
+
+    /* reads the header partition, which must start at the current position of fd */
+
+    MXFStreamReader(int fd);
+
+    ASDCP::MXF::OP1aHeader& header();
+
+    /* advances to the next essence element; returns false at the end of the stream */
+
+    bool next();
+
+    /* codestream of the current essence element, which remains valid until the next call to next() */
+
+    const uint8_t* value();
+
+    uint64_t length() const;
+
+protected:
+
+    KLVStream stream_;
+    ASDCP::MXF::OP1aHeader header_;
+    ASDCP::UL essence_ul_;
+    ASDCP::UL encrypted_ul_;
+    bool is_pending_;           /* the current packet of stream_ was read with the header metadata but not returned */
+
+    bool _isEssence();
+};
+
+#endif
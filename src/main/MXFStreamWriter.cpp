@@ -0,0 +1,238 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "MXFStreamWriter.h"
+#include "FileIO.h"
+#include <stdexcept>
+#include <cstring>
+
+/* stream identifiers used by asdcplib for AS-02 files */
+
+static const uint32_t ESSENCE_BODY_SID = 1;
+static const uint32_t INDEX_SID = 129;
+
+static void put_be(std::vector<uint8_t>& buf, uint64_t v, int size) {
+    for (int i = size - 1; i >= 0; i--) {
+        buf.push_back((uint8_t) (v >> (8 * i)));
+    }
+}
+
+/* key and BER length, 4 bytes long for structural metadata and 9 bytes long for essence */
+
+static void put_kl(std::vector<uint8_t>& buf, const byte_t* key, uint64_t length, int ber_size = 4) {
+
+    buf.insert(buf.end(), key, key + ASDCP::SMPTE_UL_LENGTH);
+
+    buf.push_back((uint8_t) (0x80 | (ber_size - 1)));
+
+    put_be(buf, length, ber_size - 1);
+}
+
+MXFStreamWriter::MXFStreamWriter(int fd, const std::vector<uint8_t>& header_partition, ASDCP::MXF::OP1aHeader& header,
+    const ASDCP::Rational& edit_rate, uint32_t partition_duration) :
+    fd_(fd),
+    header_(header),
+    edit_rate_(edit_rate),
+    partition_duration_(partition_duration == 0 ? 1 : partition_duration),
+    essence_ul_(header.m_Dict->ul(ASDCP::MDD_JPEG2000Essence)),
+    position_(0),
+    previous_partition_(0),
+    body_offset_(0),
+    partitions_(),
+    frame_count_(0),
+    partition_start_frame_(0),
+    partition_offsets_()
+{
+    if (header_partition.size() < ASDCP::SMPTE_UL_LENGTH) {
+        throw std::runtime_error("Bad header partition");
+    }
+
+    /* the header metadata is not final since the duration is unknown */
+
+    std::vector<uint8_t> buf(header_partition);
+
+    memcpy(buf.data(), header.m_Dict->ul(ASDCP::MDD_OpenIncompleteHeader), ASDCP::SMPTE_UL_LENGTH);
+
+    this->partitions_.push_back(ASDCP::MXF::RIP::PartitionPair(0, 0));
+
+    this->_write(buf.data(), buf.size());
+
+    /* the essence element key is numbered as the first and only essence element of the container */
+
+    byte_t essence_key[ASDCP::SMPTE_UL_LENGTH];
+
+    memcpy(essence_key, this->essence_ul_.Value(), ASDCP::SMPTE_UL_LENGTH);
+
+    essence_key[ASDCP::SMPTE_UL_LENGTH - 1] = 1;
+
+    this->essence_ul_ = ASDCP::UL(essence_key);
+}
+
+uint32_t MXFStreamWriter::size() const {
+    return this->frame_count_;
+}
+
+void MXFStreamWriter::_write(const uint8_t* data, size_t size) {
+
+    write_fd(this->fd_, data, size);
+
+    this->position_ += size;
+}
+
+void MXFStreamWriter::_writePartitionPack(ASDCP::MDD_t key, uint64_t index_byte_count, uint32_t index_sid, uint32_t body_sid, uint64_t body_offset) {
+
+    /* partition pack (SMPTE ST 377-1, Section 7.1) */
+
+    const ASDCP::MXF::Batch<ASDCP::UL>& essence_containers = this->header_.EssenceContainers;
+
+    std::vector<uint8_t> buf;
+
+    put_kl(buf, this->header_.m_Dict->ul(key), 88 + ASDCP::SMPTE_UL_LENGTH * essence_containers.size());
+
+    put_be(buf, this->header_.MajorVersion, 2);
+    put_be(buf, this->header_.MinorVersion, 2);
+    put_be(buf, this->header_.KAGSize, 4);
+    put_be(buf, this->position_, 8);                            /* ThisPartition */
+    put_be(buf, this->previous_partition_, 8);                  /* PreviousPartition */
+    put_be(buf, key == ASDCP::MDD_CompleteFooter ? this->position_ : 0, 8);     /* FooterPartition */
+    put_be(buf, 0, 8);                                          /* HeaderByteCount */
+    put_be(buf, index_byte_count, 8);
+    put_be(buf, index_sid, 4);
+    put_be(buf, body_offset, 8);
+    put_be(buf, body_sid, 4);
+    buf.insert(buf.end(), this->header_.OperationalPattern.Value(), this->header_.OperationalPattern.Value() + ASDCP::SMPTE_UL_LENGTH);
+    put_be(buf, essence_containers.size(), 4);
+    put_be(buf, ASDCP::SMPTE_UL_LENGTH, 4);
+
+    for (const ASDCP::UL& ul : essence_containers) {
+        buf.insert(buf.end(), ul.Value(), ul.Value() + ASDCP::SMPTE_UL_LENGTH);
+    }
+
+    this->partitions_.push_back(ASDCP::MXF::RIP::PartitionPair(body_sid, this->position_));
+
+    this->previous_partition_ = this->position_;
+
+    this->_write(buf.data(), buf.size());
+}
+
+void MXFStreamWriter::_writeIndexPartition() {
+
+    if (this->partition_offsets_.empty()) return;
+
+    ASDCP::MXF::IndexTableSegment segment(this->header_.m_Dict);
+
+    byte_t uuid[ASDCP::UUIDlen];
+
+    Kumu::GenRandomUUID(uuid);
+
+    segment.InstanceUID.Set(uuid);
+    segment.m_Lookup = &this->header_.m_Primer;
+    segment.IndexEditRate = this->edit_rate_;
+    segment.IndexStartPosition = this->partition_start_frame_;
+    segment.IndexDuration = this->partition_offsets_.size();
+    segment.EditUnitByteCount = 0;
+    segment.IndexSID = INDEX_SID;
+    segment.BodySID = ESSENCE_BODY_SID;
+    segment.SliceCount = 0;
+    segment.PosTableCount = 0;
+    segment.DeltaEntryArray.push_back(ASDCP::MXF::IndexTableSegment::DeltaEntry());
+
+    for (uint64_t offset : this->partition_offsets_) {
+
+        ASDCP::MXF::IndexTableSegment::IndexEntry entry;
+
+        entry.StreamOffset = offset;
+
+        segment.IndexEntryArray.push_back(entry);
+    }
+
+    ASDCP::FrameBuffer buf;
+
+    if (buf.Capacity(64 * Kumu::Kilobyte + (ui32_t) this->partition_offsets_.size() * 16).Failure() || segment.WriteToBuffer(buf).Failure()) {
+        throw std::runtime_error("Cannot serialize index table segment");
+    }
+
+    this->_writePartitionPack(ASDCP::MDD_ClosedCompleteBodyPartition, buf.Size(), INDEX_SID, 0, 0);
+
+    this->_write(buf.RoData(), buf.Size());
+
+    this->partition_offsets_.clear();
+}
+
+void MXFStreamWriter::writeFrame(const uint8_t* data, uint32_t size) {
+
+    /* start a new body partition, after indexing the previous one */
+
+    if (this->frame_count_ % this->partition_duration_ == 0) {
+
+        this->_writeIndexPartition();
+
+        this->partition_start_frame_ = this->frame_count_;
+
+        this->_writePartitionPack(ASDCP::MDD_ClosedCompleteBodyPartition, 0, 0, ESSENCE_BODY_SID, this->body_offset_);
+    }
+
+    std::vector<uint8_t> kl;
+
+    put_kl(kl, this->essence_ul_.Value(), size, 9);
+
+    /* index entries locate essence elements by their offset in the essence container, which body partitions carry as
+       their BodyOffset */
+
+    this->partition_offsets_.push_back(this->body_offset_);
+
+    this->_write(kl.data(), kl.size());
+
+    this->_write(data, size);
+
+    this->body_offset_ += kl.size() + size;
+
+    this->frame_count_++;
+}
+
+void MXFStreamWriter::finalize() {
+
+    this->_writeIndexPartition();
+
+    this->_writePartitionPack(ASDCP::MDD_CompleteFooter, 0, 0, 0, 0);
+
+    /* random index pack (SMPTE ST 377-1, Section 12) */
+
+    std::vector<uint8_t> buf;
+
+    const uint64_t value_length = 12 * this->partitions_.size() + 4;
+
+    put_kl(buf, this->header_.m_Dict->ul(ASDCP::MDD_RandomIndexMetadata), value_length);
+
+    for (const ASDCP::MXF::RIP::PartitionPair& pair : this->partitions_) {
+        put_be(buf, pair.BodySID, 4);
+        put_be(buf, pair.ByteOffset, 8);
+    }
+
+    put_be(buf, buf.size() + 4, 4);
+
+    this->_write(buf.data(), buf.size());
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_MXFSTREAMWRITER_H
+#define COM_SANDFLOW_MXFSTREAMWRITER_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <AS_02.h>
+
+/* writes an AS-02 track file to a file descriptor strictly sequentially, e.g. to a pipe: an open incomplete header
+   partition, then body partitions of partition_duration frames each followed by an index partition that indexes them,
+   then a footer partition and a random index pack */
+
+class MXFStreamWriter {
+
+public:
+
+    /* header_partition is a complete serialized header partition, e.g. as written by MXFWriter::OpenWrite(), whose
+       partition pack key is replaced by that of an open incomplete header partition */
+
+    MXFStreamWriter(int fd, const std::vector<uint8_t>& header_partition, ASDCP::MXF::OP1aHeader& header,
+        const ASDCP::Rational& edit_rate, uint32_t partition_duration);
+
+    void writeFrame(const uint8_t* data, uint32_t size);
+
+    void finalize();
+
+    uint32_t size() const;
+
+protected:
+
+    int fd_;
+    ASDCP::MXF::OP1aHeader& header_;
+    ASDCP::Rational edit_rate_;
+    uint32_t partition_duration_;
+    ASDCP::UL essence_ul_;
+
+    uint64_t position_;                                         /* number of bytes written */
+    uint64_t previous_partition_;
+    uint64_t body_offset_;                                      /* number of essence bytes written */
+    std::vector<ASDCP::MXF::RIP::PartitionPair> partitions_;
+
+    uint32_t frame_count_;
+    uint32_t partition_start_frame_;
+    std::vector<uint64_t> partition_offsets_;                   /* stream offsets of the frames of the current partition */
+
+    void _write(const uint8_t* data, size_t size);
+    void _writePartitionPack(ASDCP::MDD_t key, uint64_t index_byte_count, uint32_t index_sid, uint32_t body_sid, uint64_t body_offset);
+    void _writeIndexPartition();
+};
+
+#endif
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "SegmentedSequence.h"
+#include <stdexcept>
+#include <algorithm>
+
+SegmentedSequence::SegmentedSequence(const std::vector<Segment>& segments, size_t max_buffer_size) :
+    max_segment_buffer_size_(0),
+    is_stopped_(false),
+    current_segment_(0),
+    frame_(0),
+    good_(true)
+{
+    if (segments.empty()) {
+        throw std::runtime_error("At least one segment is required");
+    }
+
+    this->max_segment_buffer_size_ = max_buffer_size / segments.size();
+
+    std::vector<Segment> sorted_segments(segments);
+
+    std::sort(sorted_segments.begin(), sorted_segments.end(), [](const Segment& a, const Segment& b) {
+        return a.start_frame < b.start_frame;
+    });
+
+    /* frames before the first segment would otherwise be missing from the sequence */
+
+    if (sorted_segments.front().start_frame != 0) {
+        throw std::runtime_error("The first segment must start at frame 0");
+    }
+
+    try {
+
+        for (const Segment& segment : sorted_segments) {
+
+            if (!this->segments_.empty() && this->segments_.back()->start_frame == segment.start_frame) {
+                throw std::runtime_error("Segments must start at distinct frames");
+            }
+
+            std::unique_ptr<SegmentReader> reader(new SegmentReader());
+
+            reader->start_frame = segment.start_frame;
+            reader->buffered_size = 0;
+            reader->is_done = false;
+            reader->fp = fopen(segment.path.c_str(), "rb");
+
+            if (!reader->fp) {
+                throw std::runtime_error("Cannot open segment file " + segment.path);
+            }
+
+            this->segments_.push_back(std::move(reader));
+        }
+
+        for (std::unique_ptr<SegmentReader>& segment : this->segments_) {
+            segment->thread = std::thread(&SegmentedSequence::_read, this, std::ref(*segment));
+        }
+
+        this->frame_ = this->segments_.front()->start_frame;
+
+        this->next();
+
+    } catch (...) {
+
+        this->_stop();
+
+        throw;
+    }
+}
+
+SegmentedSequence::~SegmentedSequence() {
+    this->_stop();
+}
+
+void SegmentedSequence::_stop() {
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+
+        this->is_stopped_ = true;
+    }
+
+    this->cv_.notify_all();
+
+    /* a reader blocked on a pipe returns once the encoder writes to it or closes it */
+
+    for (std::unique_ptr<SegmentReader>& segment : this->segments_) {
+
+        if (segment->thread.joinable()) segment->thread.join();
+
+        if (segment->fp) fclose(segment->fp);
+
+        segment->fp = NULL;
+    }
+}
+
+void SegmentedSequence::_read(SegmentReader& segment) {
+
+    try {
+
+        MJCFile mjc(segment.fp);
+
+        ASDCP::JP2K::FrameBuffer fb;
+
+        while (mjc.good()) {
+
+            mjc.fill(fb);
+
+            std::vector<uint8_t> codestream(fb.RoData(), fb.RoData() + fb.Size());
+
+            {
+                std::unique_lock<std::mutex> lock(this->mutex_);
+
+                this->cv_.wait(lock, [&]() {
+                    return this->is_stopped_ || segment.frames.empty() ||
+                        segment.buffered_size + codestream.size() <= this->max_segment_buffer_size_;
+                });
+
+                if (this->is_stopped_) break;
+
+                segment.buffered_size += codestream.size();
+
+                segment.frames.push_back(std::move(codestream));
+            }
+
+            this->cv_.notify_all();
+
+            mjc.next();
+        }
+
+    } catch (...) {
+
+        std::lock_guard<std::mutex> lock(this->mutex_);
+
+        segment.error = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+
+        segment.is_done = true;
+    }
+
+    this->cv_.notify_all();
+}
+
+void SegmentedSequence::next() {
+
+    while (this->good_) {
+
+        SegmentReader& segment = *this->segments_[this->current_segment_];
+
+        const SegmentReader* next_segment = this->current_segment_ + 1 < this->segments_.size() ?
+            this->segments_[this->current_segment_ + 1].get() : NULL;
+
+        bool has_frame = false;
+
+        {
+            std::unique_lock<std::mutex> lock(this->mutex_);
+
+            this->cv_.wait(lock, [&]() { return !segment.frames.empty() || segment.is_done; });
+
+            if (!segment.frames.empty()) {
+
+                this->codestream_.swap(segment.frames.front());
+
+                segment.frames.pop_front();
+
+                segment.buffered_size -= this->codestream_.size();
+
+                has_frame = true;
+
+            } else if (segment.error) {
+
+                try {
+                    std::rethrow_exception(segment.error);
+                } catch (const std::exception& e) {
+                    throw std::runtime_error("Segment starting at frame " + std::to_string(segment.start_frame) + ": " + e.what());
+                }
+            }
+        }
+
+        if (has_frame) {
+
+            this->cv_.notify_all();
+
+            if (next_segment && this->frame_ >= next_segment->start_frame) {
+                throw std::runtime_error("Segment starting at frame " + std::to_string(segment.start_frame) +
+                    " overlaps the segment starting at frame " + std::to_string(next_segment->start_frame));
+            }
+
+            this->frame_++;
+
+            return;
+        }
+
+        /* the segment is complete */
+
+        if (!next_segment) {
+
+            this->good_ = false;
+
+        } else if (this->frame_ != next_segment->start_frame) {
+
+            throw std::runtime_error("Segment starting at frame " + std::to_string(segment.start_frame) + " ends at frame " +
+                std::to_string(this->frame_) + " before the segment starting at frame " + std::to_string(next_segment->start_frame));
+
+        } else {
+
+            this->current_segment_++;
+        }
+    }
+}
+
+bool SegmentedSequence::good() const {
+    return this->good_;
+}
+
+void SegmentedSequence::fill(ASDCP::JP2K::FrameBuffer& fb) {
+
+    ASDCP::Result_t result = fb.SetData(this->codestream_.data(), (uint32_t) this->codestream_.size());
+
+    if (ASDCP_FAILURE(result)) {
+        throw std::runtime_error("Frame buffer allocation failed");
+    }
+
+    if (fb.Size((uint32_t) this->codestream_.size()) != this->codestream_.size()) {
+        throw std::runtime_error("Frame buffer resizing failed");
+    }
+}
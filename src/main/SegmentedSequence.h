@@ -0,0 +1,97 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_SEGMENTEDSEQUENCE_H
+#define COM_SANDFLOW_SEGMENTEDSEQUENCE_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <stdio.h>
+#include "CodestreamSequence.h"
+
+/* joins MJC files or pipes, each holding a contiguous segment of frames, e.g. produced by parallel encoders, into a
+   single sequence in frame order: segments are read concurrently, and the frames of segments ahead of the one being
+   returned are buffered up to a fixed number of bytes per segment, beyond which reading the segment blocks */
+
+class SegmentedSequence : public CodestreamSequence {
+
+public:
+
+    struct Segment {
+        uint64_t start_frame;
+        std::string path;
+    };
+
+    /* the first segment starts at frame 0, each segment lasts until the start frame of the next one, and the last one
+       until its end; max_buffer_size is shared equally among segments, but a segment can always buffer one frame */
+
+    SegmentedSequence(const std::vector<Segment>& segments, size_t max_buffer_size);
+
+    virtual ~SegmentedSequence();
+
+    /* throws std::runtime_error if a segment cannot be read or has more or fewer frames than expected */
+
+    virtual void next();
+
+    virtual bool good() const;
+
+    virtual void fill(ASDCP::JP2K::FrameBuffer& fb);
+
+protected:
+
+    struct SegmentReader {
+        uint64_t start_frame;
+        FILE* fp;
+        std::deque<std::vector<uint8_t>> frames;
+        size_t buffered_size;
+        bool is_done;
+        std::exception_ptr error;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<SegmentReader>> segments_;
+    size_t max_segment_buffer_size_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool is_stopped_;
+
+    size_t current_segment_;
+    uint64_t frame_;
+    bool good_;
+    std::vector<uint8_t> codestream_;
+
+    void _read(SegmentReader& segment);
+    void _stop();
+};
+
+#endif
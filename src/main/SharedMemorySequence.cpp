@@ -0,0 +1,406 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "SharedMemorySequence.h"
+#include <stdexcept>
+#include <string.h>
+
+#ifndef WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#endif
+
+#ifdef WIN32
+
+SharedMemorySequence::SharedMemorySequence(const std::string& socket_path) :
+    fd_(-1),
+    ring_(NULL),
+    ring_size_(0),
+    good_(false),
+    has_frame_(false)
+{
+    throw std::runtime_error("Shared memory input is not supported on this platform");
+}
+
+SharedMemorySequence::~SharedMemorySequence() {}
+
+void SharedMemorySequence::next() {}
+
+void SharedMemorySequence::fill(ASDCP::JP2K::FrameBuffer& fb) {}
+
+void SharedMemorySequence::_send(const Message& msg) {}
+
+void SharedMemorySequence::_receive(Message& msg, int* ring_fd) {}
+
+void SharedMemorySequence::_abort(const std::string& reason) {}
+
+void SharedMemorySequence::_close() {}
+
+#else
+
+/* longest explanation accepted with an ABORT message */
+
+static const uint64_t MAX_REASON_SIZE = 4096;
+
+SharedMemorySequence::SharedMemorySequence(const std::string& socket_path) :
+    fd_(-1),
+    ring_(NULL),
+    ring_size_(0),
+    good_(true),
+    has_frame_(false)
+{
+    struct sockaddr_un addr;
+
+    memset(&addr, 0, sizeof addr);
+
+    addr.sun_family = AF_UNIX;
+
+    if (socket_path.size() >= sizeof addr.sun_path) {
+        throw std::runtime_error("Socket path is too long");
+    }
+
+    strncpy(addr.sun_path, socket_path.c_str(), sizeof addr.sun_path - 1);
+
+    /* remove a socket left behind by a previous run, but nothing else */
+
+    struct stat st;
+
+    if (lstat(socket_path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(socket_path.c_str());
+    }
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (listen_fd < 0) {
+        throw std::runtime_error("Cannot create socket");
+    }
+
+    /* the encoder is expected to run as the same user */
+
+    mode_t mask = umask(0077);
+
+    int result = bind(listen_fd, (struct sockaddr*) &addr, sizeof addr);
+
+    umask(mask);
+
+    if (result != 0 || listen(listen_fd, 1) != 0) {
+        close(listen_fd);
+        throw std::runtime_error("Cannot listen on " + socket_path);
+    }
+
+    while ((this->fd_ = accept(listen_fd, NULL, NULL)) < 0 && errno == EINTR);
+
+    close(listen_fd);
+
+    unlink(socket_path.c_str());
+
+    if (this->fd_ < 0) {
+        throw std::runtime_error("Cannot accept encoder on " + socket_path);
+    }
+
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(this->fd_, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof on);
+#endif
+
+    try {
+
+        Message msg;
+
+        int ring_fd = -1;
+
+        this->_receive(msg, &ring_fd);
+
+        if (msg.type != RING || ring_fd < 0) {
+            if (ring_fd >= 0) close(ring_fd);
+            this->_abort("Shared memory expected");
+        }
+
+        /* the mapped size must remain available for as long as it is mapped */
+
+#ifdef F_GET_SEALS
+        const int seals = fcntl(ring_fd, F_GET_SEALS);
+
+        if (seals < 0 || (seals & F_SEAL_SHRINK) == 0) {
+            close(ring_fd);
+            this->_abort("Shared memory must be sealed against shrinking (F_SEAL_SHRINK)");
+        }
+#else
+        close(ring_fd);
+        this->_abort("Shared memory cannot be sealed on this platform");
+#endif
+
+        /* the mapping is all that is needed once established */
+
+        if (fstat(ring_fd, &st) != 0 || msg.size == 0 || msg.size > (uint64_t) st.st_size || msg.size > SIZE_MAX) {
+            close(ring_fd);
+            this->_abort("Shared memory size is invalid");
+        }
+
+        void* ring = mmap(NULL, (size_t) msg.size, PROT_READ, MAP_SHARED, ring_fd, 0);
+
+        close(ring_fd);
+
+        if (ring == MAP_FAILED) {
+            this->_abort("Cannot map shared memory");
+        }
+
+        this->ring_ = (const uint8_t*) ring;
+        this->ring_size_ = msg.size;
+
+        this->next();
+
+    } catch (...) {
+
+        this->_close();
+
+        throw;
+    }
+}
+
+SharedMemorySequence::~SharedMemorySequence() {
+    this->_close();
+}
+
+void SharedMemorySequence::_close() {
+
+    if (this->ring_) munmap((void*) this->ring_, (size_t) this->ring_size_);
+
+    this->ring_ = NULL;
+
+    if (this->fd_ >= 0) close(this->fd_);
+
+    this->fd_ = -1;
+}
+
+static void send_all(int fd, const void* data, size_t size) {
+
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;
+#endif
+
+    const uint8_t* p = (const uint8_t*) data;
+
+    while (size > 0) {
+
+        ssize_t sz = send(fd, p, size, flags);
+
+        if (sz < 0 && errno == EINTR) continue;
+
+        if (sz <= 0) {
+            throw std::runtime_error("Encoder disconnected before the end of the stream");
+        }
+
+        p += sz;
+        size -= (size_t) sz;
+    }
+}
+
+void SharedMemorySequence::_send(const Message& msg) {
+    send_all(this->fd_, &msg, sizeof msg);
+}
+
+void SharedMemorySequence::_receive(Message& msg, int* ring_fd) {
+
+    uint8_t* data = (uint8_t*) &msg;
+
+    size_t remaining = sizeof msg;
+
+    while (remaining > 0) {
+
+        struct iovec iov;
+
+        iov.iov_base = data;
+        iov.iov_len = remaining;
+
+        uint8_t control[CMSG_SPACE(sizeof(int))];
+
+        struct msghdr hdr;
+
+        memset(&hdr, 0, sizeof hdr);
+
+        hdr.msg_iov = &iov;
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = control;
+        hdr.msg_controllen = sizeof control;
+
+        ssize_t sz = recvmsg(this->fd_, &hdr, 0);
+
+        if (sz < 0 && errno == EINTR) continue;
+
+        if (sz < 0) {
+            throw std::runtime_error("Cannot receive from encoder");
+        }
+
+        if (sz == 0) {
+            throw std::runtime_error("Encoder disconnected before the end of the stream");
+        }
+
+        /* descriptors are only expected with the shared memory */
+
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+
+            if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+
+            int fd;
+
+            memcpy(&fd, CMSG_DATA(cmsg), sizeof fd);
+
+            if (ring_fd && *ring_fd < 0) {
+                *ring_fd = fd;
+            } else {
+                close(fd);
+            }
+        }
+
+        data += sz;
+        remaining -= (size_t) sz;
+    }
+}
+
+void SharedMemorySequence::_abort(const std::string& reason) {
+
+    Message msg;
+
+    memset(&msg, 0, sizeof msg);
+
+    msg.type = ABORT;
+    msg.size = reason.size();
+
+    try {
+
+        this->_send(msg);
+
+        send_all(this->fd_, reason.data(), reason.size());
+
+    } catch (const std::runtime_error&) {
+        /* the encoder is gone */
+    }
+
+    throw std::runtime_error(reason);
+}
+
+void SharedMemorySequence::next() {
+
+    if (!this->good_) return;
+
+    if (this->has_frame_) {
+
+        Message msg;
+
+        memset(&msg, 0, sizeof msg);
+
+        msg.type = FRAME_CONSUMED;
+        msg.offset = this->frame_.offset;
+        msg.size = this->frame_.size;
+
+        this->has_frame_ = false;
+
+        this->_send(msg);
+    }
+
+    Message msg;
+
+    this->_receive(msg, NULL);
+
+    switch (msg.type) {
+
+    case FRAME_READY:
+
+        if (msg.size == 0 || msg.size > UINT32_MAX || msg.offset > this->ring_size_ || msg.size > this->ring_size_ - msg.offset) {
+            this->_abort("Codestream is outside the shared memory");
+        }
+
+        this->frame_ = msg;
+        this->has_frame_ = true;
+
+        break;
+
+    case END_OF_STREAM:
+
+        this->good_ = false;
+
+        break;
+
+    case ABORT: {
+
+        std::string reason;
+
+        if (msg.size <= MAX_REASON_SIZE) {
+
+            reason.resize((size_t) msg.size);
+
+            for (size_t i = 0; i < reason.size(); ) {
+
+                ssize_t sz = read(this->fd_, &reason[i], reason.size() - i);
+
+                if (sz < 0 && errno == EINTR) continue;
+
+                if (sz <= 0) break;
+
+                i += (size_t) sz;
+            }
+        }
+
+        throw std::runtime_error("Encoder aborted: " + reason);
+    }
+
+    default:
+
+        this->_abort("Unexpected message " + std::to_string(msg.type));
+    }
+}
+
+void SharedMemorySequence::fill(ASDCP::JP2K::FrameBuffer& fb) {
+
+    /* the MXF writer only reads the codestream, so the read-only mapping is handed over as is */
+
+    byte_t* data = (byte_t*) (this->ring_ + this->frame_.offset);
+
+    ASDCP::Result_t result = fb.SetData(data, (uint32_t) this->frame_.size);
+
+    if (ASDCP_FAILURE(result)) {
+        throw std::runtime_error("Frame buffer allocation failed");
+    }
+
+    if (fb.Size((uint32_t) this->frame_.size) != this->frame_.size) {
+        throw std::runtime_error("Frame buffer resizing failed");
+    }
+}
+
+#endif
+
+bool SharedMemorySequence::good() const {
+    return this->good_;
+}
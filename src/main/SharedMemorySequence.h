@@ -0,0 +1,109 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_SHAREDMEMORYSEQUENCE_H
+#define COM_SANDFLOW_SHAREDMEMORYSEQUENCE_H
+
+#include <string>
+#include <stdint.h>
+#include "CodestreamSequence.h"
+
+/* reads codestreams that a co-located encoder writes into shared memory and passes them to the MXF writer without
+   copying them. The shared memory must be a memfd created with MFD_ALLOW_SEALING and sealed with F_SEAL_SHRINK before it
+   is passed, since the writer would crash if the memory it maps were truncated. Only supported on Linux.
+
+   The sequence listens on a Unix domain socket and accepts a single encoder. The encoder and the sequence then
+   exchange fixed-size messages, in native byte order:
+
+     RING            encoder to sequence, first: the sealed shared memory, passed as SCM_RIGHTS ancillary data, is
+                     size bytes long
+     FRAME_READY     encoder to sequence: a complete codestream is at [offset, offset + size) in the shared memory
+     FRAME_CONSUMED  sequence to encoder: the codestream of the matching FRAME_READY is written and its bytes can be
+                     reused
+     END_OF_STREAM   encoder to sequence: there are no more codestreams
+     ABORT           either way: the stream is abandoned, and the message is followed by size bytes of explanation
+
+   The encoder can make several codestreams ready ahead of the writer. Codestreams are consumed in the order in which
+   they are made ready, so that the shared memory can be managed as a ring buffer, but the bytes of a codestream must
+   not be modified until it is consumed. The encoder keeps the socket open after END_OF_STREAM, until the remaining
+   codestreams are consumed and the sequence closes it. If the writer fails, the socket is closed. */
+
+class SharedMemorySequence : public CodestreamSequence {
+
+public:
+
+    enum MessageType : uint32_t {
+        RING = 1,
+        FRAME_READY = 2,
+        FRAME_CONSUMED = 3,
+        END_OF_STREAM = 4,
+        ABORT = 5
+    };
+
+    struct Message {
+        uint32_t type;
+        uint32_t reserved;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    /* blocks until an encoder connects to the socket at socket_path and supplies its shared memory */
+
+    SharedMemorySequence(const std::string& socket_path);
+
+    virtual ~SharedMemorySequence();
+
+    SharedMemorySequence(const SharedMemorySequence&) = delete;
+
+    SharedMemorySequence& operator=(const SharedMemorySequence&) = delete;
+
+    /* releases the current codestream to the encoder and waits for the next one; throws std::runtime_error if the
+       encoder aborts, disconnects before the end of the stream or sends an invalid message */
+
+    virtual void next();
+
+    virtual bool good() const;
+
+    /* the frame buffer points to the shared memory, and remains valid until next() is called */
+
+    virtual void fill(ASDCP::JP2K::FrameBuffer& fb);
+
+protected:
+
+    int fd_;
+    const uint8_t* ring_;
+    uint64_t ring_size_;
+    bool good_;
+    bool has_frame_;
+    Message frame_;
+
+    void _send(const Message& msg);
+    void _receive(Message& msg, int* ring_fd);
+    void _abort(const std::string& reason);
+    void _close();
+};
+
+#endif
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Timecode.h"
+#include <stdexcept>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+
+Timecode::Timecode(uint16_t rounded_base, bool drop_frame, uint64_t start_timecode) :
+    rounded_base_(rounded_base),
+    drop_frame_(drop_frame),
+    start_timecode_(start_timecode)
+{
+    if (this->rounded_base_ == 0) {
+        throw std::runtime_error("Timecode base cannot be 0");
+    }
+
+    if (this->drop_frame_ && this->rounded_base_ % 30 != 0) {
+        throw std::runtime_error("Drop frame timecode requires a base that is a multiple of 30");
+    }
+}
+
+Timecode Timecode::fromHeader(ASDCP::MXF::OP1aHeader& header) {
+
+    ASDCP::MXF::InterchangeObject* obj = NULL;
+
+    ASDCP::Result_t result = header.GetMDObjectByType(header.m_Dict->Type(ASDCP::MDD_TimecodeComponent).ul, &obj);
+
+    if (result.Success() && obj) {
+
+        ASDCP::MXF::TimecodeComponent* tc = static_cast<ASDCP::MXF::TimecodeComponent*>(obj);
+
+        return Timecode(tc->RoundedTimecodeBase, tc->DropFrame != 0, tc->StartTimecode);
+
+    }
+
+    /* no timecode track: count from zero at the rounded edit rate */
+
+    ASDCP::Rational edit_rate;
+
+    if (!ASDCP::MXF::GetEditRateFromFP(header, edit_rate)) {
+        throw std::runtime_error("Cannot read edit rate from input file");
+    }
+
+    return Timecode((uint16_t) std::lround(edit_rate.Quotient()));
+}
+
+uint64_t Timecode::_toCount(uint32_t hh, uint32_t mm, uint32_t ss, uint32_t ff) const {
+
+    if (mm > 59 || ss > 59 || ff >= this->rounded_base_) {
+        throw std::runtime_error("Timecode out of range");
+    }
+
+    uint64_t count = ((uint64_t) hh * 3600 + mm * 60 + ss) * this->rounded_base_ + ff;
+
+    if (this->drop_frame_) {
+
+        /* frame numbers 0 and 1 (0 to 3 at 60 fps) are dropped every minute except every tenth minute */
+
+        uint32_t dropped = this->rounded_base_ / 15;
+
+        uint64_t minutes = (uint64_t) hh * 60 + mm;
+
+        if (ss == 0 && ff < dropped && minutes % 10 != 0) {
+            throw std::runtime_error("Timecode does not exist in drop frame counting");
+        }
+
+        count -= dropped * (minutes - minutes / 10);
+    }
+
+    return count;
+}
+
+uint64_t Timecode::toFrame(const std::string& tc) const {
+
+    uint32_t hh, mm, ss, ff;
+    char sep[3];
+
+    std::istringstream is(tc);
+
+    is >> hh >> sep[0] >> mm >> sep[1] >> ss >> sep[2] >> ff;
+
+    if (is.fail() || !is.eof() || sep[0] != ':' || sep[1] != ':' || (sep[2] != ':' && sep[2] != ';')) {
+        throw std::runtime_error("Bad timecode: " + tc);
+    }
+
+    uint64_t count = this->_toCount(hh, mm, ss, ff);
+
+    if (count < this->start_timecode_) {
+        throw std::runtime_error("Timecode precedes the start of the file: " + tc);
+    }
+
+    return count - this->start_timecode_;
+}
+
+uint64_t Timecode::parsePosition(const std::string& s) const {
+
+    if (s.find_first_of(":;") != std::string::npos) {
+        return this->toFrame(s);
+    }
+
+    std::istringstream is(s);
+
+    uint64_t frame;
+
+    is >> frame;
+
+    if (is.fail() || !is.eof()) {
+        throw std::runtime_error("Bad frame position: " + s);
+    }
+
+    return frame;
+}
+
+std::string Timecode::toString(uint64_t frame) const {
+
+    uint64_t count = frame + this->start_timecode_;
+
+    if (this->drop_frame_) {
+
+        /* reinsert the dropped frame numbers */
+
+        uint64_t dropped = this->rounded_base_ / 15;
+        uint64_t frames_per_10min = this->rounded_base_ * 600 - dropped * 9;
+        uint64_t frames_per_min = this->rounded_base_ * 60 - dropped;
+
+        uint64_t tens = count / frames_per_10min;
+        uint64_t rem = count % frames_per_10min;
+
+        count += dropped * 9 * tens;
+
+        if (rem > dropped) {
+            count += dropped * ((rem - dropped) / frames_per_min);
+        }
+    }
+
+    std::ostringstream os;
+
+    os << std::setfill('0')
+        << std::setw(2) << count / (3600 * (uint64_t) this->rounded_base_) << ":"
+        << std::setw(2) << (count / (60 * this->rounded_base_)) % 60 << ":"
+        << std::setw(2) << (count / this->rounded_base_) % 60
+        << (this->drop_frame_ ? ";" : ":")
+        << std::setw(2) << count % this->rounded_base_;
+
+    return os.str();
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_TIMECODE_H
+#define COM_SANDFLOW_TIMECODE_H
+
+#include <string>
+#include <stdint.h>
+#include <AS_DCP.h>
+#include <Metadata.h>
+
+/* converts between SMPTE timecodes and frame indices within a track file */
+
+class Timecode {
+
+public:
+
+    Timecode(uint16_t rounded_base, bool drop_frame = false, uint64_t start_timecode = 0);
+
+    /* uses the first TimecodeComponent of the header metadata, or the edit rate if none is present */
+
+    static Timecode fromHeader(ASDCP::MXF::OP1aHeader& header);
+
+    /* frame index of a timecode in the form HH:MM:SS:FF (or HH:MM:SS;FF) */
+
+    uint64_t toFrame(const std::string& tc) const;
+
+    /* frame index from either a timecode or a decimal frame index */
+
+    uint64_t parsePosition(const std::string& s) const;
+
+    std::string toString(uint64_t frame) const;
+
+protected:
+
+    uint16_t rounded_base_;
+    bool drop_frame_;
+    uint64_t start_timecode_;
+
+    uint64_t _toCount(uint32_t hh, uint32_t mm, uint32_t ss, uint32_t ff) const;
+};
+
+#endif
@@ -0,0 +1,461 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TrackFileBuilder.h"
+#include "FileIO.h"
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+/* stream identifiers used by asdcplib for AS-02 files */
+
+static const uint32_t ESSENCE_BODY_SID = 1;
+static const uint32_t INDEX_SID = 129;
+
+/* maximum number of entries of an index table segment, which keeps each segment well below the 64 KB limit of local
+   set items */
+
+static const uint32_t MAX_SEGMENT_ENTRIES = 4096;
+
+TrackFileBuilder::TrackFileBuilder(ASDCP::MXF::OP1aHeader& header, const ASDCP::Rational& edit_rate, uint32_t header_size) :
+    header_(header),
+    edit_rate_(edit_rate),
+    header_size_(header_size),
+    value_alignment_(1),
+    frames_() {}
+
+/* KLV fill packets use a 4-byte BER length */
+
+static const uint32_t FILL_KL_SIZE = ASDCP::SMPTE_UL_LENGTH + 4;
+
+/* generated essence element keys and lengths use a 9-byte BER length */
+
+static const uint32_t ESSENCE_KL_SIZE = ASDCP::SMPTE_UL_LENGTH + 9;
+
+void TrackFileBuilder::addFrame(int fd, uint64_t klv_offset, uint32_t kl_size, uint64_t value_size, const IndexEntry& entry) {
+
+    Frame frame;
+
+    frame.fd = fd;
+    frame.klv_offset = klv_offset;
+    frame.has_kl = true;
+    frame.kl_size = kl_size;
+    frame.value_size = value_size;
+    frame.entry = entry;
+    frame.fill_size = 0;
+
+    this->frames_.push_back(frame);
+}
+
+void TrackFileBuilder::addCodestream(int fd, uint64_t offset, uint64_t size, const IndexEntry& entry) {
+
+    Frame frame;
+
+    frame.fd = fd;
+    frame.klv_offset = offset;
+    frame.has_kl = false;
+    frame.kl_size = ESSENCE_KL_SIZE;
+    frame.value_size = size;
+    frame.entry = entry;
+    frame.fill_size = 0;
+
+    this->frames_.push_back(frame);
+}
+
+void TrackFileBuilder::addFrames(const FrameIndex& index, uint32_t start_frame, uint32_t end_frame) {
+
+    for (uint32_t i = start_frame; i < end_frame; i++) {
+
+        FrameIndex::Entry entry = index.lookup(i);
+
+        this->addFrame(index.fd(), entry.klv_offset, (uint32_t) (entry.essence_offset - entry.klv_offset), entry.essence_length, index.indexEntry(i));
+    }
+}
+
+uint32_t TrackFileBuilder::size() const {
+    return (uint32_t) this->frames_.size();
+}
+
+void TrackFileBuilder::setValueAlignment(uint32_t alignment) {
+
+    /* fill packets use a 4-byte BER length */
+
+    if (alignment == 0 || alignment > 0xFFFFFF) {
+        throw std::runtime_error("Alignment must be between 1 and 16777215");
+    }
+
+    this->value_alignment_ = alignment;
+}
+
+uint64_t TrackFileBuilder::_layoutEssence(uint64_t essence_offset) {
+
+    uint64_t offset = essence_offset;
+
+    for (Frame& frame : this->frames_) {
+
+        frame.fill_size = 0;
+
+        uint64_t misalignment = (offset + frame.kl_size) % this->value_alignment_;
+
+        if (misalignment != 0) {
+
+            /* the fill packet is at least as large as its key and length */
+
+            frame.fill_size = this->value_alignment_ - misalignment;
+
+            while (frame.fill_size < FILL_KL_SIZE) {
+                frame.fill_size += this->value_alignment_;
+            }
+        }
+
+        offset += frame.fill_size + frame.kl_size + frame.value_size;
+    }
+
+    return offset;
+}
+
+void TrackFileBuilder::_initPartition(ASDCP::MXF::Partition& partition) const {
+
+    partition.MajorVersion = this->header_.MajorVersion;
+    partition.MinorVersion = this->header_.MinorVersion;
+    partition.KAGSize = this->header_.KAGSize;
+    partition.OperationalPattern = this->header_.OperationalPattern;
+    partition.EssenceContainers = this->header_.EssenceContainers;
+    partition.HeaderByteCount = 0;
+    partition.IndexByteCount = 0;
+    partition.IndexSID = 0;
+    partition.BodySID = 0;
+    partition.BodyOffset = 0;
+}
+
+void TrackFileBuilder::_serializeIndex(std::vector<uint8_t>& index_data) const {
+
+    index_data.clear();
+
+    /* stream offsets are counted from the start of the essence container, which starts the body partition */
+
+    uint64_t stream_offset = 0;
+
+    for (uint32_t start = 0; start < this->frames_.size(); start += MAX_SEGMENT_ENTRIES) {
+
+        ASDCP::MXF::IndexTableSegment segment(this->header_.m_Dict);
+
+        byte_t uuid[ASDCP::UUIDlen];
+
+        Kumu::GenRandomUUID(uuid);
+
+        segment.InstanceUID.Set(uuid);
+        segment.m_Lookup = &this->header_.m_Primer;
+        segment.IndexEditRate = this->edit_rate_;
+        segment.IndexStartPosition = start;
+        segment.EditUnitByteCount = 0;
+        segment.IndexSID = INDEX_SID;
+        segment.BodySID = ESSENCE_BODY_SID;
+        segment.SliceCount = 0;
+        segment.PosTableCount = 0;
+        segment.DeltaEntryArray.push_back(ASDCP::MXF::IndexTableSegment::DeltaEntry());
+
+        uint32_t end = std::min((uint32_t) this->frames_.size(), start + MAX_SEGMENT_ENTRIES);
+
+        segment.IndexDuration = end - start;
+
+        for (uint32_t i = start; i < end; i++) {
+
+            IndexEntry entry = this->frames_[i].entry;
+
+            entry.StreamOffset = stream_offset + this->frames_[i].fill_size;
+
+            segment.IndexEntryArray.push_back(entry);
+
+            stream_offset = entry.StreamOffset + this->frames_[i].kl_size + this->frames_[i].value_size;
+        }
+
+        ASDCP::FrameBuffer buf;
+
+        if (buf.Capacity(64 * Kumu::Kilobyte + MAX_SEGMENT_ENTRIES * 16).Failure() || segment.WriteToBuffer(buf).Failure()) {
+            throw std::runtime_error("Cannot serialize index table segment");
+        }
+
+        index_data.insert(index_data.end(), buf.RoData(), buf.RoData() + buf.Size());
+    }
+}
+
+void TrackFileBuilder::_setDurations() {
+
+    const ASDCP::Dictionary* dict = this->header_.m_Dict;
+
+    /* components of the material and file package tracks */
+
+    const ASDCP::MDD_t component_types[] = { ASDCP::MDD_Sequence, ASDCP::MDD_SourceClip, ASDCP::MDD_TimecodeComponent };
+
+    for (ASDCP::MDD_t type : component_types) {
+
+        std::list<ASDCP::MXF::InterchangeObject*> objects;
+
+        this->header_.GetMDObjectsByType(dict->ul(type), objects);
+
+        for (ASDCP::MXF::InterchangeObject* obj : objects) {
+            static_cast<ASDCP::MXF::StructuralComponent*>(obj)->Duration = this->frames_.size();
+        }
+    }
+
+    /* the container duration is optional and left absent if it is */
+
+    const ASDCP::MDD_t descriptor_types[] = { ASDCP::MDD_RGBAEssenceDescriptor, ASDCP::MDD_CDCIEssenceDescriptor };
+
+    for (ASDCP::MDD_t type : descriptor_types) {
+
+        std::list<ASDCP::MXF::InterchangeObject*> objects;
+
+        this->header_.GetMDObjectsByType(dict->ul(type), objects);
+
+        for (ASDCP::MXF::InterchangeObject* obj : objects) {
+
+            ASDCP::MXF::FileDescriptor* desc = static_cast<ASDCP::MXF::FileDescriptor*>(obj);
+
+            if (!desc->ContainerDuration.empty()) {
+                desc->ContainerDuration = this->frames_.size();
+            }
+        }
+    }
+}
+
+void TrackFileBuilder::write(const std::string& path) {
+
+    const ASDCP::Dictionary* dict = this->header_.m_Dict;
+
+    this->_setDurations();
+
+    /* layout: header partition, index partition, essence partition, footer partition, random index pack */
+
+    ASDCP::MXF::Partition index_partition(dict);
+
+    this->_initPartition(index_partition);
+
+    ASDCP::MXF::Partition body_partition(dict);
+
+    this->_initPartition(body_partition);
+
+    ASDCP::MXF::Partition footer_partition(dict);
+
+    this->_initPartition(footer_partition);
+
+    const uint64_t index_partition_offset = this->header_size_;
+
+    /* the size of the index does not depend on the stream offsets it contains, which depend on the fill that aligns
+       the essence in the file */
+
+    std::vector<uint8_t> index_data;
+
+    this->_serializeIndex(index_data);
+
+    const uint64_t body_partition_offset = index_partition_offset + index_partition.ArchiveSize() + index_data.size();
+
+    const uint64_t essence_offset = body_partition_offset + body_partition.ArchiveSize();
+
+    const uint64_t footer_partition_offset = this->_layoutEssence(essence_offset);
+
+    this->_serializeIndex(index_data);
+
+    /* partition packs */
+
+    this->header_.ThisPartition = 0;
+    this->header_.PreviousPartition = 0;
+    this->header_.FooterPartition = footer_partition_offset;
+    this->header_.IndexByteCount = 0;
+    this->header_.IndexSID = 0;
+    this->header_.BodySID = 0;
+    this->header_.BodyOffset = 0;
+
+    index_partition.ThisPartition = index_partition_offset;
+    index_partition.PreviousPartition = 0;
+    index_partition.FooterPartition = footer_partition_offset;
+    index_partition.IndexByteCount = index_data.size();
+    index_partition.IndexSID = INDEX_SID;
+
+    body_partition.ThisPartition = body_partition_offset;
+    body_partition.PreviousPartition = index_partition_offset;
+    body_partition.FooterPartition = footer_partition_offset;
+    body_partition.BodySID = ESSENCE_BODY_SID;
+
+    footer_partition.ThisPartition = footer_partition_offset;
+    footer_partition.PreviousPartition = body_partition_offset;
+    footer_partition.FooterPartition = footer_partition_offset;
+
+    ASDCP::UL body_ul(dict->ul(ASDCP::MDD_ClosedCompleteBodyPartition));
+
+    ASDCP::UL footer_ul(dict->ul(ASDCP::MDD_CompleteFooter));
+
+    ASDCP::UL fill_ul(dict->ul(ASDCP::MDD_KLVFill));
+
+    /* header, index and the essence partition pack */
+
+    Kumu::FileWriter writer;
+
+    if (writer.OpenWrite(path).Failure()) {
+        throw std::runtime_error("Cannot open output file: " + path);
+    }
+
+    ui32_t write_count = 0;
+
+    if (this->header_.WriteToFile(writer, this->header_size_).Failure() ||
+        index_partition.WriteToFile(writer, body_ul).Failure() ||
+        writer.Write(index_data.data(), (ui32_t) index_data.size(), &write_count).Failure() ||
+        write_count != index_data.size() ||
+        body_partition.WriteToFile(writer, body_ul).Failure()) {
+        throw std::runtime_error("Cannot write header partition and index table");
+    }
+
+    writer.Close();
+
+    /* the essence is copied in large sequential ranges, within the kernel where possible */
+
+#ifdef WIN32
+    int out_fd = _open(path.c_str(), _O_WRONLY | _O_BINARY);
+#else
+    int out_fd = open(path.c_str(), O_WRONLY);
+#endif
+
+    if (out_fd < 0) {
+        throw std::runtime_error("Cannot open output file: " + path);
+    }
+
+    try {
+
+#ifdef WIN32
+        if (_lseeki64(out_fd, (__int64) essence_offset, SEEK_SET) < 0) {
+#else
+        if (lseek(out_fd, (off_t) essence_offset, SEEK_SET) < 0) {
+#endif
+            throw std::runtime_error("Cannot seek in output file");
+        }
+
+        std::vector<uint8_t> fill;
+
+        /* the essence element key is numbered as the first and only essence element of the container */
+
+        uint8_t essence_kl[ESSENCE_KL_SIZE];
+
+        memcpy(essence_kl, dict->ul(ASDCP::MDD_JPEG2000Essence), ASDCP::SMPTE_UL_LENGTH);
+
+        essence_kl[ASDCP::SMPTE_UL_LENGTH - 1] = 1;
+
+        essence_kl[ASDCP::SMPTE_UL_LENGTH] = 0x88;
+
+        for (size_t i = 0; i < this->frames_.size(); ) {
+
+            const Frame& first = this->frames_[i];
+
+            if (first.fill_size > 0) {
+
+                fill.assign((size_t) first.fill_size, 0);
+
+                memcpy(fill.data(), fill_ul.Value(), ASDCP::SMPTE_UL_LENGTH);
+
+                /* 4-byte BER length */
+
+                uint64_t fill_length = first.fill_size - FILL_KL_SIZE;
+
+                fill[16] = 0x83;
+                fill[17] = (uint8_t) (fill_length >> 16);
+                fill[18] = (uint8_t) (fill_length >> 8);
+                fill[19] = (uint8_t) fill_length;
+
+                write_fd(out_fd, fill.data(), fill.size());
+            }
+
+            if (!first.has_kl) {
+
+                for (int j = 0; j < 8; j++) {
+                    essence_kl[ASDCP::SMPTE_UL_LENGTH + 1 + j] = (uint8_t) (first.value_size >> (8 * (7 - j)));
+                }
+
+                write_fd(out_fd, essence_kl, sizeof essence_kl);
+
+                copy_fd_range(out_fd, first.fd, first.klv_offset, first.value_size);
+
+                i++;
+
+                continue;
+            }
+
+            /* coalesce frames that are contiguous in the same input file and not separated by fill */
+
+            uint64_t size = first.kl_size + first.value_size;
+
+            for (i++; i < this->frames_.size() &&
+                this->frames_[i].has_kl &&
+                this->frames_[i].fill_size == 0 &&
+                this->frames_[i].fd == first.fd &&
+                this->frames_[i].klv_offset == first.klv_offset + size; i++) {
+                size += this->frames_[i].kl_size + this->frames_[i].value_size;
+            }
+
+            copy_fd_range(out_fd, first.fd, first.klv_offset, size);
+        }
+
+    } catch (...) {
+
+#ifdef WIN32
+        _close(out_fd);
+#else
+        close(out_fd);
+#endif
+
+        throw;
+    }
+
+#ifdef WIN32
+    _close(out_fd);
+#else
+    close(out_fd);
+#endif
+
+    /* footer and random index pack */
+
+    ASDCP::MXF::RIP rip(dict);
+
+    rip.PairArray.push_back(ASDCP::MXF::RIP::PartitionPair(0, 0));
+    rip.PairArray.push_back(ASDCP::MXF::RIP::PartitionPair(0, index_partition_offset));
+    rip.PairArray.push_back(ASDCP::MXF::RIP::PartitionPair(ESSENCE_BODY_SID, body_partition_offset));
+    rip.PairArray.push_back(ASDCP::MXF::RIP::PartitionPair(0, footer_partition_offset));
+
+    if (writer.OpenModify(path).Failure() ||
+        writer.Seek(footer_partition_offset).Failure() ||
+        footer_partition.WriteToFile(writer, footer_ul).Failure() ||
+        rip.WriteToFile(writer).Failure()) {
+        throw std::runtime_error("Cannot write footer partition");
+    }
+
+    writer.Close();
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_TRACKFILEBUILDER_H
+#define COM_SANDFLOW_TRACKFILEBUILDER_H
+
+#include <string>
+#include <list>
+#include <vector>
+#include <stdint.h>
+#include <AS_02.h>
+#include "FrameIndex.h"
+
+/* writes a complete track file from finalized header metadata and essence elements copied from other files, with the
+   header metadata, then the complete index table, then the essence, then the footer, so that readers can locate any
+   frame after reading the start of the file. KLV fill can be inserted so that essence element values are aligned. */
+
+class TrackFileBuilder {
+
+public:
+
+    typedef ASDCP::MXF::IndexTableSegment::IndexEntry IndexEntry;
+
+    /* the header metadata is written as is, except for its durations, which are set to the number of frames added, and
+       header_size is the size of the header partition, which must be large enough to hold it */
+
+    TrackFileBuilder(ASDCP::MXF::OP1aHeader& header, const ASDCP::Rational& edit_rate, uint32_t header_size);
+
+    /* appends the essence KLV packet at klv_offset of fd, whose key and length occupy kl_size bytes, and its index
+       entry, whose stream offset is ignored */
+
+    void addFrame(int fd, uint64_t klv_offset, uint32_t kl_size, uint64_t value_size, const IndexEntry& entry = IndexEntry());
+
+    /* appends a codestream located at offset of fd, e.g. a J2C file, for which an essence element key and length are
+       generated */
+
+    void addCodestream(int fd, uint64_t offset, uint64_t size, const IndexEntry& entry = IndexEntry());
+
+    /* appends frames start_frame to end_frame (exclusive) of another track file */
+
+    void addFrames(const FrameIndex& index, uint32_t start_frame, uint32_t end_frame);
+
+    uint32_t size() const;
+
+    /* file offset of each essence element value is a multiple of alignment (1 by default) */
+
+    void setValueAlignment(uint32_t alignment);
+
+    void write(const std::string& path);
+
+protected:
+
+    struct Frame {
+        int fd;
+        uint64_t klv_offset;        /* offset of the value if has_kl is false */
+        bool has_kl;                /* the key and length are read from fd rather than generated */
+        uint32_t kl_size;
+        uint64_t value_size;
+        IndexEntry entry;
+        uint64_t fill_size;         /* size of the KLV fill packet that precedes the essence element in the output */
+    };
+
+    ASDCP::MXF::OP1aHeader& header_;
+    ASDCP::Rational edit_rate_;
+    uint32_t header_size_;
+    uint32_t value_alignment_;
+    std::vector<Frame> frames_;
+
+    void _initPartition(ASDCP::MXF::Partition& partition) const;
+    void _setDurations();
+    uint64_t _layoutEssence(uint64_t essence_offset);
+    void _serializeIndex(std::vector<uint8_t>& index_data) const;
+};
+
+#endif
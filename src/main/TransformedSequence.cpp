@@ -0,0 +1,101 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TransformedSequence.h"
+#include <stdexcept>
+#include <string>
+
+TransformedSequence::TransformedSequence(std::unique_ptr<CodestreamSequence> seq, unsigned int thread_count, const Transform& transform) :
+    seq_(std::move(seq)),
+    thread_count_(thread_count == 0 ? 1 : thread_count),
+    transform_(transform),
+    good_(true),
+    frame_(0)
+{
+    this->next();
+}
+
+void TransformedSequence::_schedule() {
+
+    while (this->pending_.size() < this->thread_count_ && this->seq_->good()) {
+
+        /* the codestream is copied since the sequence reuses its buffer */
+
+        this->seq_->fill(this->input_fb_);
+
+        std::shared_ptr<std::vector<uint8_t>> input = std::make_shared<std::vector<uint8_t>>(this->input_fb_.RoData(), this->input_fb_.RoData() + this->input_fb_.Size());
+
+        this->seq_->next();
+
+        Transform transform = this->transform_;
+
+        this->pending_.push_back(std::async(std::launch::async, [input, transform]() {
+            return transform(input->data(), input->size());
+        }));
+    }
+}
+
+void TransformedSequence::next() {
+
+    this->_schedule();
+
+    if (this->pending_.empty()) {
+        this->good_ = false;
+        return;
+    }
+
+    try {
+
+        this->codestream_ = this->pending_.front().get();
+
+    } catch (const std::exception& e) {
+
+        throw std::runtime_error("Frame " + std::to_string(this->frame_) + ": " + e.what());
+    }
+
+    this->pending_.pop_front();
+
+    this->frame_++;
+
+    this->_schedule();
+}
+
+bool TransformedSequence::good() const {
+    return this->good_;
+}
+
+void TransformedSequence::fill(ASDCP::JP2K::FrameBuffer& fb) {
+
+    ASDCP::Result_t result = fb.SetData(this->codestream_.data(), (uint32_t) this->codestream_.size());
+
+    if (ASDCP_FAILURE(result)) {
+        throw std::runtime_error("Frame buffer allocation failed");
+    }
+
+    if (fb.Size((uint32_t) this->codestream_.size()) != this->codestream_.size()) {
+        throw std::runtime_error("Frame buffer resizing failed");
+    }
+}
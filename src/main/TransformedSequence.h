@@ -0,0 +1,70 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COM_SANDFLOW_TRANSFORMEDSEQUENCE_H
+#define COM_SANDFLOW_TRANSFORMEDSEQUENCE_H
+
+#include <functional>
+#include <memory>
+#include <deque>
+#include <future>
+#include <vector>
+#include "CodestreamSequence.h"
+
+/* applies a transformation to the codestreams of another sequence, transforming up to thread_count codestreams in
+   parallel ahead of the current one */
+
+class TransformedSequence : public CodestreamSequence {
+
+public:
+
+    typedef std::function<std::vector<uint8_t>(const uint8_t* codestream, size_t size)> Transform;
+
+    TransformedSequence(std::unique_ptr<CodestreamSequence> seq, unsigned int thread_count, const Transform& transform);
+
+    /* throws std::runtime_error if a codestream cannot be transformed */
+
+    virtual void next();
+
+    virtual bool good() const;
+
+    virtual void fill(ASDCP::JP2K::FrameBuffer& fb);
+
+protected:
+
+    std::unique_ptr<CodestreamSequence> seq_;
+    unsigned int thread_count_;
+    Transform transform_;
+    bool good_;
+    uint32_t frame_;
+    std::vector<uint8_t> codestream_;
+    ASDCP::JP2K::FrameBuffer input_fb_;
+    std::deque<std::future<std::vector<uint8_t>>> pending_;
+
+    void _schedule();
+};
+
+#endif
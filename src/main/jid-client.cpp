@@ -0,0 +1,177 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdexcept>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include "JobProtocol.h"
+
+static void usage() {
+    std::cout << "Usage: jid-client [options] <tool> [tool arguments...]" << std::endl
+        << "       jid-client [--socket <path>] --status" << std::endl
+        << "       jid-client [--socket <path>] --cancel <job id>" << std::endl << std::endl
+        << "Runs jid-writer (wrap), jid-reader (unwrap) or jid-info (probe) in jidd, using the standard input, output" << std::endl
+        << "and error, and the working directory, of the client" << std::endl << std::endl
+        << "  --socket <path>         Path of the socket of the daemon" << std::endl
+        << "  --priority <n>          Priority of the job, higher first (default 0)" << std::endl
+        << "  --memory-budget <bytes> Maximum address space of the job (default set by the daemon)" << std::endl
+        << "  --status                Lists queued and running jobs" << std::endl
+        << "  --cancel <job id>       Cancels a job" << std::endl;
+}
+
+int main(int argc, const char* argv[]) {
+
+    try {
+
+        std::string socket_path = default_socket_path();
+        std::string priority = "0";
+        std::string memory_budget = "0";
+        std::vector<std::string> fields;
+
+        /* client options precede the tool, whose arguments are passed verbatim */
+
+        int i = 1;
+
+        for (; i < argc && argv[i][0] == '-'; i++) {
+
+            const std::string opt = argv[i];
+
+            if (opt == "--help") {
+                usage();
+                return 1;
+            } else if (opt == "--status") {
+                fields = { "status" };
+                continue;
+            }
+
+            if (i + 1 >= argc) {
+                throw std::runtime_error("Missing value for " + opt);
+            }
+
+            const std::string value = argv[++i];
+
+            if (opt == "--socket") {
+                socket_path = value;
+            } else if (opt == "--priority") {
+                priority = std::to_string(std::stoi(value));
+            } else if (opt == "--memory-budget") {
+                memory_budget = std::to_string(std::stoull(value));
+            } else if (opt == "--cancel") {
+                fields = { "cancel", std::to_string(std::stoull(value)) };
+            } else {
+                throw std::runtime_error("Unknown option " + opt);
+            }
+        }
+
+        std::vector<int> fds;
+
+        if (fields.empty()) {
+
+            if (i >= argc) {
+                usage();
+                return 1;
+            }
+
+            char cwd[PATH_MAX];
+
+            if (!getcwd(cwd, sizeof cwd)) {
+                throw std::runtime_error("Cannot determine the working directory");
+            }
+
+            fields = { "run", priority, memory_budget, cwd };
+
+            fields.insert(fields.end(), argv + i, argv + argc);
+
+            fds = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+
+        } else if (i < argc) {
+
+            throw std::runtime_error("Unexpected argument " + std::string(argv[i]));
+        }
+
+        signal(SIGPIPE, SIG_IGN);
+
+        int fd = connect_socket(socket_path);
+
+        send_request(fd, fields, fds);
+
+        /* status and cancel replies are printed, job progress goes to the standard error so that it does not mix with
+           the output of the tool */
+
+        std::string line;
+
+        int result = 1;
+
+        while (read_line(fd, line)) {
+
+            if (line.compare(0, 6, "error ") == 0) {
+
+                std::cerr << line.substr(6) << std::endl;
+
+            } else if (fields[0] != "run") {
+
+                if (line != "end") std::cout << line << std::endl;
+
+                result = 0;
+
+            } else if (line.compare(0, 9, "finished ") == 0) {
+
+                std::cerr << line << std::endl;
+
+                const std::string::size_type pos = line.find(' ', 9) + 1;
+
+                if (line.compare(pos, 5, "exit=") == 0) {
+                    result = std::atoi(line.c_str() + pos + 5);
+                } else if (line.compare(pos, 7, "signal=") == 0) {
+                    result = 128 + std::atoi(line.c_str() + pos + 7);
+                }
+
+            } else if (line.compare(0, 7, "queued ") == 0) {
+
+                std::cerr << line << std::endl;
+            }
+        }
+
+        close(fd);
+
+        return result;
+
+    } catch (std::logic_error e) {
+
+        std::cout << e.what() << std::endl;
+        return 1;
+
+    } catch (std::runtime_error e) {
+
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+}
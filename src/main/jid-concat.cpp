@@ -0,0 +1,174 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AS_02.h>
+#include <Metadata.h>
+#include <boost/program_options.hpp>
+#include <stdexcept>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include "FrameIndex.h"
+#include "TrackFileBuilder.h"
+#include "DescriptorInfo.h"
+
+/* descriptor fields that legitimately differ between the track files of successive reels */
+
+static const std::set<std::string> DURATION_FIELDS = { "ContainerDuration" };
+
+int main(int argc, const char* argv[]) {
+
+    /* initialize command line options */
+
+    boost::program_options::options_description cli_opts{ "Concatenates IMF Image Track Files with identical essence descriptors, copying their essence as is" };
+
+    cli_opts.add_options()
+        ("help", "Prints usage")
+        ("kag", boost::program_options::value<uint32_t>(), "Insert KLV fill so that each codestream starts at a multiple of this number of bytes in the file, e.g. 4096")
+        ("out", boost::program_options::value<std::string>()->required(), "Output MXF file path")
+        ("in", boost::program_options::value<std::vector<std::string>>()->required()->multitoken(), "Input MXF file paths, in order");
+
+    boost::program_options::positional_options_description positional_opts;
+
+    positional_opts.add("in", -1);
+
+    boost::program_options::variables_map cli_args;
+
+    try {
+
+        boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(cli_opts).positional(positional_opts).run(), cli_args);
+
+        boost::program_options::notify(cli_args);
+
+        /* display help options */
+
+        if (cli_args.count("help")) {
+            std::cout << cli_opts << "\n";
+            return 1;
+        }
+
+        const std::vector<std::string>& in_paths = cli_args["in"].as<std::vector<std::string>>();
+
+        /* all input files remain open until their essence is copied */
+
+        std::vector<std::unique_ptr<AS_02::JP2K::MXFReader>> readers;
+
+        std::vector<std::unique_ptr<FrameIndex>> indexes;
+
+        uint64_t frame_count = 0;
+
+        for (const std::string& path : in_paths) {
+
+            readers.emplace_back(new AS_02::JP2K::MXFReader());
+
+            if (readers.back()->OpenRead(path).Failure()) {
+                throw std::runtime_error("Cannot open input file: " + path);
+            }
+
+            indexes.emplace_back(new FrameIndex(*readers.back(), path));
+
+            frame_count += indexes.back()->size();
+        }
+
+        if (frame_count > UINT32_MAX) {
+            throw std::runtime_error("Too many frames");
+        }
+
+        /* the essence descriptors of all files must match that of the first file, which provides the header metadata */
+
+        ASDCP::MXF::OP1aHeader& header = readers.front()->OP1aHeader();
+
+        DescriptorInfo ref_desc(header);
+
+        bool is_compatible = true;
+
+        for (size_t i = 1; i < readers.size(); i++) {
+
+            std::vector<std::string> differences = DescriptorInfo::compare(ref_desc, DescriptorInfo(readers[i]->OP1aHeader()), DURATION_FIELDS);
+
+            for (const std::string& difference : differences) {
+                std::cout << in_paths[i] << ": " << difference << std::endl;
+            }
+
+            is_compatible = is_compatible && differences.empty();
+        }
+
+        if (!is_compatible) {
+            throw std::runtime_error("Essence descriptors differ");
+        }
+
+        ASDCP::Rational edit_rate;
+
+        if (!ASDCP::MXF::GetEditRateFromFP(header, edit_rate)) {
+            throw std::runtime_error("Cannot read edit rate from input file");
+        }
+
+        /* the header partition of the first file is large enough since only durations change */
+
+        TrackFileBuilder builder(header, edit_rate, (uint32_t) (header.HeaderByteCount + header.ArchiveSize()));
+
+        if (cli_args.count("kag")) {
+            builder.setValueAlignment(cli_args["kag"].as<uint32_t>());
+        }
+
+        for (size_t i = 0; i < indexes.size(); i++) {
+
+            /* encrypted essence cannot be copied, since each file has its own cryptographic context */
+
+            const FrameIndex& index = *indexes[i];
+
+            for (uint32_t frame = 0; frame < index.size(); frame++) {
+
+                FrameIndex::Entry entry = index.lookup(frame);
+
+                if (entry.is_encrypted) {
+                    throw std::runtime_error("Concatenation requires plaintext essence: " + in_paths[i]);
+                }
+
+                builder.addFrame(index.fd(), entry.klv_offset, (uint32_t) (entry.essence_offset - entry.klv_offset), entry.essence_length, index.indexEntry(frame));
+            }
+        }
+
+        builder.write(cli_args["out"].as<std::string>());
+
+        for (std::unique_ptr<AS_02::JP2K::MXFReader>& reader : readers) {
+            reader->Close();
+        }
+
+    } catch (boost::program_options::required_option e) {
+
+        std::cout << cli_opts << std::endl;
+        return 1;
+
+    } catch (std::runtime_error e) {
+
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AS_02.h>
+#include <Metadata.h>
+#include <boost/program_options.hpp>
+#include <stdexcept>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "FrameIndex.h"
+#include "FrameComparator.h"
+#include "DescriptorInfo.h"
+
+/* exit codes, following diff(1) */
+
+const int EXIT_IDENTICAL = 0;
+const int EXIT_DIFFERENT = 1;
+const int EXIT_TROUBLE = 2;
+
+int main(int argc, const char* argv[]) {
+
+    ASDCP::Result_t result = ASDCP::RESULT_OK;
+
+    /* initialize command line options */
+
+    boost::program_options::options_description cli_opts{ "Lists the differences between the essence descriptors and frames of two IMF Image Track Files\n"
+        "Exits with 0 if the files are identical, 1 if they differ and 2 on error" };
+
+    cli_opts.add_options()
+        ("help", "Prints usage")
+        ("threads", boost::program_options::value<unsigned int>()->default_value(4), "Number of threads comparing frames")
+        ("ref", boost::program_options::value<std::string>()->required(), "Reference MXF file path")
+        ("in", boost::program_options::value<std::string>()->required(), "MXF file path compared to the reference");
+
+    boost::program_options::variables_map cli_args;
+
+    try {
+
+        boost::program_options::store(boost::program_options::parse_command_line(argc, argv, cli_opts), cli_args);
+
+        boost::program_options::notify(cli_args);
+
+        /* display help options */
+
+        if (cli_args.count("help")) {
+            std::cout << cli_opts << "\n";
+            return EXIT_TROUBLE;
+        }
+
+        /* open input files */
+
+        AS_02::JP2K::MXFReader ref_reader;
+
+        result = ref_reader.OpenRead(cli_args["ref"].as<std::string>());
+
+        if (result.Failure()) {
+            throw std::runtime_error("Cannot open reference file");
+        }
+
+        AS_02::JP2K::MXFReader reader;
+
+        result = reader.OpenRead(cli_args["in"].as<std::string>());
+
+        if (result.Failure()) {
+            throw std::runtime_error("Cannot open input file");
+        }
+
+        /* compare essence descriptors */
+
+        std::vector<std::string> differences = DescriptorInfo::compare(DescriptorInfo(ref_reader.OP1aHeader()), DescriptorInfo(reader.OP1aHeader()));
+
+        for (const std::string& difference : differences) {
+            std::cout << "Descriptor " << difference << std::endl;
+        }
+
+        /* compare the frames common to both files */
+
+        FrameIndex ref_index(ref_reader, cli_args["ref"].as<std::string>());
+
+        FrameIndex index(reader, cli_args["in"].as<std::string>());
+
+        uint32_t frame_count = std::min(ref_index.size(), index.size());
+
+        FrameComparator comparator(ref_index, index, cli_args["threads"].as<unsigned int>());
+
+        std::vector<bool> is_changed = comparator.compare(frame_count);
+
+        /* frames present in only one of the files are changed */
+
+        is_changed.resize(std::max(ref_index.size(), index.size()), true);
+
+        /* list ranges of consecutive changed frames */
+
+        uint32_t changed_count = 0;
+
+        for (uint32_t i = 0; i < is_changed.size();) {
+
+            if (!is_changed[i]) {
+                i++;
+                continue;
+            }
+
+            uint32_t range_start = i;
+
+            while (i < is_changed.size() && is_changed[i]) i++;
+
+            if (i - range_start == 1) {
+                std::cout << "Frame " << range_start << std::endl;
+            } else {
+                std::cout << "Frames " << range_start << "-" << (i - 1) << std::endl;
+            }
+
+            changed_count += i - range_start;
+        }
+
+        if (ref_index.size() != index.size()) {
+            std::cout << "Durations differ: " << ref_index.size() << " != " << index.size() << std::endl;
+        }
+
+        std::cout << changed_count << " of " << is_changed.size() << " frames changed" << std::endl;
+
+        ref_reader.Close();
+
+        reader.Close();
+
+        return (changed_count == 0 && differences.empty()) ? EXIT_IDENTICAL : EXIT_DIFFERENT;
+
+    } catch (boost::program_options::required_option e) {
+
+        std::cout << cli_opts << std::endl;
+        return EXIT_TROUBLE;
+
+    } catch (std::runtime_error e) {
+
+        std::cout << e.what() << std::endl;
+        return EXIT_TROUBLE;
+    }
+}
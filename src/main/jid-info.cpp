@@ -0,0 +1,306 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AS_02.h>
+#include <Metadata.h>
+#include <boost/program_options.hpp>
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <cstdio>
+#include "FrameIndex.h"
+#include "DescriptorInfo.h"
+#include "Timecode.h"
+
+/* JSON string literal */
+
+static std::string json_string(const std::string& s) {
+
+    std::string out = "\"";
+
+    for (char c : s) {
+
+        switch (c) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if ((unsigned char) c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof buf, "\\u%04x", c);
+                out += buf;
+            } else {
+                out += c;
+            }
+        }
+    }
+
+    return out + "\"";
+}
+
+/* descriptor values that are integers are output as JSON numbers, unless they have leading zeros, which JSON numbers
+   cannot have */
+
+static std::string json_value(const std::string& s) {
+
+    size_t start = (!s.empty() && s[0] == '-') ? 1 : 0;
+
+    if (s.size() > start && s.size() < 16 && s.find_first_not_of("0123456789", start) == std::string::npos &&
+        (s[start] != '0' || s.size() == start + 1)) {
+        return s;
+    }
+
+    return json_string(s);
+}
+
+/* probes a track file using only the header metadata, the index table and the random index pack, and also the key and
+   length of each essence element if is_exact */
+
+static std::string probe(const std::string& path, bool is_exact) {
+
+    std::ostringstream json;
+
+    json << "{\"path\": " << json_string(path);
+
+    AS_02::JP2K::MXFReader reader;
+
+    if (reader.OpenRead(path).Failure()) {
+        throw std::runtime_error("Cannot open file");
+    }
+
+    ASDCP::Rational edit_rate;
+
+    if (!ASDCP::MXF::GetEditRateFromFP(reader.OP1aHeader(), edit_rate)) {
+        throw std::runtime_error("Cannot read edit rate");
+    }
+
+    json << ", \"editRate\": \"" << edit_rate.Numerator << "/" << edit_rate.Denominator << "\"";
+
+    FrameIndex index(reader, path);
+
+    json << ", \"duration\": " << index.size();
+
+    json << ", \"startTimecode\": " << json_string(Timecode::fromHeader(reader.OP1aHeader()).toString(0));
+
+    /* essence descriptor and sub-descriptors */
+
+    DescriptorInfo desc(reader.OP1aHeader());
+
+    json << ", \"descriptor\": {";
+
+    std::string set;
+
+    for (const DescriptorInfo::Field& field : desc.fields()) {
+
+        if (field.set != set) {
+            json << (set.empty() ? "" : "}, ") << json_string(field.set) << ": {";
+            set = field.set;
+        } else {
+            json << ", ";
+        }
+
+        json << json_string(field.name) << ": " << json_value(field.value);
+    }
+
+    json << (set.empty() ? "}" : "}}");
+
+    /* frame sizes are the distances between consecutive index entries, bounded by the partitions listed in the
+       random index pack, less the key and length of the essence element, which are read for the first frame only,
+       unless the lengths of all essence elements are read */
+
+    if (index.size() > 0) {
+
+        std::vector<uint64_t> partition_offsets;
+
+        for (const ASDCP::MXF::RIP::PartitionPair& pair : reader.RIP().PairArray) {
+            partition_offsets.push_back(pair.ByteOffset);
+        }
+
+        std::sort(partition_offsets.begin(), partition_offsets.end());
+
+        FrameIndex::Entry first = index.lookup(0);
+
+        uint64_t kl_size = first.essence_offset - first.klv_offset;
+
+        uint64_t min_size = UINT64_MAX, max_size = 0, total_size = 0;
+
+        for (uint32_t i = 0; i < index.size(); i++) {
+
+            uint64_t size;
+
+            if (is_exact) {
+
+                size = index.lookup(i).essence_length;
+
+            } else {
+
+                uint64_t offset = index.klvOffset(i);
+
+                uint64_t next_offset = i + 1 < index.size() ? index.klvOffset(i + 1) : index.fileSize();
+
+                std::vector<uint64_t>::const_iterator partition = std::upper_bound(partition_offsets.begin(), partition_offsets.end(), offset);
+
+                if (partition != partition_offsets.end() && *partition < next_offset) {
+                    next_offset = *partition;
+                }
+
+                size = next_offset > offset + kl_size ? next_offset - offset - kl_size : 0;
+            }
+
+            min_size = std::min(min_size, size);
+            max_size = std::max(max_size, size);
+            total_size += size;
+        }
+
+        json << ", \"frameSize\": {\"min\": " << min_size << ", \"max\": " << max_size
+            << ", \"mean\": " << total_size / index.size() << ", \"total\": " << total_size << "}";
+    }
+
+    json << "}";
+
+    reader.Close();
+
+    return json.str();
+}
+
+#ifdef JID_MULTICALL
+int jid_info_main(int argc, const char* argv[]) {
+#else
+int main(int argc, const char* argv[]) {
+#endif
+
+    /* initialize command line options */
+
+    boost::program_options::options_description cli_opts{ "Prints the essence descriptor, duration and frame size statistics of IMF Image Track Files as JSON" };
+
+    cli_opts.add_options()
+        ("help", "Prints usage")
+        ("threads", boost::program_options::value<unsigned int>()->default_value(8), "Number of files probed concurrently")
+        ("exact-frame-sizes", "Reads the length of every essence element instead of deriving frame sizes from the index table, which counts any KLV fill between essence elements")
+        ("in", boost::program_options::value<std::vector<std::string>>()->required()->multitoken(), "Input MXF file paths");
+
+    boost::program_options::positional_options_description positional_opts;
+
+    positional_opts.add("in", -1);
+
+    boost::program_options::variables_map cli_args;
+
+    try {
+
+        boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(cli_opts).positional(positional_opts).run(), cli_args);
+
+        boost::program_options::notify(cli_args);
+
+        /* display help options */
+
+        if (cli_args.count("help")) {
+            std::cout << cli_opts << "\n";
+            return 1;
+        }
+
+        const std::vector<std::string>& paths = cli_args["in"].as<std::vector<std::string>>();
+
+        const bool is_exact = cli_args.count("exact-frame-sizes") > 0;
+
+        /* probe files concurrently, each thread taking the next file */
+
+        std::vector<std::string> results(paths.size());
+
+        std::atomic<size_t> next_file(0);
+
+        std::atomic<bool> has_errors(false);
+
+        auto worker = [&]() {
+
+            size_t i;
+
+            while ((i = next_file++) < paths.size()) {
+
+                try {
+
+                    results[i] = probe(paths[i], is_exact);
+
+                } catch (const std::exception& e) {
+
+                    results[i] = "{\"path\": " + json_string(paths[i]) + ", \"error\": " + json_string(e.what()) + "}";
+
+                    has_errors = true;
+                }
+            }
+        };
+
+        unsigned int thread_count = std::max(1u, std::min(cli_args["threads"].as<unsigned int>(), (unsigned int) paths.size()));
+
+        std::vector<std::thread> threads;
+
+        for (unsigned int i = 1; i < thread_count; i++) {
+            threads.push_back(std::thread(worker));
+        }
+
+        worker();
+
+        for (std::thread& t : threads) {
+            t.join();
+        }
+
+        /* results are output in the order of the input files */
+
+        std::cout << "[" << std::endl;
+
+        for (size_t i = 0; i < results.size(); i++) {
+            std::cout << "  " << results[i] << (i + 1 < results.size() ? "," : "") << std::endl;
+        }
+
+        std::cout << "]" << std::endl;
+
+        return has_errors ? 1 : 0;
+
+    } catch (boost::program_options::required_option e) {
+
+        std::cout << cli_opts << std::endl;
+        return 1;
+
+    } catch (std::runtime_error e) {
+
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,407 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <KM_fileio.h>
+#include <AS_02.h>
+#include <Metadata.h>
+#include <boost/program_options.hpp>
+#include <stdexcept>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include "CodestreamSequence.h"
+#include "FrameIndex.h"
+#include "TrackFileBuilder.h"
+#include "J2KCodestream.h"
+#include "Timecode.h"
+#include "FileIO.h"
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+/* enumeration of supported patch formats */
+
+enum class InputFormats {
+    J2C,
+    MJC
+};
+
+std::istream& operator>>(std::istream& is, InputFormats& f) {
+
+    std::string s;
+
+    is >> s;
+
+    if (s == "J2C") {
+        f = InputFormats::J2C;
+    } else if (s == "MJC") {
+        f = InputFormats::MJC;
+    } else {
+        throw std::runtime_error("Unknown input file format");
+    }
+
+    return is;
+}
+
+
+std::ostream& operator<<(std::ostream& os, const InputFormats& f) {
+
+    switch (f) {
+    case InputFormats::J2C:
+        os << "J2C";
+        break;
+    case InputFormats::MJC:
+        os << "MJC";
+        break;
+    }
+
+    return os;
+}
+
+/* checks that a main header marker segment is either absent from both codestreams or present in both with the same
+   contents */
+
+static void check_segment(const J2KCodestream& ref, const J2KCodestream& cs, uint16_t marker, const std::string& name) {
+
+    const J2KCodestream::MarkerSegment* ref_seg = ref.findMainHeaderSegment(marker);
+    const J2KCodestream::MarkerSegment* seg = cs.findMainHeaderSegment(marker);
+
+    if (!ref_seg && !seg) return;
+
+    if (!ref_seg || !seg || ref_seg->length != seg->length ||
+        memcmp(ref.data() + ref_seg->offset, cs.data() + seg->offset, seg->length) != 0) {
+        throw std::runtime_error("Codestream " + name + " differs from that of the track file");
+    }
+}
+
+/* checks that a codestream has the image and tile geometry, components, capabilities and coding parameters from which
+   the essence descriptor of the track file was derived */
+
+static void check_main_header(const J2KCodestream& ref, const J2KCodestream& cs) {
+
+    if (cs.rsiz() != ref.rsiz()) {
+        throw std::runtime_error("Codestream capabilities (Rsiz) differ from those of the track file");
+    }
+
+    if (cs.xsiz() != ref.xsiz() || cs.ysiz() != ref.ysiz() || cs.xosiz() != ref.xosiz() || cs.yosiz() != ref.yosiz()) {
+        throw std::runtime_error("Codestream image size differs from that of the track file");
+    }
+
+    if (cs.xtsiz() != ref.xtsiz() || cs.ytsiz() != ref.ytsiz() || cs.xtosiz() != ref.xtosiz() || cs.ytosiz() != ref.ytosiz()) {
+        throw std::runtime_error("Codestream tile size differs from that of the track file");
+    }
+
+    if (cs.components().size() != ref.components().size()) {
+        throw std::runtime_error("Codestream component count differs from that of the track file");
+    }
+
+    for (size_t i = 0; i < ref.components().size(); i++) {
+
+        const J2KCodestream::Component& c = cs.components()[i];
+        const J2KCodestream::Component& ref_c = ref.components()[i];
+
+        if (c.ssiz != ref_c.ssiz || c.xrsiz != ref_c.xrsiz || c.yrsiz != ref_c.yrsiz) {
+            throw std::runtime_error("Codestream component depth or subsampling differs from that of the track file");
+        }
+    }
+
+    /* the descriptor holds the default coding style and quantization, and the extended capabilities */
+
+    check_segment(ref, cs, J2KMarker::CAP, "extended capabilities (CAP)");
+    check_segment(ref, cs, J2KMarker::COD, "coding style (COD)");
+    check_segment(ref, cs, J2KMarker::QCD, "quantization (QCD)");
+}
+
+int main(int argc, const char* argv[]) {
+
+    ASDCP::Result_t result = ASDCP::RESULT_OK;
+
+    /* initialize command line options */
+
+    boost::program_options::options_description cli_opts{ "Replaces a range of frames of an IMF Image Track File, copying all other frames as is" };
+
+    cli_opts.add_options()
+        ("help", "Prints usage")
+        ("format", boost::program_options::value<InputFormats>()->default_value(InputFormats::J2C), "Replacement codestream format\n"
+            "  MJC: \t16-byte header followed by a sequence of J2C codestreams, each preceded by a 4-byte little-endian length\n"
+            "  J2C: \tsingle JPEG 2000 codestream, or a directory of codestreams sorted by file name")
+        ("start", boost::program_options::value<std::string>()->required(), "First frame replaced, as a frame index or a timecode HH:MM:SS:FF")
+        ("patch", boost::program_options::value<std::string>()->required(), "Replacement codestreams path")
+        ("in", boost::program_options::value<std::string>()->required(), "Input MXF file path")
+        ("out", boost::program_options::value<std::string>()->required(), "Output MXF file path");
+
+    boost::program_options::variables_map cli_args;
+
+    try {
+
+        boost::program_options::store(boost::program_options::parse_command_line(argc, argv, cli_opts), cli_args);
+
+        boost::program_options::notify(cli_args);
+
+        /* display help options */
+
+        if (cli_args.count("help")) {
+            std::cout << cli_opts << "\n";
+            return 1;
+        }
+
+        /* open input file */
+
+        AS_02::JP2K::MXFReader reader;
+
+        result = reader.OpenRead(cli_args["in"].as<std::string>());
+
+        if (result.Failure()) {
+            throw std::runtime_error("Cannot open input file");
+        }
+
+        FrameIndex index(reader, cli_args["in"].as<std::string>());
+
+        if (index.size() == 0) {
+            throw std::runtime_error("Input file is empty");
+        }
+
+        uint64_t start_frame = Timecode::fromHeader(reader.OP1aHeader()).parsePosition(cli_args["start"].as<std::string>());
+
+        if (start_frame >= index.size()) {
+            throw std::runtime_error("First frame replaced is outside of the file");
+        }
+
+        /* frames are copied as is, which encrypted essence cannot be, since its cryptographic context would not match
+           that of the replacement codestreams */
+
+        for (uint32_t frame = 0; frame < index.size(); frame++) {
+            if (index.lookup(frame).is_encrypted) {
+                throw std::runtime_error("Patching requires plaintext essence");
+            }
+        }
+
+        /* the essence descriptor was derived from the first codestream of the file, of which only the main header is
+           read, since it is usually much smaller than the codestream */
+
+        FrameIndex::Entry ref_entry = index.lookup(0);
+
+        std::vector<uint8_t> ref_header((size_t) std::min<uint64_t>(ref_entry.essence_length, 65536));
+
+        std::unique_ptr<J2KCodestream> ref;
+
+        while (!ref) {
+
+            read_fd_at(index.fd(), ref_header.data(), ref_header.size(), ref_entry.essence_offset);
+
+            try {
+
+                ref.reset(new J2KCodestream(J2KCodestream::fromMainHeader(ref_header.data(), ref_header.size())));
+
+            } catch (const std::runtime_error&) {
+
+                if (ref_header.size() == ref_entry.essence_length) throw;
+
+                ref_header.resize((size_t) std::min<uint64_t>(ref_entry.essence_length, 4 * (uint64_t) ref_header.size()));
+            }
+        }
+
+        /* setup the replacement codestream sequence */
+
+        std::unique_ptr<FILE, int (*)(FILE*)> f_in(NULL, fclose);
+
+        std::unique_ptr<CodestreamSequence> seq;
+
+        const std::string& patch_path = cli_args["patch"].as<std::string>();
+
+        switch (cli_args["format"].as<InputFormats>()) {
+
+        case InputFormats::J2C:
+
+        {
+            std::vector<std::string> file_list;
+
+            if (Kumu::PathIsFile(patch_path)) {
+
+                file_list.push_back(patch_path);
+
+            } else {
+
+                char next_file[Kumu::MaxFilePath];
+                Kumu::DirScanner scanner;
+
+                if (scanner.Open(patch_path).Failure()) {
+                    throw std::runtime_error("Cannot open directory");
+                }
+
+                while (scanner.GetNext(next_file).Success()) {
+
+                    /* skip hidden and special files */
+
+                    if (next_file[0] == '.') continue;
+
+                    std::string file_path = patch_path + "/" + next_file;
+
+                    /* skip directories*/
+
+                    if (Kumu::PathIsDirectory(file_path)) continue;
+
+                    file_list.push_back(file_path);
+                }
+
+            }
+
+            std::sort(file_list.begin(), file_list.end());
+
+            seq.reset(new J2CFile(file_list));
+        }
+
+        break;
+
+        case InputFormats::MJC:
+
+            f_in.reset(fopen(patch_path.c_str(), "rb"));
+
+            if (!f_in) {
+                throw std::runtime_error("Cannot open replacement codestreams");
+            }
+
+            seq.reset(new MJCFile(f_in.get()));
+
+            break;
+
+        }
+
+        /* validated codestreams are spooled to a temporary file so that memory use does not depend on their number */
+
+        const std::string spool_path = make_temp_file();
+
+#ifdef WIN32
+        int spool_fd = _open(spool_path.c_str(), _O_RDWR | _O_BINARY);
+#else
+        int spool_fd = open(spool_path.c_str(), O_RDWR);
+#endif
+
+        if (spool_fd < 0) {
+            remove(spool_path.c_str());
+            throw std::runtime_error("Cannot open temporary file");
+        }
+
+        try {
+
+            std::vector<std::pair<uint64_t, uint64_t>> codestreams;
+
+            uint64_t spool_size = 0;
+
+            ASDCP::JP2K::FrameBuffer fb;
+
+            for (; seq->good(); seq->next()) {
+
+                seq->fill(fb);
+
+                try {
+
+                    check_main_header(*ref, J2KCodestream(fb.RoData(), fb.Size()));
+
+                } catch (const std::runtime_error& e) {
+
+                    throw std::runtime_error("Replacement codestream " + std::to_string(codestreams.size()) + ": " + e.what());
+
+                }
+
+                write_fd(spool_fd, fb.RoData(), fb.Size());
+
+                codestreams.push_back(std::make_pair(spool_size, (uint64_t) fb.Size()));
+
+                spool_size += fb.Size();
+            }
+
+            if (codestreams.empty()) {
+                throw std::runtime_error("No replacement codestreams");
+            }
+
+            if (start_frame + codestreams.size() > index.size()) {
+                throw std::runtime_error("Replaced frames extend beyond the end of the file");
+            }
+
+            ASDCP::Rational edit_rate;
+
+            if (!ASDCP::MXF::GetEditRateFromFP(reader.OP1aHeader(), edit_rate)) {
+                throw std::runtime_error("Cannot read edit rate from input file");
+            }
+
+            /* unchanged frames are copied as raw byte ranges and only the index table is regenerated */
+
+            TrackFileBuilder builder(reader.OP1aHeader(), edit_rate,
+                (uint32_t) (reader.OP1aHeader().HeaderByteCount + reader.OP1aHeader().ArchiveSize()));
+
+            builder.addFrames(index, 0, (uint32_t) start_frame);
+
+            for (size_t i = 0; i < codestreams.size(); i++) {
+                builder.addCodestream(spool_fd, codestreams[i].first, codestreams[i].second, index.indexEntry((uint32_t) (start_frame + i)));
+            }
+
+            builder.addFrames(index, (uint32_t) (start_frame + codestreams.size()), index.size());
+
+            builder.write(cli_args["out"].as<std::string>());
+
+        } catch (...) {
+
+#ifdef WIN32
+            _close(spool_fd);
+#else
+            close(spool_fd);
+#endif
+            remove(spool_path.c_str());
+
+            throw;
+        }
+
+#ifdef WIN32
+        _close(spool_fd);
+#else
+        close(spool_fd);
+#endif
+        remove(spool_path.c_str());
+
+        reader.Close();
+
+    } catch (boost::program_options::required_option e) {
+
+        std::cout << cli_opts << std::endl;
+        return 1;
+
+    } catch (std::runtime_error e) {
+
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -35,14 +35,29 @@
 #include <iostream>
 #include <string>
 #include <map>
-#include <iomanip>
-#include <fstream>
+#include <list>
+#include <algorithm>
+#include <memory>
+#include "Timecode.h"
+#include "FrameIndex.h"
+#include "CodestreamSink.h"
+#include "KLVStream.h"
+#include "FrameVerifier.h"
+#include "IndexExport.h"
+#include "DirectReader.h"
+#include "MXFStreamReader.h"
+#include "TrackFileBuilder.h"
+#include "FrameTransformer.h"
+#include "J2KTranscode.h"
+#include "CodestreamDescriptor.h"
+#include "FileIO.h"
 
 #ifdef WIN32
 #include <io.h>
 #include <fcntl.h>
 #else
-#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 
@@ -52,7 +67,8 @@
 
 enum class OutputFormats {
     J2C,
-    MJC
+    MJC,
+    MXF
 };
 
 std::istream& operator>>(std::istream& is, OutputFormats& f) {
@@ -65,6 +81,8 @@ std::istream& operator>>(std::istream& is, OutputFormats& f) {
         f = OutputFormats::J2C;
     } else if (s == "MJC") {
         f = OutputFormats::MJC;
+    } else if (s == "MXF") {
+        f = OutputFormats::MXF;
     } else {
         throw std::runtime_error("Unknown input file format");
     }
@@ -82,12 +100,125 @@ std::ostream& operator<<(std::ostream& os, const OutputFormats& f) {
     case OutputFormats::MJC:
         os << "MJC";
         break;
+    case OutputFormats::MXF:
+        os << "MXF";
+        break;
+    }
+
+    return os;
+}
+
+/* fsync policy */
+
+std::istream& operator>>(std::istream& is, FsyncPolicy& p) {
+
+    std::string s;
+
+    is >> s;
+
+    if (s == "none") {
+        p = FsyncPolicy::NONE;
+    } else if (s == "deferred") {
+        p = FsyncPolicy::DEFERRED;
+    } else if (s == "file") {
+        p = FsyncPolicy::FILE;
+    } else {
+        throw std::runtime_error("Unknown fsync policy");
+    }
+
+    return is;
+}
+
+
+std::ostream& operator<<(std::ostream& os, const FsyncPolicy& p) {
+
+    switch (p) {
+    case FsyncPolicy::NONE:
+        os << "none";
+        break;
+    case FsyncPolicy::DEFERRED:
+        os << "deferred";
+        break;
+    case FsyncPolicy::FILE:
+        os << "file";
+        break;
     }
 
     return os;
 }
 
+/* creates the sink for the output format, using the header metadata of the input to fill the MJC header */
+
+static CodestreamSink* create_sink(const boost::program_options::variables_map& cli_args, ASDCP::MXF::OP1aHeader& header) {
+
+    if (cli_args["format"].as<OutputFormats>() == OutputFormats::MJC) {
+
+        /* determine MJC header fields */
+
+        ASDCP::MXF::InterchangeObject* obj = 0;
+
+        ASDCP::Result_t result = header.GetMDObjectByType(
+            header.m_Dict->Type(ASDCP::MDD_RGBAEssenceDescriptor).ul,
+            &obj
+        );
+
+        uint32_t flags = result.Success() ? 2 /* KDU_SIMPLE_VIDEO_RGB */ : 1 /* KDU_SIMPLE_VIDEO_YCC */;
+
+        ASDCP::Rational edit_rate;
+
+        if (!ASDCP::MXF::GetEditRateFromFP(header, edit_rate)) {
+
+            throw std::runtime_error("Cannot read edit rate from input file");
+
+        }
+
+        return new MJCSink(cli_args["out"].empty() ? std::string() : cli_args["out"].as<std::string>(), edit_rate, flags);
+
+    } else {
+
+        return new J2CDirectorySink(cli_args["out"].as<std::string>(), cli_args["threads"].as<unsigned int>(), cli_args["fsync"].as<FsyncPolicy>());
+
+    }
+}
+
+/* codestream transformations selected on the command line, which are applied in the order of their fields */
+
+struct TransformOptions {
+    uint8_t discard_levels;
+    uint16_t layers;
+    uint64_t max_codestream_size;
+};
+
+/* returns the transformed codestream, or an empty vector if no transformation is selected */
+
+static std::vector<uint8_t> transform_codestream(const uint8_t* data, size_t size, const TransformOptions& options) {
+
+    std::vector<uint8_t> codestream;
+
+    if (options.discard_levels > 0) {
+        codestream = discard_resolution_levels(J2KCodestream(data, size), options.discard_levels);
+        data = codestream.data();
+        size = codestream.size();
+    }
+
+    if (options.layers > 0) {
+        codestream = truncate_layers(J2KCodestream(data, size), options.layers);
+        data = codestream.data();
+        size = codestream.size();
+    }
+
+    if (options.max_codestream_size > 0) {
+        codestream = truncate_to_size(J2KCodestream(data, size), options.max_codestream_size);
+    }
+
+    return codestream;
+}
+
+#ifdef JID_MULTICALL
+int jid_reader_main(int argc, const char* argv[]) {
+#else
 int main(int argc, const char* argv[]) {
+#endif
 
     ASDCP::Result_t result = ASDCP::RESULT_OK;
 
@@ -99,10 +230,30 @@ int main(int argc, const char* argv[]) {
         ("help", "Prints usage")
         ("format", boost::program_options::value<OutputFormats>()->default_value(OutputFormats::J2C), "Output format\n"
             "  MJC: \t16-byte header followed by a sequence of J2C codestreams, each preceded by a 4-byte little-endian length\n"
-            "  J2C: \tindividual JPEG 2000 codestreams")
-        ("buffer-size", boost::program_options::value<uint32_t>()->default_value(8192*8192*3*2 /* 8K */), "Read buffer size (8K 4:4:4 16-bit if unspecified)")
+            "  J2C: \tindividual JPEG 2000 codestreams\n"
+            "  MXF: \tIMF Image Track File with the same essence descriptor, whose essence elements are copied as is")
+        ("buffer-size", boost::program_options::value<uint32_t>(), "Fixed read buffer size (sized to the largest frame read if unspecified)")
+        ("start", boost::program_options::value<std::string>(), "First frame to unwrap, as a frame index or a timecode HH:MM:SS:FF (first frame of the file if unspecified)")
+        ("end", boost::program_options::value<std::string>(), "Last frame to unwrap (inclusive), as a frame index or a timecode HH:MM:SS:FF (last frame of the file if unspecified)")
+        ("count", boost::program_options::value<uint32_t>(), "Maximum number of frames to unwrap")
+        ("step", boost::program_options::value<uint32_t>()->default_value(1), "Unwrap one frame every <step> frames")
+        ("zero-copy", boost::program_options::bool_switch()->default_value(false), "Copy plaintext codestreams directly from the input file to the output, without reading them into memory")
+        ("sequential", boost::program_options::bool_switch()->default_value(false), "Read the input file front to back with large read-ahead instead of seeking to each frame")
+        ("direct-io", boost::program_options::bool_switch()->default_value(false), "Read codestreams into block-aligned buffers bypassing the page cache, which avoids any copy for files written with --kag")
+        ("verify", boost::program_options::bool_switch()->default_value(false), "Check the structure of each codestream and its location in the file instead of unwrapping, and list bad frames")
+        ("checksums", boost::program_options::value<std::string>(), "Verify frames against the per-frame checksum file created by jid-writer (implies --verify)")
+        ("discard-levels", boost::program_options::value<unsigned int>(), "Number of highest resolution levels to discard from each codestream, which halves the image dimensions per level without decoding")
+        ("layers", boost::program_options::value<uint16_t>(), "Number of quality layers to keep in each codestream")
+        ("max-codestream-size", boost::program_options::value<uint64_t>(), "Maximum size of each codestream in bytes, which is met by keeping as many quality layers as fit")
+        ("crop", boost::program_options::value<std::vector<uint32_t>>()->multitoken(), "Rectangle (in pixels) to extract from each codestream: x_offset y_offset width height, which is enlarged to the boundaries of the tiles it intersects")
+        ("export-index", boost::program_options::value<std::string>(), "Write the byte offset and length of each frame to a sidecar file instead of unwrapping (JSON if the path ends with .json, binary otherwise)")
+        ("threads", boost::program_options::value<unsigned int>()->default_value(4), "Number of threads writing J2C files, verifying frames or transforming codestreams")
+        ("fsync", boost::program_options::value<FsyncPolicy>()->default_value(FsyncPolicy::NONE), "When J2C files are flushed to storage\n"
+            "  none: \tleft to the operating system\n"
+            "  deferred: \tonce all files are written\n"
+            "  file: \tafter each file is written")
         ("out", boost::program_options::value<std::string>(), "Output path (or stdout if none is specified)")
-        ("in", boost::program_options::value<std::string>()->required(), "Input MXF file path");
+        ("in", boost::program_options::value<std::string>()->required(), "Input MXF file path (or stdin if - is specified, in which case the file is read strictly sequentially)");
 
     boost::program_options::variables_map cli_args;
 
@@ -123,55 +274,78 @@ int main(int argc, const char* argv[]) {
 
         const OutputFormats format = cli_args["format"].as<OutputFormats>();
 
-        FILE* mjc_output = NULL;
+        const bool is_verify = cli_args["verify"].as<bool>() || cli_args.count("checksums");
 
-        switch (format) {
+        const bool is_export_index = cli_args.count("export-index") != 0;
 
-        case OutputFormats::J2C:
+        if (format == OutputFormats::J2C && !is_verify && !is_export_index &&
+            (cli_args["out"].empty() || (! Kumu::PathIsDirectory(cli_args["out"].as<std::string>())))) {
+            throw std::runtime_error("Output path must be an existing directory when J2C output format is selected.");
+        }
 
-            if (cli_args["out"].empty() || (! Kumu::PathIsDirectory(cli_args["out"].as<std::string>()) )) {
-                throw std::runtime_error("Output path must be an existing directory when J2C output format is selected.");
-            }
+        if (cli_args["in"].as<std::string>() == "-") {
 
-            break;
+            /* only the header metadata and essence elements are read from stdin, as they arrive */
 
-        case OutputFormats::MJC:
+            if (is_verify || is_export_index || format == OutputFormats::MXF || cli_args["zero-copy"].as<bool>() || cli_args["sequential"].as<bool>() || cli_args["direct-io"].as<bool>() ||
+                cli_args.count("discard-levels") || cli_args.count("layers") || cli_args.count("max-codestream-size") || cli_args.count("crop")) {
+                throw std::runtime_error("Only unwrapping is supported when reading from stdin");
+            }
 
-            if (cli_args["out"].empty()) {
+#ifdef WIN32
+            if (_setmode(_fileno(stdin), O_BINARY) == -1) {
+                throw std::runtime_error("Cannot reopen stdin");
+            }
+#endif
 
-                /* open stdout in binary mode */
+            MXFStreamReader stream(0);
 
-#ifdef WIN32
+            /* the duration is not known in advance, so frames are unwrapped until the end of the stream unless --end is specified */
 
-                int mode = _setmode(_fileno(stdout), O_BINARY);
+            Timecode tc = Timecode::fromHeader(stream.header());
 
-                if (mode == -1) {
-                    throw std::runtime_error("Cannot reopen stdout");
-                }
-#endif
+            uint64_t start_frame = cli_args.count("start") ? tc.parsePosition(cli_args["start"].as<std::string>()) : 0;
 
-                mjc_output = stdout;
+            uint64_t end_frame = cli_args.count("end") ? tc.parsePosition(cli_args["end"].as<std::string>()) + 1 : UINT64_MAX;
 
-            } else {
-            
-                /* create output file */
-            
-                mjc_output = fopen(cli_args["out"].as<std::string>().c_str(), "wb");
+            uint32_t step = cli_args["step"].as<uint32_t>();
 
-                if (!mjc_output) {
-                    throw std::runtime_error("Cannot create output file");
-                }
+            if (step == 0) {
+                throw std::runtime_error("Step must be greater than 0");
+            }
 
+            if (start_frame >= end_frame) {
+                throw std::runtime_error("Frame range is empty");
             }
 
+            if (cli_args.count("count")) {
+                end_frame = std::min(end_frame, start_frame + (uint64_t) cli_args["count"].as<uint32_t>() * step);
+            }
 
+            std::unique_ptr<CodestreamSink> sink(create_sink(cli_args, stream.header()));
 
-            break;
+            uint64_t frame = 0;
 
-        default:
+            while (frame < end_frame && stream.next()) {
 
-            throw std::runtime_error("Unknown output format");
+                if (stream.length() > UINT32_MAX) {
+                    throw std::runtime_error("Codestream is too large");
+                }
+
+                if (frame >= start_frame && (frame - start_frame) % step == 0) {
+                    sink->write((uint32_t) frame, stream.value(), (uint32_t) stream.length());
+                }
+
+                frame++;
+            }
 
+            if (cli_args.count("end") && frame < end_frame) {
+                throw std::runtime_error("Input ends before the last frame");
+            }
+
+            sink->close();
+
+            return 0;
         }
 
         /* open input file */
@@ -184,96 +358,423 @@ int main(int argc, const char* argv[]) {
             throw std::runtime_error("Cannot open input file");
         }
 
-        if (format == OutputFormats::MJC) {
+        /* Codestream frame buffer, grown to the largest frame read unless its size is specified */
+
+        ASDCP::JP2K::FrameBuffer fb;
 
-            /* output MJC header */
+        const bool is_fixed_buffer = cli_args.count("buffer-size") != 0;
 
-            ASDCP::MXF::InterchangeObject* obj = 0;
+        if (is_fixed_buffer && ASDCP_FAILURE(fb.Capacity(cli_args["buffer-size"].as<uint32_t>()))) {
+            throw std::runtime_error("Frame buffer allocation failed");
+        }
 
-            result = reader.OP1aHeader().GetMDObjectByType(
-                reader.OP1aHeader().m_Dict->Type(ASDCP::MDD_RGBAEssenceDescriptor).ul,
-                &obj
-            );
+        FrameIndex index(reader, cli_args["in"].as<std::string>());
 
-            uint32_t flags = result.Success() ? 2 /* KDU_SIMPLE_VIDEO_RGB */ : 1 /* KDU_SIMPLE_VIDEO_YCC */;
+        if (is_export_index) {
 
-            ASDCP::Rational edit_rate;
+            export_index(index, cli_args["export-index"].as<std::string>());
+
+            return 0;
+        }
+
+        const bool is_zero_copy = cli_args["zero-copy"].as<bool>();
+
+        const bool is_sequential = cli_args["sequential"].as<bool>();
+
+        const bool is_direct_io = cli_args["direct-io"].as<bool>();
+
+        if ((is_zero_copy ? 1 : 0) + (is_sequential ? 1 : 0) + (is_direct_io ? 1 : 0) > 1) {
+            throw std::runtime_error("Only one of sequential, zero-copy and direct I/O extraction can be selected");
+        }
+
+        std::unique_ptr<DirectReader> direct_reader;
+
+        if (is_direct_io) {
+            direct_reader.reset(new DirectReader(cli_args["in"].as<std::string>()));
+        }
+
+        /* determine the range of frames to unwrap */
+
+        uint32_t frame_count = reader.AS02IndexReader().GetDuration();
+
+        Timecode tc = Timecode::fromHeader(reader.OP1aHeader());
+
+        uint64_t start_frame = cli_args.count("start") ? tc.parsePosition(cli_args["start"].as<std::string>()) : 0;
+
+        uint64_t end_frame = cli_args.count("end") ? tc.parsePosition(cli_args["end"].as<std::string>()) + 1 : frame_count;
+
+        uint32_t step = cli_args["step"].as<uint32_t>();
+
+        if (step == 0) {
+            throw std::runtime_error("Step must be greater than 0");
+        }
+
+        if (start_frame >= frame_count || end_frame > frame_count || start_frame >= end_frame) {
+            throw std::runtime_error("Frame range is outside of the file");
+        }
+
+        if (cli_args.count("count")) {
+            end_frame = std::min(end_frame, start_frame + (uint64_t) cli_args["count"].as<uint32_t>() * step);
+        }
+
+        if (is_verify) {
+
+            std::unique_ptr<FrameChecksums> checksums;
+
+            if (cli_args.count("checksums")) {
+                checksums.reset(new FrameChecksums(FrameChecksums::load(cli_args["checksums"].as<std::string>())));
+            }
+
+            FrameVerifier verifier(index, cli_args["threads"].as<unsigned int>(), checksums.get());
+
+            std::map<uint32_t, std::string> bad_frames = verifier.verify(start_frame, end_frame, step);
+
+            for (const std::pair<const uint32_t, std::string>& bad_frame : bad_frames) {
+                std::cout << "Frame " << bad_frame.first << ": " << bad_frame.second << std::endl;
+            }
+
+            uint64_t verified_count = (end_frame - start_frame + step - 1) / step;
+
+            std::cout << verified_count << " frames verified, " << bad_frames.size() << " bad" << std::endl;
+
+            return bad_frames.empty() ? 0 : 1;
+        }
+
+        /* codestreams are transformed in parallel, in which case they are read by index */
+
+        std::unique_ptr<FrameTransformer> transformer;
+
+        TransformOptions transform_options = { 0, 0, 0 };
+
+        if (cli_args.count("discard-levels")) {
+
+            if (cli_args["discard-levels"].as<unsigned int>() == 0 || cli_args["discard-levels"].as<unsigned int>() > 32) {
+                throw std::runtime_error("Number of resolution levels to discard must be between 1 and 32");
+            }
+
+            transform_options.discard_levels = (uint8_t) cli_args["discard-levels"].as<unsigned int>();
+        }
+
+        if (cli_args.count("layers")) {
+
+            if (cli_args["layers"].as<uint16_t>() == 0) {
+                throw std::runtime_error("At least one quality layer must be kept");
+            }
+
+            transform_options.layers = cli_args["layers"].as<uint16_t>();
+        }
+
+        if (cli_args.count("max-codestream-size")) {
+
+            if (cli_args["max-codestream-size"].as<uint64_t>() == 0) {
+                throw std::runtime_error("Maximum codestream size must be positive");
+            }
+
+            transform_options.max_codestream_size = cli_args["max-codestream-size"].as<uint64_t>();
+        }
 
-            if (!ASDCP::MXF::GetEditRateFromFP(reader.OP1aHeader(), edit_rate)) {
+        const bool has_transforms = transform_options.discard_levels > 0 || transform_options.layers > 0 || transform_options.max_codestream_size > 0;
 
+        if (cli_args.count("crop") || has_transforms) {
+
+            if (is_zero_copy || is_sequential || is_direct_io) {
+                throw std::runtime_error("Codestreams cannot be transformed during sequential, zero-copy or direct I/O extraction");
+            }
+        }
+
+        if (cli_args.count("crop")) {
+
+            std::vector<uint32_t> crop_rectangle = cli_args["crop"].as<std::vector<uint32_t>>();
+
+            if (crop_rectangle.size() != 4) {
+                throw std::runtime_error("Crop rectangle must consist of exactly four positive integer values");
+            }
+
+            /* the image and tiling change, which the essence descriptor and coding UL of the input may not describe */
+
+            if (format == OutputFormats::MXF) {
+                throw std::runtime_error("Codestreams cannot be cropped when MXF output format is selected.");
+            }
+
+            const J2KRect crop = { crop_rectangle[0], crop_rectangle[1], crop_rectangle[2], crop_rectangle[3] };
+
+            /* only the tile-parts of the tiles within the rectangle are read if codestreams have TLM marker segments */
+
+            transformer.reset(new FrameTransformer(index, cli_args["threads"].as<unsigned int>(), [crop, transform_options](int fd, uint64_t offset, uint64_t size) {
+
+                std::vector<uint8_t> cropped = crop_tiles(fd, offset, size, crop);
+
+                std::vector<uint8_t> codestream = transform_codestream(cropped.data(), cropped.size(), transform_options);
+
+                return codestream.empty() ? cropped : codestream;
+            }));
+
+        } else if (has_transforms) {
+
+            transformer.reset(new FrameTransformer(index, cli_args["threads"].as<unsigned int>(), [transform_options](const uint8_t* data, size_t size) {
+                return transform_codestream(data, size, transform_options);
+            }));
+        }
+
+        if (format == OutputFormats::MXF) {
+
+            /* the range of frames is copied into a new track file, whose header metadata is that of the input */
+
+            if (cli_args["out"].empty()) {
+                throw std::runtime_error("Output path must be specified when MXF output format is selected.");
+            }
+
+            if (step != 1) {
+                throw std::runtime_error("Frames cannot be skipped when MXF output format is selected.");
+            }
+
+            ASDCP::MXF::OP1aHeader& header = reader.OP1aHeader();
+
+            ASDCP::Rational edit_rate;
+
+            if (!ASDCP::MXF::GetEditRateFromFP(header, edit_rate)) {
                 throw std::runtime_error("Cannot read edit rate from input file");
+            }
+
+            /* the timecode of the first frame is preserved */
+
+            std::list<ASDCP::MXF::InterchangeObject*> timecode_components;
+
+            header.GetMDObjectsByType(header.m_Dict->ul(ASDCP::MDD_TimecodeComponent), timecode_components);
 
+            for (ASDCP::MXF::InterchangeObject* obj : timecode_components) {
+                static_cast<ASDCP::MXF::TimecodeComponent*>(obj)->StartTimecode += start_frame;
             }
 
-            std::array<uint8_t, 16> header = {
-                'M',
-                'J',
-                'C',
-                '2',
-                (uint8_t) ((edit_rate.Numerator >> 24) & 0xFF),
-                (uint8_t) ((edit_rate.Numerator >> 16) & 0xFF),
-                (uint8_t) ((edit_rate.Numerator >> 8) & 0xFF),
-                (uint8_t) (edit_rate.Numerator & 0xFF),
-                (uint8_t) ((edit_rate.Denominator >> 24) & 0xFF),
-                (uint8_t) ((edit_rate.Denominator >> 16) & 0xFF),
-                (uint8_t) ((edit_rate.Denominator >> 8) & 0xFF),
-                (uint8_t) (edit_rate.Denominator & 0xFF),
-                (uint8_t) ((flags >> 24) & 0xFF),
-                (uint8_t) ((flags >> 16) & 0xFF),
-                (uint8_t) ((flags >> 8) & 0xFF),
-                (uint8_t) (flags & 0xFF),
-            };
-
-            fwrite(header.data(), sizeof(header), 1, mjc_output);
+            /* only durations change, so the header metadata fits in a header partition of the same size */
+
+            TrackFileBuilder builder(header, edit_rate, (uint32_t) (header.HeaderByteCount + header.ArchiveSize()));
+
+            if (transformer) {
+
+                /* transformed codestreams are spooled to a temporary file so that memory use does not depend on their number */
+
+                const std::string spool_path = make_temp_file();
+
+#ifdef WIN32
+                int spool_fd = _open(spool_path.c_str(), _O_RDWR | _O_BINARY);
+#else
+                int spool_fd = open(spool_path.c_str(), O_RDWR);
+#endif
+
+                if (spool_fd < 0) {
+                    remove(spool_path.c_str());
+                    throw std::runtime_error("Cannot open temporary file");
+                }
+
+                try {
+
+                    uint64_t spool_size = 0;
+
+                    transformer->run(start_frame, end_frame, 1, [&](uint32_t frame, const std::vector<uint8_t>& codestream) {
+
+                        /* the essence descriptor describes the first codestream */
+
+                        if (frame == start_frame) {
+
+                            J2KCodestream first(codestream.data(), codestream.size());
+
+                            set_codestream_descriptor(header, first);
+
+                            if (transform_options.discard_levels > 0) {
+                                scale_picture_rectangles(header, transform_options.discard_levels);
+                            }
+                        }
+
+                        write_fd(spool_fd, codestream.data(), codestream.size());
+
+                        builder.addCodestream(spool_fd, spool_size, codestream.size(), index.indexEntry(frame));
+
+                        spool_size += codestream.size();
+                    });
+
+                    builder.write(cli_args["out"].as<std::string>());
+
+                } catch (...) {
+
+#ifdef WIN32
+                    _close(spool_fd);
+#else
+                    close(spool_fd);
+#endif
+                    remove(spool_path.c_str());
+
+                    throw;
+                }
+
+#ifdef WIN32
+                _close(spool_fd);
+#else
+                close(spool_fd);
+#endif
+                remove(spool_path.c_str());
+
+                reader.Close();
 
+                return 0;
+            }
+
+            for (uint64_t frame = start_frame; frame < end_frame; frame++) {
+
+                FrameIndex::Entry entry = index.lookup((uint32_t) frame);
+
+                if (entry.is_encrypted) {
+                    throw std::runtime_error("MXF output requires plaintext essence");
+                }
+
+                builder.addFrame(index.fd(), entry.klv_offset, (uint32_t) (entry.essence_offset - entry.klv_offset), entry.essence_length, index.indexEntry((uint32_t) frame));
+            }
+
+            builder.write(cli_args["out"].as<std::string>());
+
+            reader.Close();
+
+            return 0;
         }
 
-        /* Codestream frame buffer for the MXF writer */
+        /* setup the codestream sink */
 
-        ASDCP::JP2K::FrameBuffer fb(cli_args["buffer-size"].as<uint32_t>());
+        std::unique_ptr<CodestreamSink> sink(create_sink(cli_args, reader.OP1aHeader()));
 
-        uint32_t frame_count = reader.AS02IndexReader().GetDuration();
+        if (transformer) {
 
-        for (uint32_t i = 0; i < frame_count; i++) {
+            transformer->run(start_frame, end_frame, step, [&](uint32_t frame, const std::vector<uint8_t>& codestream) {
 
-            result = reader.ReadFrame(i, fb);
+                if (codestream.size() > UINT32_MAX) {
+                    throw std::runtime_error("Codestream is too large");
+                }
 
-            if (result.Failure()) {
-                throw std::runtime_error("Cannot read frame");
+                sink->write(frame, codestream.data(), (uint32_t) codestream.size());
+            });
+
+            /* no frames are left to be read by index */
+
+            start_frame = end_frame;
+        }
+
+        if (is_sequential) {
+
+            /* walk the KLV packets from the first requested frame, checking essence elements against the index table */
+
+            KLVStream stream(index.fd(), index.klvOffset((uint32_t) start_frame));
+
+            uint64_t frame = start_frame;
+
+            while (frame < end_frame && stream.next()) {
+
+                if (index.isEncryptedKey(stream.key())) {
+                    throw std::runtime_error("Sequential extraction requires plaintext essence");
+                }
+
+                /* skip partition packs, index table segments and fill */
+
+                if (!index.isEssenceKey(stream.key())) continue;
+
+                if (stream.offset() != index.klvOffset((uint32_t) frame)) {
+                    throw std::runtime_error("Essence element does not match the index table");
+                }
+
+                if (stream.length() > UINT32_MAX) {
+                    throw std::runtime_error("Codestream is too large");
+                }
+
+                if ((frame - start_frame) % step == 0) {
+                    sink->write((uint32_t) frame, stream.value(), (uint32_t) stream.length());
+                }
+
+                frame++;
             }
 
-            if (format == OutputFormats::J2C) {
+            if (frame < end_frame) {
+                throw std::runtime_error("Input file ends before the last frame");
+            }
+
+            /* no frames are left to be read by index */
+
+            start_frame = end_frame;
+        }
+
+        /* frames are located using the index table, so that only the requested KLV packets are read */
 
-                /* write single J2C */
+        for (uint64_t frame = start_frame; frame < end_frame; frame += step) {
 
-                std::stringstream ss;
+            uint32_t i = (uint32_t) frame;
 
-                ss << cli_args["out"].as<std::string>() << "/" << std::setfill('0') << std::setw(6) << i << ".j2c";
+            if (is_zero_copy) {
 
-                std::ofstream f(ss.str(), std::ios_base::out | std::ios_base::binary);
-                   
-                if (!f.good()) {
-                    throw std::runtime_error("Cannot open output file");
+                FrameIndex::Entry entry = index.lookup(i);
+
+                if (entry.is_encrypted) {
+                    throw std::runtime_error("Zero-copy extraction requires plaintext essence");
                 }
 
-                f.write((const char*) fb.RoData(), fb.Size());
+                if (entry.essence_length > UINT32_MAX) {
+                    throw std::runtime_error("Codestream is too large");
+                }
 
-                f.close();
-            
-            } else {
+                sink->copy(i, index.fd(), entry.essence_offset, (uint32_t) entry.essence_length);
 
-                /* write single MJC frame */
+                continue;
+            }
 
-                uint32_t csz = KM_i32_BE(fb.Size());
+            if (is_direct_io) {
 
-                fwrite(&csz, 4, 1, mjc_output);
+                FrameIndex::Entry entry = index.lookup(i);
 
-                fwrite((const char*)fb.RoData(), 1, fb.Size(), mjc_output);
-                        
+                if (entry.is_encrypted) {
+                    throw std::runtime_error("Direct I/O extraction requires plaintext essence");
+                }
+
+                if (entry.essence_length > UINT32_MAX) {
+                    throw std::runtime_error("Codestream is too large");
+                }
+
+                /* the codestream is passed to the sink from the aligned read buffer */
+
+                sink->write(i, direct_reader->read(entry.essence_offset, entry.essence_length), (uint32_t) entry.essence_length);
+
+                continue;
             }
 
+            if (!is_fixed_buffer) {
+
+                /* the essence element length costs an additional small read of the key and length, through the file
+                   descriptor of the index, since the frame buffer must be large enough before the frame is read; the
+                   frame read that follows usually finds these bytes in the page cache */
+
+                uint64_t essence_length = index.lookup(i).essence_length;
+
+                if (essence_length > fb.Capacity()) {
+
+                    /* leave headroom to avoid reallocating for every slightly larger frame */
+
+                    uint64_t capacity = essence_length + essence_length / 8;
+
+                    if (capacity > UINT32_MAX || ASDCP_FAILURE(fb.Capacity((uint32_t) capacity))) {
+                        throw std::runtime_error("Frame buffer allocation failed");
+                    }
+
+                }
+
+            }
+
+            result = reader.ReadFrame(i, fb);
+
+            if (result.Failure()) {
+                throw std::runtime_error("Cannot read frame");
+            }
+
+            sink->write(i, fb.RoData(), fb.Size());
+
         }
 
+        sink->close();
+
         /* close reader */
 
         result = reader.Close();
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <KM_fileio.h>
+#include <AS_02.h>
+#include <Metadata.h>
+#include <boost/program_options.hpp>
+#include <stdexcept>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include "FrameIndex.h"
+#include "TrackFileBuilder.h"
+#include "DescriptorOptions.h"
+#include "FileIO.h"
+
+/* largest header partition considered when the header metadata no longer fits */
+
+static const uint32_t MAX_HEADER_SIZE = 64 * 1024 * 1024;
+
+/* writes the header partition to a separate file, returning false if the header metadata does not fit in header_size */
+
+static bool write_header(ASDCP::MXF::OP1aHeader& header, const std::string& path, uint32_t header_size) {
+
+    Kumu::FileWriter writer;
+
+    if (writer.OpenWrite(path).Failure()) {
+        throw std::runtime_error("Cannot open temporary file");
+    }
+
+    return header.WriteToFile(writer, header_size).Success();
+}
+
+int main(int argc, const char* argv[]) {
+
+    /* initialize command line options */
+
+    boost::program_options::options_description cli_opts{ "Changes the essence descriptor of an IMF Image Track File without rewriting its essence" };
+
+    cli_opts.add_options()
+        ("help", "Prints usage")
+        ("in", boost::program_options::value<std::string>()->required(), "Input MXF file path, modified in place unless --out is specified")
+        ("out", boost::program_options::value<std::string>(), "Output MXF file path")
+        ("color", boost::program_options::value<std::string>(), EnumeratedColorimetry::usage().c_str());
+
+    cli_opts.add(descriptor_options());
+
+    boost::program_options::variables_map cli_args;
+
+    try {
+
+        boost::program_options::store(boost::program_options::parse_command_line(argc, argv, cli_opts), cli_args);
+
+        boost::program_options::notify(cli_args);
+
+        /* display help options */
+
+        if (cli_args.count("help")) {
+            std::cout << cli_opts << "\n";
+            return 1;
+        }
+
+        const std::string in_path = cli_args["in"].as<std::string>();
+
+        const bool is_in_place = cli_args["out"].empty() || cli_args["out"].as<std::string>() == in_path;
+
+        AS_02::JP2K::MXFReader reader;
+
+        if (reader.OpenRead(in_path).Failure()) {
+            throw std::runtime_error("Cannot open input file");
+        }
+
+        ASDCP::MXF::OP1aHeader& header = reader.OP1aHeader();
+
+        /* locate the essence descriptor */
+
+        ASDCP::MXF::InterchangeObject* obj = NULL;
+
+        if (header.GetMDObjectByType(header.m_Dict->ul(ASDCP::MDD_RGBAEssenceDescriptor), &obj).Failure() &&
+            header.GetMDObjectByType(header.m_Dict->ul(ASDCP::MDD_CDCIEssenceDescriptor), &obj).Failure()) {
+            throw std::runtime_error("Cannot find the essence descriptor");
+        }
+
+        ASDCP::MXF::GenericPictureEssenceDescriptor* desc = static_cast<ASDCP::MXF::GenericPictureEssenceDescriptor*>(obj);
+
+        /* update the essence descriptor as jid-writer would have written it */
+
+        const EnumeratedColorimetry* color = EnumeratedColorimetry::fromDescriptor(*desc);
+
+        if (cli_args.count("color")) {
+
+            color = &EnumeratedColorimetry::fromString(cli_args["color"].as<std::string>());
+
+            set_colorimetry(*desc, *color);
+
+        } else if (!color) {
+
+            throw std::runtime_error("The colorimetry of the input file is unknown and must be specified");
+
+        }
+
+        apply_descriptor_options(*desc, cli_args, *color);
+
+        /* the header partition extends to the next partition, including any fill */
+
+        const uint32_t header_size = (uint32_t) (header.HeaderByteCount + header.ArchiveSize());
+
+        const std::string header_path = make_temp_file();
+
+        if (is_in_place && write_header(header, header_path, header_size)) {
+
+            /* the header metadata fits within the existing header partition, which is overwritten */
+
+            std::vector<uint8_t> header_partition(header_size);
+
+            FILE* f_header = fopen(header_path.c_str(), "rb");
+
+            size_t header_read_count = f_header ? fread(header_partition.data(), 1, header_partition.size(), f_header) : 0;
+
+            if (f_header) fclose(f_header);
+
+            remove(header_path.c_str());
+
+            if (header_read_count != header_partition.size()) {
+                throw std::runtime_error("Cannot read header partition");
+            }
+
+            reader.Close();
+
+            Kumu::FileWriter writer;
+
+            ui32_t write_count = 0;
+
+            if (writer.OpenModify(in_path).Failure() ||
+                writer.Write(header_partition.data(), (ui32_t) header_partition.size(), &write_count).Failure() ||
+                write_count != header_partition.size()) {
+                throw std::runtime_error("Cannot write header partition");
+            }
+
+            writer.Close();
+
+            return 0;
+        }
+
+        /* otherwise the header partition is enlarged and the essence is copied in large blocks to a new file */
+
+        uint32_t new_header_size = header_size;
+
+        /* the existing size was tried already if the file is modified in place */
+
+        bool is_header_written = !is_in_place && write_header(header, header_path, new_header_size);
+
+        while (!is_header_written) {
+
+            if (new_header_size >= MAX_HEADER_SIZE) {
+                remove(header_path.c_str());
+                throw std::runtime_error("Header metadata is too large");
+            }
+
+            new_header_size *= 2;
+
+            is_header_written = write_header(header, header_path, new_header_size);
+        }
+
+        remove(header_path.c_str());
+
+        ASDCP::Rational edit_rate;
+
+        if (!ASDCP::MXF::GetEditRateFromFP(header, edit_rate)) {
+            throw std::runtime_error("Cannot read edit rate from input file");
+        }
+
+        const std::string out_path = is_in_place ? in_path + ".retag" : cli_args["out"].as<std::string>();
+
+        {
+            FrameIndex index(reader, in_path);
+
+            TrackFileBuilder builder(header, edit_rate, new_header_size);
+
+            builder.addFrames(index, 0, index.size());
+
+            builder.write(out_path);
+        }
+
+        reader.Close();
+
+        if (is_in_place) {
+
+            if (!replace_file(out_path, in_path)) {
+                throw std::runtime_error("Cannot replace input file");
+            }
+        }
+
+    } catch (boost::program_options::required_option e) {
+
+        std::cout << cli_opts << std::endl;
+        return 1;
+
+    } catch (std::runtime_error e) {
+
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -37,13 +37,27 @@
 #include <algorithm>
 #include <map>
 #include "CodestreamSequence.h"
+#include "TransformedSequence.h"
+#include "SegmentedSequence.h"
+#include "SharedMemorySequence.h"
+#include "J2KTranscode.h"
 #include "J2KProfileULMap.h"
+#include "FrameChecksums.h"
+#include "FrameIndex.h"
+#include "IndexExport.h"
+#include "TrackFileBuilder.h"
+#include "MXFStreamWriter.h"
+#include "FileIO.h"
+#include "DescriptorOptions.h"
+#include <cstdio>
 
 #ifdef WIN32
 #include <io.h>
 #include <fcntl.h>
 #else
 #include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
  /* authoring identification info written to file headers */
@@ -62,25 +76,6 @@ public:
 };
 
 
-/* hard-coded UL definitions */
-
-std::array<uint8_t, 16> CodingEquations_ITU601 = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x01, 0x04, 0x01, 0x01, 0x01, 0x02, 0x01, 0x00, 0x00 };
-std::array<uint8_t, 16> CodingEquations_ITU709 = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x01, 0x04, 0x01, 0x01, 0x01, 0x02, 0x02, 0x00, 0x00 };
-std::array<uint8_t, 16> CodingEquations_ITU2020_NCL = { 0x06, 0x0e, 0x2b, 0x34, 04, 0x01, 0x01, 0x0d, 0x04, 0x01, 0x01, 0x01, 0x02, 0x06, 0x00, 0x00 };
-
-std::array<uint8_t, 16> TransferCharacteristic_ITU709 = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x01, 0x04, 0x01, 0x01, 0x01, 0x01, 0x02, 0x00, 0x00 };
-std::array<uint8_t, 16> TransferCharacteristic_IEC6196624_xvYCC = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x0d, 0x04, 0x01, 0x01, 0x01, 0x01, 0x08, 0x00, 0x00 };
-std::array<uint8_t, 16> TransferCharacteristic_ITU2020 = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x0e, 0x04, 0x01, 0x01, 0x01, 0x01, 0x09, 0x00, 0x00 };
-std::array<uint8_t, 16> TransferCharacteristic_SMPTEST2084 = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x0d, 0x04, 0x01, 0x01, 0x01, 0x01, 0x0a, 0x00, 0x00 };
-std::array<uint8_t, 16> TransferCharacteristic_CinemaMezzanine_DCDM = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x0d, 0x04, 0x01, 0x01, 0x01, 0x01, 0x13, 0x00, 0x00 };
-
-std::array<uint8_t, 16> ColorPrimaries_SMPTE170M = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x06, 0x04, 0x01, 0x01, 0x01, 0x03, 0x01, 0x00, 0x00 };
-std::array<uint8_t, 16> ColorPrimaries_ITU470_PAL = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x06, 0x04, 0x01, 0x01, 0x01, 0x03, 0x02, 0x00, 0x00 };
-std::array<uint8_t, 16> ColorPrimaries_ITU709 = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x06, 0x04, 0x01, 0x01, 0x01, 0x03, 0x03, 0x00, 0x00 };
-std::array<uint8_t, 16> ColorPrimaries_ITU2020 = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x0d, 0x04, 0x01, 0x01, 0x01, 0x03, 0x04, 0x00, 0x00 };
-std::array<uint8_t, 16> ColorPrimaries_P3D65 = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x0d, 0x04, 0x01, 0x01, 0x01, 0x03, 0x06, 0x00, 0x00 };
-std::array<uint8_t, 16> ColorPrimaries_CinemaMezzanine = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x0d, 0x04, 0x01, 0x01, 0x01, 0x03, 0x08, 0x00, 0x00 };
-
 std::array<uint8_t, 16> HTJ2KPictureCodingSchemeGeneric = { 0x06, 0x0e, 0x2b, 0x34, 0x04, 0x01, 0x01, 0x0D, 0x04, 0x01, 0x02, 0x02, 0x03, 0x01, 0x08, 0x01 };
 
 namespace ASDCP {
@@ -295,100 +290,16 @@ std::ostream& operator<<(std::ostream& os, const ImageComponents& f) {
     return os;
 }
 
-/* enumeration of supported colorimetry */
-
-class EnumeratedColorimetry {
-public:
-
-    /* defined colorimetry values */
-
-    static const EnumeratedColorimetry COLOR_1;
-    static const EnumeratedColorimetry COLOR_2;
-    static const EnumeratedColorimetry COLOR_3;
-    static const EnumeratedColorimetry COLOR_4;
-    static const EnumeratedColorimetry COLOR_5;
-    static const EnumeratedColorimetry COLOR_6;
-    static const EnumeratedColorimetry COLOR_7;
-    static const EnumeratedColorimetry COLOR_APP4_2;
+/* header partition size and body partition duration (in frames) of written files */
 
-    static const EnumeratedColorimetry& fromString(const std::string s) {
-
-        auto i = EnumeratedColorimetry::colors_.find(s);
-
-        if (i == EnumeratedColorimetry::colors_.cend()) {
-            throw std::runtime_error("Unknown colorimetry");
-        }
-
-        return *(i->second);
-    }
-
-    static std::string usage() {
-        std::stringstream ss;
-
-        ss << "Colorspace:" << std::endl;
-
-        for (auto pair : EnumeratedColorimetry::colors_) {
-            ss << pair.first << std::endl;
-        }
-
-        return ss.str();
-    }
-
-    const std::string& symbol() const {
-        return this->symbol_;
-    }
-
-    const std::array<uint8_t, 16>& transfer_characteristic() const {
-        return this->transfer_characteristic_;
-    }
-
-    const std::array<uint8_t, 16>& color_primaries() const {
-        return this->color_primaries_;
-    }
-
-    const std::array<uint8_t, 16>& coding_equations() const {
-        return this->coding_equations_;
-    }
-
-private:
-
-    EnumeratedColorimetry(const std::string& symbol,
-        const std::array<uint8_t, 16>& transfer_characteristic,
-        const std::array<uint8_t, 16>& color_primaries,
-        const std::array<uint8_t, 16>& coding_equations) :
-        symbol_(symbol),
-        transfer_characteristic_(transfer_characteristic),
-        color_primaries_(color_primaries),
-        coding_equations_(coding_equations) {
-        if (!this->colors_.insert(std::make_pair(this->symbol_, this)).second) {
-            throw std::runtime_error("Existing colorimetry");
-        }
-    }
-
-    static std::map<std::string, EnumeratedColorimetry*> colors_;
-
-    std::string symbol_;
-
-    std::array<uint8_t, 16> transfer_characteristic_;
-    std::array<uint8_t, 16> color_primaries_;
-    std::array<uint8_t, 16> coding_equations_;
-};
-
-bool operator==(const EnumeratedColorimetry& lhs, const EnumeratedColorimetry& rhs) { return &lhs == &rhs; }
-
-bool operator!=(const EnumeratedColorimetry& lhs, const EnumeratedColorimetry& rhs) { return !(lhs == rhs); }
-
-std::map<std::string, EnumeratedColorimetry*> EnumeratedColorimetry::colors_;
-const EnumeratedColorimetry EnumeratedColorimetry::COLOR_1("COLOR.1", TransferCharacteristic_ITU709, ColorPrimaries_ITU470_PAL, CodingEquations_ITU601);
-const EnumeratedColorimetry EnumeratedColorimetry::COLOR_2("COLOR.2", TransferCharacteristic_ITU709, ColorPrimaries_SMPTE170M, CodingEquations_ITU601);
-const EnumeratedColorimetry EnumeratedColorimetry::COLOR_3("COLOR.3", TransferCharacteristic_ITU709, ColorPrimaries_ITU709, CodingEquations_ITU709);
-const EnumeratedColorimetry EnumeratedColorimetry::COLOR_4("COLOR.4", TransferCharacteristic_IEC6196624_xvYCC, ColorPrimaries_SMPTE170M, CodingEquations_ITU601);
-const EnumeratedColorimetry EnumeratedColorimetry::COLOR_5("COLOR.5", TransferCharacteristic_ITU2020, ColorPrimaries_ITU2020, CodingEquations_ITU2020_NCL);
-const EnumeratedColorimetry EnumeratedColorimetry::COLOR_6("COLOR.6", TransferCharacteristic_SMPTEST2084, ColorPrimaries_P3D65, CodingEquations_ITU2020_NCL /* not used */);
-const EnumeratedColorimetry EnumeratedColorimetry::COLOR_7("COLOR.7", TransferCharacteristic_SMPTEST2084, ColorPrimaries_ITU2020, CodingEquations_ITU2020_NCL);
-const EnumeratedColorimetry EnumeratedColorimetry::COLOR_APP4_2("COLOR.APP4.2", TransferCharacteristic_CinemaMezzanine_DCDM, ColorPrimaries_CinemaMezzanine, CodingEquations_ITU2020_NCL /* not used */);
+static const uint32_t HEADER_SIZE = 16384;
+static const uint32_t PARTITION_DURATION = 60;
 
+#ifdef JID_MULTICALL
+int jid_writer_main(int argc, const char* argv[]) {
+#else
 int main(int argc, const char* argv[]) {
+#endif
 
     ASDCP::Result_t result = ASDCP::RESULT_OK;
 
@@ -404,18 +315,25 @@ int main(int argc, const char* argv[]) {
             "  MJC: \t16-byte header followed by a sequence of J2C codestreams, each preceded by a 4-byte little-endian length\n"
             "  J2C: \tsingle JPEG 2000 codestream")
             ("assetid", boost::program_options::value<Kumu::UUID>(), "Asset UUID in hex notation, e.g. 8538b543169743dd9a08c6d8b4b1b7df")
-        ("out", boost::program_options::value<std::string>()->required(), "Output file path")
+        ("out", boost::program_options::value<std::string>()->required(), "Output file path (or stdout if - is specified with --stream)")
+        ("stream", boost::program_options::bool_switch()->default_value(false), "Write the file sequentially, without seeking, e.g. to a pipe: the header metadata remains open and incomplete and index tables follow each body partition")
         ("fake", boost::program_options::bool_switch()->default_value(false), "Generate fake input data")
+        ("checksums", boost::program_options::value<std::string>(), "Path of a sidecar file where the CRC-32C of each codestream is stored")
+        ("fast-start", boost::program_options::bool_switch()->default_value(false), "Rewrite the file once complete so that the header metadata and index table precede the essence")
+        ("kag", boost::program_options::value<uint32_t>(), "Insert KLV fill so that each codestream starts at a multiple of this number of bytes in the file, e.g. 4096 (implies --fast-start)")
+        ("export-index", boost::program_options::value<std::string>(), "Path of a sidecar file where the byte offset and length of each frame are stored (JSON if the path ends with .json, binary otherwise)")
+        ("layers", boost::program_options::value<uint16_t>(), "Number of quality layers to keep in each codestream")
+        ("max-codestream-size", boost::program_options::value<uint64_t>(), "Maximum size of each codestream in bytes, which is met by keeping as many quality layers as fit")
+        ("threads", boost::program_options::value<unsigned int>()->default_value(4), "Number of threads truncating codestreams")
         ("in", boost::program_options::value<std::string>(), "Input file path (or stdin if none is specified)")
+        ("segment", boost::program_options::value<std::vector<std::string>>()->composing(), "Input MJC file or pipe holding the segment of frames starting at a given frame, in the form <start frame>=<path>, e.g. 0=reel1.mjc (can be repeated instead of --in, in which case segments are read concurrently and written in frame order)")
+        ("segment-buffer-size", boost::program_options::value<size_t>()->default_value(512 * 1024 * 1024), "Maximum number of bytes of codestreams buffered across segments ahead of the segment being written")
+        ("shm-socket", boost::program_options::value<std::string>(), "Path of a Unix domain socket on which a co-located encoder connects and supplies codestreams in sealed shared memory, which are written without being copied (Linux only, replaces --in, see SharedMemorySequence.h for the protocol)")
         ("color", boost::program_options::value<std::string>()->default_value(EnumeratedColorimetry::COLOR_APP4_2.symbol()), EnumeratedColorimetry::usage().c_str())
         ("components", boost::program_options::value<ImageComponents>()->default_value(ImageComponents::XYZ), "Image components: RGB or YCbCr or XYZ")
-        ("quantization", boost::program_options::value<Quantization>()->default_value(Quantization::QE_2), "Quantization: QE.1 or QE.2")
-        ("active_area", boost::program_options::value<std::vector<ui32_t>>()->multitoken(), "Active area rectangle (in pixels): x_offset y_offset width height")
-        ("display_area", boost::program_options::value<std::vector<ui32_t>>()->multitoken(), "Display rectangle (in pixels): x_offset y_offset width height")
-        ("mastering_display_primaries", boost::program_options::value<std::vector<ui16_t>>()->multitoken(), "Mastering Display Primaries: x_0 y_0 x_1 y_1 x_2 y_2")
-        ("mastering_display_white_point_chroma", boost::program_options::value<std::vector<ui16_t>>()->multitoken(), "Mastering Display White Point Chromaticity: x y")
-        ("mastering_display_max_luminance", boost::program_options::value<ui32_t>(), "Mastering Display Maximum Luminance")
-        ("mastering_display_min_luminance", boost::program_options::value<ui32_t>(), "Mastering Display Minimum Luminance");
+        ("quantization", boost::program_options::value<Quantization>()->default_value(Quantization::QE_2), "Quantization: QE.1 or QE.2");
+
+    cli_opts.add(descriptor_options());
 
     boost::program_options::variables_map cli_args;
 
@@ -438,6 +356,12 @@ int main(int argc, const char* argv[]) {
             throw std::runtime_error("Cannot open SMPTE dictionary");
         }
 
+        const bool is_stream = cli_args["stream"].as<bool>();
+
+        if (is_stream && (cli_args["fast-start"].as<bool>() || cli_args.count("kag") || cli_args.count("export-index"))) {
+            throw std::runtime_error("Streaming output cannot be rewritten or read back");
+        }
+
         /* setup the input codestream sequence */
 
         std::unique_ptr<CodestreamSequence>  seq;
@@ -446,6 +370,45 @@ int main(int argc, const char* argv[]) {
 
             seq.reset(new FakeSequence());
 
+        } else if (cli_args.count("shm-socket")) {
+
+            if (cli_args.count("in") || cli_args.count("segment")) {
+                throw std::runtime_error("Shared memory input replaces --in and --segment");
+            }
+
+            seq.reset(new SharedMemorySequence(cli_args["shm-socket"].as<std::string>()));
+
+        } else if (cli_args.count("segment")) {
+
+            if (cli_args.count("in") || cli_args["format"].as<InputFormats>() != InputFormats::MJC) {
+                throw std::runtime_error("Segments must be MJC files and replace --in");
+            }
+
+            std::vector<SegmentedSequence::Segment> segments;
+
+            for (const std::string& arg : cli_args["segment"].as<std::vector<std::string>>()) {
+
+                size_t separator = arg.find('=');
+
+                if (separator == 0 || separator == std::string::npos || separator + 1 == arg.size() ||
+                    arg.find_first_not_of("0123456789") != separator) {
+                    throw std::runtime_error("Segment must be in the form <start frame>=<path>");
+                }
+
+                SegmentedSequence::Segment segment;
+
+                try {
+                    segment.start_frame = std::stoull(arg.substr(0, separator));
+                } catch (const std::out_of_range&) {
+                    throw std::runtime_error("Segment start frame is out of range");
+                }
+                segment.path = arg.substr(separator + 1);
+
+                segments.push_back(segment);
+            }
+
+            seq.reset(new SegmentedSequence(segments, cli_args["segment-buffer-size"].as<size_t>()));
+
         } else {
 
             FILE* f_in = NULL;
@@ -557,6 +520,40 @@ int main(int argc, const char* argv[]) {
 
         }
 
+        /* codestreams are truncated in parallel, ahead of the codestream being written */
+
+        if (cli_args.count("layers") || cli_args.count("max-codestream-size")) {
+
+            const uint16_t layers = cli_args.count("layers") ? cli_args["layers"].as<uint16_t>() : 0;
+
+            const uint64_t max_codestream_size = cli_args.count("max-codestream-size") ? cli_args["max-codestream-size"].as<uint64_t>() : 0;
+
+            if (cli_args.count("layers") && layers == 0) {
+                throw std::runtime_error("At least one quality layer must be kept");
+            }
+
+            if (cli_args.count("max-codestream-size") && max_codestream_size == 0) {
+                throw std::runtime_error("Maximum codestream size must be positive");
+            }
+
+            seq.reset(new TransformedSequence(std::move(seq), cli_args["threads"].as<unsigned int>(), [layers, max_codestream_size](const uint8_t* data, size_t size) {
+
+                std::vector<uint8_t> codestream;
+
+                if (layers > 0) {
+                    codestream = truncate_layers(J2KCodestream(data, size), layers);
+                    data = codestream.data();
+                    size = codestream.size();
+                }
+
+                if (max_codestream_size > 0) {
+                    codestream = truncate_to_size(J2KCodestream(data, size), max_codestream_size);
+                }
+
+                return codestream;
+            }));
+        }
+
         /* Codestream frame buffer for the MXF writer */
 
         ASDCP::JP2K::FrameBuffer fb;
@@ -583,10 +580,20 @@ int main(int argc, const char* argv[]) {
 
         }
 
+        /* streaming output */
+
+        std::unique_ptr<MXFStreamWriter> stream_writer;
+
+        int stream_fd = -1;
+
         /* keep count of the number of frames written to the file */
 
         uint32_t frame_count = 0;
 
+        /* per-frame checksums, computed on the codestreams as they are written */
+
+        FrameChecksums checksums;
+
         while (seq->good()) {
 
             /* setup the frame buffer using the current codestream */
@@ -660,8 +667,6 @@ int main(int argc, const char* argv[]) {
 
                     ASDCP::MXF::CDCIEssenceDescriptor* yuv_desc = new ASDCP::MXF::CDCIEssenceDescriptor(g_dict);
 
-                    yuv_desc->CodingEquations = color.coding_equations().data();
-
                     yuv_desc->HorizontalSubsampling = pdesc.ImageComponents[1].YRsize;
 
                     yuv_desc->VerticalSubsampling = 1;
@@ -778,9 +783,7 @@ int main(int argc, const char* argv[]) {
 
                 /* fill-in remaining common essence descriptor fields */
 
-                desc->TransferCharacteristic = color.transfer_characteristic().data();
-
-                desc->ColorPrimaries = color.color_primaries().data();
+                set_colorimetry(*desc, color);
 
                 desc->VideoLineMap = ASDCP::MXF::LineMapPair(0, 0);
 
@@ -788,157 +791,192 @@ int main(int argc, const char* argv[]) {
 
                 desc->DisplayF2Offset.set(0);
 
-                if (cli_args.count("display_area")) {
+                apply_descriptor_options(*desc, cli_args, color);
 
-                    std::vector<ui32_t> display_rectangle = cli_args["display_area"].as<std::vector<ui32_t>>();
+                /* we do not know the container duration */
 
-                    if (display_rectangle.size() != 4) {
-                        throw std::runtime_error("Display area must consist of exactly four positive integer values");
-                    }
+                desc->ContainerDuration.set_has_value(false);
 
-                    desc->DisplayXOffset = display_rectangle[0];
-                    desc->DisplayYOffset = display_rectangle[1];
-                    desc->DisplayWidth = display_rectangle[2];
-                    desc->DisplayHeight = display_rectangle[3];
+                ASDCP::MXF::FileDescriptor* essence_descriptor = static_cast<ASDCP::MXF::FileDescriptor*>(desc);
 
-                    if (desc->DisplayXOffset.get() + desc->DisplayWidth.get() > desc->StoredWidth ||
-                        desc->DisplayYOffset.get() + desc->DisplayHeight.get() > desc->StoredHeight) {
-                        throw std::runtime_error("Display area does not fit within the stored rectangle");
-                    }
+                if (ASDCP_FAILURE(result)) {
+                    throw std::runtime_error(result.Message());
                 }
 
-                if (cli_args.count("active_area")) {
+                /* initialize the sub-descriptor container */
 
-                    std::vector<ui32_t> active_rectangle = cli_args["active_area"].as<std::vector<ui32_t>>();
+                ASDCP::MXF::InterchangeObject_list_t essence_sub_descriptors;
 
-                    if (active_rectangle.size() != 4) {
-                        throw std::runtime_error("Active area must consist of exactly four positive integer values");
-                    }
+                essence_sub_descriptors.push_back(j2k_subdesc);
 
-                    desc->ActiveXOffset = active_rectangle[0];
-                    desc->ActiveYOffset = active_rectangle[1];
-                    desc->ActiveWidth = active_rectangle[2];
-                    desc->ActiveHeight = active_rectangle[3];
+                /* initialize the MXF file, or, when streaming, a temporary file from which the header partition is copied */
 
-                    int display_width = desc->DisplayWidth.empty() ? desc->StoredWidth : desc->DisplayWidth.get();
-                    int display_height = desc->DisplayHeight.empty() ? desc->StoredHeight : desc->DisplayHeight.get();
+                const std::string header_path = is_stream ? make_temp_file() : std::string();
 
-                    if (desc->ActiveXOffset.get() + desc->ActiveWidth.get() > display_width ||
-                        desc->ActiveYOffset.get() + desc->ActiveHeight.get() > display_height) {
-                        throw std::runtime_error("Active area does not fit within the display rectangle");
-                    }
+                result = writer.OpenWrite(
+                    is_stream ? header_path : cli_args["out"].as<std::string>(),
+                    writer_info,
+                    essence_descriptor,
+                    essence_sub_descriptors,
+                    cli_args["fps"].as<ASDCP::Rational>(),
+                    HEADER_SIZE,
+                    AS_02::IndexStrategy_t::IS_FOLLOW,
+                    PARTITION_DURATION);
+
+                if (ASDCP_FAILURE(result)) {
+                    throw std::runtime_error(result.Message());
                 }
-                
-                /* Mastering Display Color Volume Metadata */
-      
-                if (cli_args.count("mastering_display_primaries") ||
-                    cli_args.count("mastering_display_white_point_chroma") ||
-                    cli_args.count("mastering_display_max_luminance") ||
-                    cli_args.count("mastering_display_min_luminance")) {
-
-                    if (cli_args.count("mastering_display_primaries") != 1 ||
-                        cli_args.count("mastering_display_white_point_chroma") != 1 ||
-                        cli_args.count("mastering_display_max_luminance") != 1 ||
-                        cli_args.count("mastering_display_min_luminance") != 1
-                        ) {
-                    
-                        throw std::runtime_error("All Mastering Display Color Volume Metadata items must be defined");
 
-                    }
+                if (is_stream) {
 
-                    if (! (color == EnumeratedColorimetry::COLOR_3 ||
-                            color == EnumeratedColorimetry::COLOR_5 ||
-                        color == EnumeratedColorimetry::COLOR_6 ||
-                        color == EnumeratedColorimetry::COLOR_7)
-                        ) {
+                    std::vector<uint8_t> header_partition(HEADER_SIZE);
 
-                        throw std::runtime_error("Mastering Display Color Volume Metadata can only be used with COLOR.3, COLOR.5, COLOR.6 or COLOR.7");
+                    FILE* f_header = fopen(header_path.c_str(), "rb");
 
-                    }
+                    size_t header_read_count = f_header ? fread(header_partition.data(), 1, header_partition.size(), f_header) : 0;
+
+                    if (f_header) fclose(f_header);
 
-                    std::vector<ui16_t> mastering_display_primaries = cli_args["mastering_display_primaries"].as<std::vector<ui16_t>>();
+                    remove(header_path.c_str());
 
-                    if (mastering_display_primaries.size() != 6) {
-                        throw std::runtime_error("Mastering display primaries must consist of exactly 6 positive integer values");
+                    if (header_read_count != header_partition.size()) {
+                        throw std::runtime_error("Cannot read header partition");
                     }
 
-                    ASDCP::MXF::ColorPrimary p1(mastering_display_primaries[0], mastering_display_primaries[1]);
-                    ASDCP::MXF::ColorPrimary p2(mastering_display_primaries[2], mastering_display_primaries[3]);
-                    ASDCP::MXF::ColorPrimary p3(mastering_display_primaries[4], mastering_display_primaries[5]);
+                    if (cli_args["out"].as<std::string>() == "-") {
 
-                    desc->MasteringDisplayPrimaries = ASDCP::MXF::ThreeColorPrimaries(p1, p2, p3);
+#ifdef WIN32
+                        if (_setmode(_fileno(stdout), O_BINARY) == -1) {
+                            throw std::runtime_error("Cannot reopen stdout");
+                        }
+#endif
 
-                    std::vector<ui16_t> mastering_display_white_point_chroma = cli_args["mastering_display_white_point_chroma"].as<std::vector<ui16_t>>();
+                        stream_fd = 1;
 
-                    if (mastering_display_white_point_chroma.size() != 2) {
-                        throw std::runtime_error("Mastering Display White Point Chromaticity must consist of exactly 2 positive integer values");
-                    }
+                    } else {
 
-                    desc->MasteringDisplayWhitePointChromaticity = ASDCP::MXF::ColorPrimary(mastering_display_white_point_chroma[0], mastering_display_white_point_chroma[1]);
+#ifdef WIN32
+                        stream_fd = _open(cli_args["out"].as<std::string>().c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+                        stream_fd = open(cli_args["out"].as<std::string>().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
 
-                    if (mastering_display_white_point_chroma.size() != 2) {
-                        throw std::runtime_error("Mastering Display White Point Chromaticity must consist of exactly 2 positive integer values");
+                        if (stream_fd < 0) {
+                            throw std::runtime_error("Cannot open output file");
+                        }
                     }
 
-                    desc->MasteringDisplayMinimumLuminance = cli_args["mastering_display_min_luminance"].as<ui32_t>();
-                    desc->MasteringDisplayMaximumLuminance = cli_args["mastering_display_max_luminance"].as<ui32_t>();
-
+                    stream_writer.reset(new MXFStreamWriter(stream_fd, header_partition, writer.OP1aHeader(),
+                        cli_args["fps"].as<ASDCP::Rational>(), PARTITION_DURATION));
                 }
 
-                /* we do not know the container duration */
+            }
 
-                desc->ContainerDuration.set_has_value(false);
+            /* write the codestream into a new frame */
 
-                ASDCP::MXF::FileDescriptor* essence_descriptor = static_cast<ASDCP::MXF::FileDescriptor*>(desc);
+            if (cli_args.count("checksums")) {
+                checksums.append(crc32c(fb.RoData(), fb.Size()));
+            }
+
+            if (stream_writer) {
+
+                stream_writer->writeFrame(fb.RoData(), fb.Size());
+
+            } else {
+
+                result = writer.WriteFrame(fb, NULL, NULL);
 
                 if (ASDCP_FAILURE(result)) {
                     throw std::runtime_error(result.Message());
                 }
+            }
 
-                /* initialize the sub-descriptor container */
+            /* move to the next codestream */
 
-                ASDCP::MXF::InterchangeObject_list_t essence_sub_descriptors;
+            seq->next();
 
-                essence_sub_descriptors.push_back(j2k_subdesc);
+            frame_count++;
 
-                /* initialize the MXF file */
+        }
 
-                result = writer.OpenWrite(
-                    cli_args["out"].as<std::string>(),
-                    writer_info,
-                    essence_descriptor,
-                    essence_sub_descriptors,
-                    cli_args["fps"].as<ASDCP::Rational>(),
-                    16384,
-                    AS_02::IndexStrategy_t::IS_FOLLOW,
-                    60);
+        if (stream_writer) {
 
-                if (ASDCP_FAILURE(result)) {
-                    throw std::runtime_error(result.Message());
-                }
+            stream_writer->finalize();
 
+            if (stream_fd != 1) {
+#ifdef WIN32
+                _close(stream_fd);
+#else
+                close(stream_fd);
+#endif
             }
 
-            /* write the codestream into a new frame */
+        } else {
 
-            result = writer.WriteFrame(fb, NULL, NULL);
+            result = writer.Finalize();
 
             if (ASDCP_FAILURE(result)) {
                 throw std::runtime_error(result.Message());
             }
+        }
 
-            /* move to the next codestream */
+        if (cli_args.count("checksums")) {
+            checksums.save(cli_args["checksums"].as<std::string>());
+        }
 
-            seq->next();
+        /* rewrite the file with the index table at the front, for readers that cannot cheaply access the end of the file */
 
-            frame_count++;
+        if (cli_args["fast-start"].as<bool>() || cli_args.count("kag")) {
+
+            const std::string& out_path = cli_args["out"].as<std::string>();
+
+            const std::string tmp_path = out_path + ".fast-start";
+
+            {
+                AS_02::JP2K::MXFReader reader;
+
+                if (reader.OpenRead(out_path).Failure()) {
+                    throw std::runtime_error("Cannot reopen output file");
+                }
+
+                FrameIndex index(reader, out_path);
+
+                /* the header partition keeps its size, so the finalized header metadata fits */
+
+                TrackFileBuilder builder(reader.OP1aHeader(), cli_args["fps"].as<ASDCP::Rational>(),
+                    (uint32_t) (reader.OP1aHeader().HeaderByteCount + reader.OP1aHeader().ArchiveSize()));
+
+                if (cli_args.count("kag")) {
+                    builder.setValueAlignment(cli_args["kag"].as<uint32_t>());
+                }
 
+                builder.addFrames(index, 0, index.size());
+
+                builder.write(tmp_path);
+
+                reader.Close();
+            }
+
+            if (!replace_file(tmp_path, out_path)) {
+                throw std::runtime_error("Cannot replace output file");
+            }
         }
 
-        result = writer.Finalize();
+        /* the frame locations are read back from the index table and essence elements of the finalized file */
+
+        if (cli_args.count("export-index")) {
+
+            AS_02::JP2K::MXFReader reader;
+
+            if (reader.OpenRead(cli_args["out"].as<std::string>()).Failure()) {
+                throw std::runtime_error("Cannot reopen output file");
+            }
+
+            FrameIndex index(reader, cli_args["out"].as<std::string>());
+
+            export_index(index, cli_args["export-index"].as<std::string>());
 
-        if (ASDCP_FAILURE(result)) {
-            throw std::runtime_error(result.Message());
+            reader.Close();
         }
 
     } catch (boost::program_options::required_option e) {
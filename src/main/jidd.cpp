@@ -0,0 +1,684 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AS_02.h>
+#include <boost/program_options.hpp>
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cstdio>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "JobProtocol.h"
+#include "ToolMains.h"
+
+/* tools that jobs run, under their own name or that of the operation they perform */
+
+static const std::map<std::string, ToolMain> TOOLS = {
+    { "jid-writer", jid_writer_main },
+    { "wrap", jid_writer_main },
+    { "jid-reader", jid_reader_main },
+    { "unwrap", jid_reader_main },
+    { "jid-info", jid_info_main },
+    { "probe", jid_info_main }
+};
+
+struct Job {
+    uint64_t id;
+    int priority;
+    uint64_t memory_budget;
+    std::string working_dir;
+    std::string tool;
+    std::vector<std::string> args;
+    std::vector<int> fds;
+    int client_fd;
+    pid_t pid;
+    bool is_cancelled;
+    std::chrono::steady_clock::time_point queued_at;
+    std::chrono::steady_clock::time_point started_at;
+};
+
+struct Connection {
+    std::vector<uint8_t> buffer;
+    std::vector<int> fds;
+    uint64_t job_id;
+};
+
+/* the SIGCHLD handler wakes up the event loop through a pipe */
+
+static int sigchld_pipe[2] = { -1, -1 };
+
+static void on_sigchld(int) {
+
+    int saved_errno = errno;
+
+    char c = 0;
+
+    if (write(sigchld_pipe[1], &c, 1) < 0) {
+        /* the pipe is full, so the event loop will wake up anyway */
+    }
+
+    errno = saved_errno;
+}
+
+static void close_fds(std::vector<int>& fds) {
+
+    for (int fd : fds) close(fd);
+
+    fds.clear();
+}
+
+static double seconds(const std::chrono::steady_clock::duration& d) {
+    return std::chrono::duration_cast<std::chrono::duration<double>>(d).count();
+}
+
+static double seconds(const struct timeval& tv) {
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* writes a reply line, ignoring clients that have gone away. The daemon does not wait for clients that do not read
+   their replies: their connection is shut down instead, so that they do not receive further lines. */
+
+static void reply(int fd, const std::string& line) {
+
+    if (fd < 0) return;
+
+    const std::string data = line + "\n";
+
+    for (size_t pos = 0; pos < data.size(); ) {
+
+        ssize_t sz = send(fd, data.data() + pos, data.size() - pos, MSG_DONTWAIT);
+
+        if (sz < 0 && errno == EINTR) continue;
+
+        if (sz <= 0) {
+            shutdown(fd, SHUT_WR);
+            return;
+        }
+
+        pos += (size_t) sz;
+    }
+}
+
+class Daemon {
+
+public:
+
+    Daemon(int listen_fd, unsigned int max_jobs, uint64_t memory_budget, uint64_t default_job_memory_budget) :
+        listen_fd_(listen_fd),
+        max_jobs_(max_jobs == 0 ? 1 : max_jobs),
+        memory_budget_(memory_budget),
+        default_job_memory_budget_(default_job_memory_budget),
+        next_job_id_(1),
+        reserved_memory_(0),
+        running_count_(0)
+    {
+    }
+
+    void run() {
+
+        std::vector<struct pollfd> pfds;
+
+        while (true) {
+
+            pfds.clear();
+
+            pfds.push_back({ this->listen_fd_, POLLIN, 0 });
+            pfds.push_back({ sigchld_pipe[0], POLLIN, 0 });
+
+            for (const std::pair<const int, Connection>& c : this->connections_) {
+                pfds.push_back({ c.first, POLLIN, 0 });
+            }
+
+            if (poll(pfds.data(), pfds.size(), -1) < 0) {
+
+                if (errno == EINTR) continue;
+
+                throw std::runtime_error("Cannot poll");
+            }
+
+            if (pfds[1].revents) this->_reap();
+
+            /* connections may have been closed while handling earlier events */
+
+            for (size_t i = 2; i < pfds.size(); i++) {
+                if (pfds[i].revents && this->connections_.count(pfds[i].fd)) this->_receive(pfds[i].fd);
+            }
+
+            if (pfds[0].revents & POLLIN) this->_accept();
+
+            this->_schedule();
+        }
+    }
+
+protected:
+
+    int listen_fd_;
+    unsigned int max_jobs_;
+    uint64_t memory_budget_;
+    uint64_t default_job_memory_budget_;
+
+    uint64_t next_job_id_;
+    uint64_t reserved_memory_;
+    unsigned int running_count_;
+
+    std::map<int, Connection> connections_;
+    std::map<uint64_t, Job> jobs_;
+
+    void _accept() {
+
+        int fd = accept(this->listen_fd_, NULL, NULL);
+
+        if (fd < 0) return;
+
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+        this->connections_[fd].job_id = 0;
+    }
+
+    void _close(int fd) {
+
+        Connection& c = this->connections_[fd];
+
+        close_fds(c.fds);
+
+        /* the job of a client that disconnects is cancelled */
+
+        std::map<uint64_t, Job>::iterator job = this->jobs_.find(c.job_id);
+
+        if (job != this->jobs_.end()) {
+            job->second.client_fd = -1;
+            this->_cancel(job->second);
+        }
+
+        this->connections_.erase(fd);
+
+        close(fd);
+    }
+
+    void _receive(int fd) {
+
+        Connection& c = this->connections_[fd];
+
+        uint8_t data[4096];
+
+        size_t sz;
+
+        try {
+            sz = receive_with_fds(fd, data, sizeof data, c.fds);
+        } catch (const std::runtime_error&) {
+            sz = 0;
+        }
+
+        if (sz == 0) {
+            this->_close(fd);
+            return;
+        }
+
+        /* only the request is expected from a client whose job is queued or running */
+
+        if (c.job_id != 0) return;
+
+        c.buffer.insert(c.buffer.end(), data, data + sz);
+
+        try {
+
+            std::vector<std::string> fields;
+
+            if (!parse_request(c.buffer, fields)) {
+
+                if (c.buffer.size() > 1024 * 1024) {
+                    throw std::runtime_error("Request is too long");
+                }
+
+                return;
+            }
+
+            this->_handle(fd, c, fields);
+
+        } catch (const std::exception& e) {
+
+            reply(fd, std::string("error ") + e.what());
+
+            this->_close(fd);
+        }
+    }
+
+    void _handle(int fd, Connection& c, const std::vector<std::string>& fields) {
+
+        if (fields.size() == 1 && fields[0] == "status") {
+
+            const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+            for (const std::pair<const uint64_t, Job>& j : this->jobs_) {
+
+                const Job& job = j.second;
+
+                std::ostringstream line;
+
+                line << "job " << job.id << (job.pid > 0 ? " running" : " queued") << " priority=" << job.priority
+                    << " tool=" << job.tool << " elapsed=" << std::fixed << std::setprecision(3)
+                    << seconds(now - (job.pid > 0 ? job.started_at : job.queued_at));
+
+                reply(fd, line.str());
+            }
+
+            reply(fd, "end");
+
+            this->_close(fd);
+
+        } else if (fields.size() == 2 && fields[0] == "cancel") {
+
+            std::map<uint64_t, Job>::iterator job = this->jobs_.find(std::stoull(fields[1]));
+
+            if (job == this->jobs_.end()) {
+                throw std::runtime_error("Unknown job");
+            }
+
+            reply(fd, "cancelled " + fields[1]);
+
+            this->_close(fd);
+
+            this->_cancel(job->second);
+
+        } else if (fields.size() >= 5 && fields[0] == "run") {
+
+            if (TOOLS.find(fields[4]) == TOOLS.end()) {
+                throw std::runtime_error("Unknown tool " + fields[4]);
+            }
+
+            if (c.fds.size() != 3) {
+                throw std::runtime_error("Standard input, output and error are required");
+            }
+
+            Job job;
+
+            job.id = this->next_job_id_++;
+            job.priority = std::stoi(fields[1]);
+            job.memory_budget = std::stoull(fields[2]);
+            job.working_dir = fields[3];
+            job.tool = fields[4];
+            job.args.assign(fields.begin() + 5, fields.end());
+            job.fds.swap(c.fds);
+            job.client_fd = fd;
+            job.pid = 0;
+            job.is_cancelled = false;
+            job.queued_at = std::chrono::steady_clock::now();
+
+            if (job.memory_budget == 0) job.memory_budget = this->default_job_memory_budget_;
+
+            if (this->memory_budget_ > 0 && job.memory_budget > this->memory_budget_) {
+                close_fds(job.fds);
+                throw std::runtime_error("Job memory budget exceeds the memory budget of the daemon");
+            }
+
+            if (this->memory_budget_ > 0 && job.memory_budget == 0) {
+                close_fds(job.fds);
+                throw std::runtime_error("Job memory budget is required");
+            }
+
+            c.job_id = job.id;
+
+            reply(fd, "queued " + std::to_string(job.id));
+
+            this->jobs_[job.id] = job;
+
+        } else {
+
+            throw std::runtime_error("Bad request");
+        }
+    }
+
+    void _cancel(Job& job) {
+
+        job.is_cancelled = true;
+
+        if (job.pid > 0) {
+
+            /* the job is finished once its process is reaped */
+
+            kill(job.pid, SIGTERM);
+
+        } else {
+
+            this->_finish(job, "cancelled", NULL);
+        }
+    }
+
+    /* reports the outcome and metrics of a job, and forgets it */
+
+    void _finish(Job& job, const std::string& outcome, const struct rusage* usage) {
+
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+        std::ostringstream line;
+
+        line << "finished " << job.id << " " << outcome << std::fixed << std::setprecision(3);
+
+        if (usage) {
+            line << " queued=" << seconds(job.started_at - job.queued_at) << " wall=" << seconds(now - job.started_at)
+                << " user=" << seconds(usage->ru_utime) << " system=" << seconds(usage->ru_stime)
+                << " max_rss=" << usage->ru_maxrss;
+        } else {
+            line << " queued=" << seconds(now - job.queued_at) << " wall=0.000 user=0.000 system=0.000 max_rss=0";
+        }
+
+        reply(job.client_fd, line.str());
+
+        close_fds(job.fds);
+
+        int client_fd = job.client_fd;
+
+        this->jobs_.erase(job.id);
+
+        if (client_fd >= 0) {
+            this->connections_[client_fd].job_id = 0;
+            this->_close(client_fd);
+        }
+    }
+
+    void _reap() {
+
+        char c[64];
+
+        while (read(sigchld_pipe[0], c, sizeof c) > 0);
+
+        int status;
+
+        struct rusage usage;
+
+        pid_t pid;
+
+        while ((pid = wait4(-1, &status, WNOHANG, &usage)) > 0) {
+
+            for (std::pair<const uint64_t, Job>& j : this->jobs_) {
+
+                Job& job = j.second;
+
+                if (job.pid != pid) continue;
+
+                this->running_count_--;
+                this->reserved_memory_ -= job.memory_budget;
+
+                std::string outcome;
+
+                if (job.is_cancelled) {
+                    outcome = "cancelled";
+                } else if (WIFEXITED(status)) {
+                    outcome = "exit=" + std::to_string(WEXITSTATUS(status));
+                } else {
+                    outcome = "signal=" + std::to_string(WTERMSIG(status));
+                }
+
+                this->_finish(job, outcome, &usage);
+
+                break;
+            }
+        }
+    }
+
+    /* starts queued jobs by decreasing priority, then in order of submission, as long as job slots and memory are
+       available; a job that does not fit in the remaining memory holds back lower-priority jobs */
+
+    void _schedule() {
+
+        while (this->running_count_ < this->max_jobs_) {
+
+            Job* next = NULL;
+
+            for (std::pair<const uint64_t, Job>& j : this->jobs_) {
+                if (j.second.pid == 0 && (!next || j.second.priority > next->priority)) next = &j.second;
+            }
+
+            if (!next) return;
+
+            if (this->memory_budget_ > 0 && this->reserved_memory_ + next->memory_budget > this->memory_budget_) return;
+
+            this->_start(*next);
+        }
+    }
+
+    void _start(Job& job) {
+
+        std::cout.flush();
+        fflush(NULL);
+
+        pid_t pid = fork();
+
+        if (pid < 0) {
+            reply(job.client_fd, "error Cannot start job");
+            this->_finish(job, "exit=1", NULL);
+            return;
+        }
+
+        if (pid == 0) {
+
+            /* the job runs in a copy of the daemon, whose dictionary is already loaded */
+
+            signal(SIGCHLD, SIG_DFL);
+            signal(SIGPIPE, SIG_DFL);
+
+            for (int i = 0; i < 3; i++) {
+                dup2(job.fds[i], i);
+            }
+
+            close(this->listen_fd_);
+            close(sigchld_pipe[0]);
+            close(sigchld_pipe[1]);
+
+            for (const std::pair<const int, Connection>& c : this->connections_) {
+                close(c.first);
+            }
+
+            for (const std::pair<const uint64_t, Job>& j : this->jobs_) {
+                for (int fd : j.second.fds) {
+                    if (fd > 2) close(fd);
+                }
+            }
+
+            if (chdir(job.working_dir.c_str()) != 0) {
+                std::cerr << "Cannot change to directory " << job.working_dir << std::endl;
+                _exit(1);
+            }
+
+            if (job.memory_budget > 0) {
+
+                struct rlimit limit;
+
+                limit.rlim_cur = limit.rlim_max = (rlim_t) job.memory_budget;
+
+                setrlimit(RLIMIT_AS, &limit);
+            }
+
+            std::vector<const char*> argv;
+
+            argv.push_back(job.tool.c_str());
+
+            for (const std::string& arg : job.args) {
+                argv.push_back(arg.c_str());
+            }
+
+            argv.push_back(NULL);
+
+            int result = TOOLS.at(job.tool)((int) argv.size() - 1, argv.data());
+
+            std::cout.flush();
+            std::cerr.flush();
+            fflush(NULL);
+
+            _exit(result);
+        }
+
+        job.pid = pid;
+        job.started_at = std::chrono::steady_clock::now();
+
+        close_fds(job.fds);
+
+        this->running_count_++;
+        this->reserved_memory_ += job.memory_budget;
+
+        reply(job.client_fd, "started " + std::to_string(job.id));
+    }
+};
+
+int main(int argc, const char* argv[]) {
+
+    /* initialize command line options */
+
+    boost::program_options::options_description cli_opts{ "Runs jid-writer, jid-reader and jid-info jobs submitted by jid-client over a Unix domain socket" };
+
+    cli_opts.add_options()
+        ("help", "Prints usage")
+        ("socket", boost::program_options::value<std::string>()->default_value(default_socket_path()), "Path of the socket on which jobs are accepted")
+        ("jobs", boost::program_options::value<unsigned int>()->default_value(4), "Maximum number of jobs running at once")
+        ("memory-budget", boost::program_options::value<uint64_t>()->default_value(0), "Maximum total address space in bytes of the jobs running at once, or 0 if unlimited")
+        ("job-memory-budget", boost::program_options::value<uint64_t>()->default_value(0), "Address space in bytes of jobs that do not specify one, or 0 if unlimited");
+
+    boost::program_options::variables_map cli_args;
+
+    try {
+
+        boost::program_options::store(boost::program_options::parse_command_line(argc, argv, cli_opts), cli_args);
+
+        boost::program_options::notify(cli_args);
+
+        /* display help options */
+
+        if (cli_args.count("help")) {
+            std::cout << cli_opts << "\n";
+            return 1;
+        }
+
+        /* load the dictionary once, before jobs are started */
+
+        ASDCP::DefaultSMPTEDict();
+
+        const std::string path = cli_args["socket"].as<std::string>();
+
+        /* refuse to replace the socket of a running daemon */
+
+        try {
+
+            close(connect_socket(path));
+
+            throw std::logic_error("Another daemon is listening on " + path);
+
+        } catch (const std::runtime_error&) {
+        }
+
+        unlink(path.c_str());
+
+        struct sockaddr_un addr;
+
+        memset(&addr, 0, sizeof addr);
+
+        addr.sun_family = AF_UNIX;
+
+        if (path.size() >= sizeof addr.sun_path) {
+            throw std::runtime_error("Socket path is too long");
+        }
+
+        strncpy(addr.sun_path, path.c_str(), sizeof addr.sun_path - 1);
+
+        int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+        if (listen_fd < 0) {
+            throw std::runtime_error("Cannot create socket");
+        }
+
+        fcntl(listen_fd, F_SETFD, FD_CLOEXEC);
+
+        /* jobs run with the privileges of the daemon, so only its user can submit them */
+
+        mode_t mask = umask(0077);
+
+        int result = bind(listen_fd, (struct sockaddr*) &addr, sizeof addr);
+
+        umask(mask);
+
+        if (result != 0 || listen(listen_fd, 64) != 0) {
+            throw std::runtime_error("Cannot listen on " + path);
+        }
+
+        if (pipe(sigchld_pipe) != 0) {
+            throw std::runtime_error("Cannot create pipe");
+        }
+
+        for (int fd : sigchld_pipe) {
+            fcntl(fd, F_SETFL, O_NONBLOCK);
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+
+        struct sigaction action;
+
+        memset(&action, 0, sizeof action);
+
+        action.sa_handler = on_sigchld;
+        action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+
+        sigaction(SIGCHLD, &action, NULL);
+
+        signal(SIGPIPE, SIG_IGN);
+
+        Daemon daemon(listen_fd, cli_args["jobs"].as<unsigned int>(), cli_args["memory-budget"].as<uint64_t>(),
+            cli_args["job-memory-budget"].as<uint64_t>());
+
+        daemon.run();
+
+    } catch (boost::program_options::required_option e) {
+
+        std::cout << cli_opts << std::endl;
+        return 1;
+
+    } catch (std::logic_error e) {
+
+        std::cout << e.what() << std::endl;
+        return 1;
+
+    } catch (std::runtime_error e) {
+
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
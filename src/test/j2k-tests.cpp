@@ -0,0 +1,270 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* checks the packet index and the codestream transcoding functions against known outputs
+
+   usage: j2k-tests packets <codestream> <packet count>
+          j2k-tests discard-levels <codestream> <levels> <reference>
+          j2k-tests layers <codestream> <layers> <reference>
+          j2k-tests max-size <codestream> <size> <reference>
+          j2k-tests crop <codestream> <x> <y> <width> <height> <reference>
+          j2k-tests crop-file <codestream> <x> <y> <width> <height> <reference>
+
+   packets checks that the packets located by J2KPacketIndex are as many as expected, exactly cover the body of each
+   tile-part and, if the codestream has PLT marker segments, have the lengths that the encoder signalled in them. The
+   other commands check that the output is identical to a reference codestream; crop-file reads the codestream using
+   its TLM marker segments, if any. */
+
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <map>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "J2KCodestream.h"
+#include "J2KPacketIndex.h"
+#include "J2KTranscode.h"
+
+static std::vector<uint8_t> read_file(const std::string& path) {
+
+    std::ifstream f(path, std::ios::binary);
+
+    if (!f) {
+        throw std::runtime_error("Cannot read " + path);
+    }
+
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+/* packet lengths signalled by the PLT marker segments of each tile-part, in order of their index */
+
+static std::map<size_t, std::vector<size_t>> plt_lengths(const J2KCodestream& cs) {
+
+    std::map<size_t, std::vector<size_t>> lengths;
+
+    for (size_t i = 0; i < cs.tileParts().size(); i++) {
+
+        std::map<uint8_t, const J2KCodestream::MarkerSegment*> segments;
+
+        for (const J2KCodestream::MarkerSegment& seg : cs.tileParts()[i].header) {
+            if (seg.marker == J2KMarker::PLT) segments[cs.data()[seg.offset + 4]] = &seg;
+        }
+
+        for (const std::pair<const uint8_t, const J2KCodestream::MarkerSegment*>& seg : segments) {
+
+            size_t length = 0;
+
+            for (size_t pos = seg.second->offset + 5; pos < seg.second->offset + seg.second->length; pos++) {
+
+                length = (length << 7) | (cs.data()[pos] & 0x7F);
+
+                if ((cs.data()[pos] & 0x80) == 0) {
+                    lengths[i].push_back(length);
+                    length = 0;
+                }
+            }
+        }
+    }
+
+    return lengths;
+}
+
+static bool check_packets(const std::string& path, size_t expected_count) {
+
+    std::vector<uint8_t> data = read_file(path);
+
+    J2KCodestream cs(data.data(), data.size());
+
+    J2KPacketIndex index(cs);
+
+    bool is_ok = true;
+
+    if (index.packets().size() != expected_count) {
+        std::cout << "Expected " << expected_count << " packets, found " << index.packets().size() << std::endl;
+        is_ok = false;
+    }
+
+    std::map<size_t, std::vector<size_t>> signalled_lengths = plt_lengths(cs);
+
+    std::map<size_t, std::vector<size_t>> lengths;
+
+    std::map<size_t, size_t> ends;
+
+    for (const J2KPacketIndex::Packet& packet : index.packets()) {
+
+        const J2KCodestream::TilePart& tp = cs.tileParts()[packet.tile_part];
+
+        size_t start = ends.count(packet.tile_part) ? ends[packet.tile_part] : tp.offset + tp.header_length;
+
+        if (packet.offset != start) {
+            std::cout << "Packet at " << packet.offset << " does not follow the previous one, which ends at " << start << std::endl;
+            is_ok = false;
+        }
+
+        ends[packet.tile_part] = packet.offset + packet.length;
+
+        lengths[packet.tile_part].push_back(packet.length);
+    }
+
+    for (size_t i = 0; i < cs.tileParts().size(); i++) {
+
+        const J2KCodestream::TilePart& tp = cs.tileParts()[i];
+
+        size_t end = ends.count(i) ? ends[i] : tp.offset + tp.header_length;
+
+        if (end != tp.offset + tp.length) {
+            std::cout << "Packets of tile-part " << i << " end at " << end << " instead of " << tp.offset + tp.length << std::endl;
+            is_ok = false;
+        }
+
+        if (signalled_lengths.count(i) && signalled_lengths[i] != lengths[i]) {
+            std::cout << "Packet lengths of tile-part " << i << " differ from those signalled in PLT" << std::endl;
+            is_ok = false;
+        }
+    }
+
+    return is_ok;
+}
+
+static bool check_output(const std::vector<uint8_t>& output, const std::string& reference_path) {
+
+    std::vector<uint8_t> reference = read_file(reference_path);
+
+    if (output == reference) return true;
+
+    size_t i = 0;
+
+    while (i < output.size() && i < reference.size() && output[i] == reference[i]) i++;
+
+    std::cout << "Output (" << output.size() << " bytes) differs from " << reference_path << " (" << reference.size()
+        << " bytes) at offset " << i << std::endl;
+
+    return false;
+}
+
+static J2KRect rect_from_args(const char* argv[]) {
+
+    J2KRect rect;
+
+    rect.x = (uint32_t) std::stoul(argv[0]);
+    rect.y = (uint32_t) std::stoul(argv[1]);
+    rect.width = (uint32_t) std::stoul(argv[2]);
+    rect.height = (uint32_t) std::stoul(argv[3]);
+
+    return rect;
+}
+
+int main(int argc, const char* argv[]) {
+
+    try {
+
+        const std::string command = argc > 1 ? argv[1] : "";
+
+        bool is_ok;
+
+        if (command == "packets" && argc == 4) {
+
+            is_ok = check_packets(argv[2], std::stoul(argv[3]));
+
+        } else if ((command == "discard-levels" || command == "layers" || command == "max-size") && argc == 5) {
+
+            std::vector<uint8_t> data = read_file(argv[2]);
+
+            J2KCodestream cs(data.data(), data.size());
+
+            std::vector<uint8_t> output;
+
+            if (command == "discard-levels") {
+                output = discard_resolution_levels(cs, (uint8_t) std::stoul(argv[3]));
+            } else if (command == "layers") {
+                output = truncate_layers(cs, (uint16_t) std::stoul(argv[3]));
+            } else {
+                output = truncate_to_size(cs, std::stoull(argv[3]));
+            }
+
+            is_ok = check_output(output, argv[4]);
+
+        } else if (command == "crop" && argc == 8) {
+
+            std::vector<uint8_t> data = read_file(argv[2]);
+
+            is_ok = check_output(crop_tiles(J2KCodestream(data.data(), data.size()), rect_from_args(argv + 3)), argv[7]);
+
+        } else if (command == "crop-file" && argc == 8) {
+
+#ifdef WIN32
+            int fd = _open(argv[2], _O_RDONLY | _O_BINARY);
+
+            struct _stat64 st;
+
+            if (fd < 0 || _fstat64(fd, &st) != 0) {
+                throw std::runtime_error(std::string("Cannot read ") + argv[2]);
+            }
+
+            std::vector<uint8_t> output = crop_tiles(fd, 0, (uint64_t) st.st_size, rect_from_args(argv + 3));
+
+            _close(fd);
+#else
+            int fd = open(argv[2], O_RDONLY);
+
+            struct stat st;
+
+            if (fd < 0 || fstat(fd, &st) != 0) {
+                throw std::runtime_error(std::string("Cannot read ") + argv[2]);
+            }
+
+            std::vector<uint8_t> output = crop_tiles(fd, 0, (uint64_t) st.st_size, rect_from_args(argv + 3));
+
+            close(fd);
+#endif
+
+            is_ok = check_output(output, argv[7]);
+
+        } else {
+
+            std::cout << "usage: j2k-tests packets|discard-levels|layers|max-size|crop|crop-file <codestream> ..." << std::endl;
+            return 1;
+        }
+
+        return is_ok ? 0 : 1;
+
+    } catch (const std::exception& e) {
+
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,266 @@
+/*
+ * Copyright (c), Pierre-Anthony Lemieux (pal@palemieux.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* feeds codestream files to jid-writer --shm-socket through a sealed memfd ring buffer, as a co-located encoder would
+
+   usage: shm-encoder <socket path> <ring size> <codestream file>... */
+
+#include <stdexcept>
+#include <iostream>
+#include <string>
+#include <deque>
+#include <cstdio>
+#include <cstdlib>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "SharedMemorySequence.h"
+
+typedef SharedMemorySequence::Message Message;
+
+static void send_message(int fd, uint32_t type, uint64_t offset, uint64_t size, int passed_fd = -1) {
+
+    Message msg;
+
+    memset(&msg, 0, sizeof msg);
+
+    msg.type = type;
+    msg.offset = offset;
+    msg.size = size;
+
+    struct iovec iov;
+
+    iov.iov_base = &msg;
+    iov.iov_len = sizeof msg;
+
+    uint8_t control[CMSG_SPACE(sizeof(int))];
+
+    struct msghdr hdr;
+
+    memset(&hdr, 0, sizeof hdr);
+
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+
+    if (passed_fd >= 0) {
+
+        hdr.msg_control = control;
+        hdr.msg_controllen = sizeof control;
+
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
+
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+
+        memcpy(CMSG_DATA(cmsg), &passed_fd, sizeof(int));
+    }
+
+    if (sendmsg(fd, &hdr, MSG_NOSIGNAL) != (ssize_t) sizeof msg) {
+        throw std::runtime_error("Cannot send message");
+    }
+}
+
+/* returns false at the end of the connection */
+
+static bool receive_message(int fd, Message& msg) {
+
+    size_t count = 0;
+
+    while (count < sizeof msg) {
+
+        ssize_t sz = read(fd, (uint8_t*) &msg + count, sizeof msg - count);
+
+        if (sz < 0 && errno == EINTR) continue;
+
+        if (sz < 0) throw std::runtime_error("Cannot receive message");
+
+        if (sz == 0) {
+            if (count == 0) return false;
+            throw std::runtime_error("Truncated message");
+        }
+
+        count += (size_t) sz;
+    }
+
+    if (msg.type == SharedMemorySequence::ABORT) {
+        throw std::runtime_error("Writer aborted");
+    }
+
+    if (msg.type != SharedMemorySequence::FRAME_CONSUMED) {
+        throw std::runtime_error("Unexpected message");
+    }
+
+    return true;
+}
+
+struct Frame {
+    uint64_t offset;
+    uint64_t size;
+};
+
+static bool overlaps(const Frame& frame, const std::deque<Frame>& pending) {
+
+    for (const Frame& other : pending) {
+        if (frame.offset < other.offset + other.size && other.offset < frame.offset + frame.size) return true;
+    }
+
+    return false;
+}
+
+int main(int argc, const char* argv[]) {
+
+    if (argc < 4) {
+        std::cout << "usage: shm-encoder <socket path> <ring size> <codestream file>..." << std::endl;
+        return 1;
+    }
+
+    try {
+
+        const uint64_t ring_size = std::stoull(argv[2]);
+
+        int ring_fd = memfd_create("jid-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+
+        if (ring_fd < 0 || ftruncate(ring_fd, (off_t) ring_size) != 0 ||
+            fcntl(ring_fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW) != 0) {
+            throw std::runtime_error("Cannot create shared memory");
+        }
+
+        uint8_t* ring = (uint8_t*) mmap(NULL, (size_t) ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, ring_fd, 0);
+
+        if (ring == MAP_FAILED) {
+            throw std::runtime_error("Cannot map shared memory");
+        }
+
+        /* the writer creates the socket once it starts */
+
+        struct sockaddr_un addr;
+
+        memset(&addr, 0, sizeof addr);
+
+        addr.sun_family = AF_UNIX;
+
+        strncpy(addr.sun_path, argv[1], sizeof addr.sun_path - 1);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+        int attempts = 0;
+
+        while (connect(fd, (struct sockaddr*) &addr, sizeof addr) != 0) {
+
+            if (++attempts == 300) {
+                throw std::runtime_error("Cannot connect to writer");
+            }
+
+            usleep(100000);
+        }
+
+        send_message(fd, SharedMemorySequence::RING, 0, ring_size, ring_fd);
+
+        /* codestreams are placed one after the other, wrapping to the start of the ring when they do not fit, once the
+           codestreams they would overwrite are consumed */
+
+        std::deque<Frame> pending;
+
+        uint64_t head = 0;
+
+        for (int i = 3; i < argc; i++) {
+
+            struct stat st;
+
+            FILE* f = fopen(argv[i], "rb");
+
+            if (!f || fstat(fileno(f), &st) != 0 || (uint64_t) st.st_size > ring_size) {
+                throw std::runtime_error(std::string("Cannot read codestream ") + argv[i]);
+            }
+
+            Frame frame;
+
+            frame.size = (uint64_t) st.st_size;
+            frame.offset = head + frame.size > ring_size ? 0 : head;
+
+            while (overlaps(frame, pending)) {
+
+                Message msg;
+
+                if (!receive_message(fd, msg)) {
+                    throw std::runtime_error("Writer disconnected");
+                }
+
+                if (msg.offset != pending.front().offset || msg.size != pending.front().size) {
+                    throw std::runtime_error("Codestreams consumed out of order");
+                }
+
+                pending.pop_front();
+            }
+
+            if (fread(ring + frame.offset, 1, (size_t) frame.size, f) != frame.size) {
+                throw std::runtime_error(std::string("Cannot read codestream ") + argv[i]);
+            }
+
+            fclose(f);
+
+            send_message(fd, SharedMemorySequence::FRAME_READY, frame.offset, frame.size);
+
+            pending.push_back(frame);
+
+            head = frame.offset + frame.size;
+        }
+
+        send_message(fd, SharedMemorySequence::END_OF_STREAM, 0, 0);
+
+        /* the connection stays open until every codestream is consumed and the writer closes it */
+
+        Message msg;
+
+        while (receive_message(fd, msg)) {
+
+            if (pending.empty() || msg.offset != pending.front().offset || msg.size != pending.front().size) {
+                throw std::runtime_error("Codestreams consumed out of order");
+            }
+
+            pending.pop_front();
+        }
+
+        if (!pending.empty()) {
+            throw std::runtime_error("Writer disconnected");
+        }
+
+        close(fd);
+
+    } catch (const std::exception& e) {
+
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}